@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Timer wheel benchmarks
+//
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include "clock/clock_timer_wheel.hpp"
+
+namespace freewebrtc::bench {
+
+using namespace std::chrono_literals;
+
+// Schedule and cancel timer while range(0) timers are active
+static void clock_timer_wheel_schedule_cancel(benchmark::State& state) {
+    clock::TimerWheel<unsigned> wheel;
+    std::mt19937 rng(2023);
+    const auto now = clock::Timepoint::epoch();
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        wheel.schedule(now.advance(std::chrono::milliseconds(rng() % 40000)), unsigned(i));
+    }
+    for (auto _: state) {
+        const auto id = wheel.schedule(now.advance(std::chrono::milliseconds(500 + rng() % 1000)), 0);
+        benchmark::DoNotOptimize(wheel.cancel(id));
+    }
+}
+BENCHMARK(clock_timer_wheel_schedule_cancel)->Arg(1000)->Arg(100000);
+
+// Timers are fired and rescheduled as STUN retransmits
+static void clock_timer_wheel_fire_reschedule(benchmark::State& state) {
+    clock::TimerWheel<unsigned> wheel;
+    std::mt19937 rng(2023);
+    auto now = clock::Timepoint::epoch();
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        wheel.schedule(now.advance(std::chrono::milliseconds(rng() % 500)), unsigned(i));
+    }
+    for (auto _: state) {
+        now = now.advance(1ms);
+        for (auto v = wheel.pop_expired(now); v.is_some(); v = wheel.pop_expired(now)) {
+            wheel.schedule(now.advance(std::chrono::milliseconds(250 + rng() % 500)), v.unwrap());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0) / 500);
+}
+BENCHMARK(clock_timer_wheel_fire_reschedule)->Arg(1000)->Arg(100000);
+
+}
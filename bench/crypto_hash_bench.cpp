@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Hash providers benchmarks (built-in vs OpenSSL)
+//
+
+#include <benchmark/benchmark.h>
+
+#include "crypto/builtin/builtin_hash.hpp"
+#include "crypto/builtin/builtin_hmac_multi.hpp"
+#include "crypto/crypto_hmac.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::bench {
+
+namespace {
+
+template<typename Hash>
+void run(benchmark::State& state, const typename Hash::Func& func) {
+    const std::vector<uint8_t> data(state.range(0), 0x5a);
+    const std::vector<util::ConstBinaryView> input = {util::ConstBinaryView(data)};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(func(input));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+template<typename Hash>
+void run_impl(benchmark::State& state, crypto::builtin::Impl impl,
+              typename Hash::Result (*func)(const typename Hash::Input&, crypto::builtin::Impl)) {
+    if (!crypto::builtin::is_supported(impl)) {
+        state.SkipWithError("Not supported by CPU");
+        return;
+    }
+    run<Hash>(state, [&](const typename Hash::Input& input) { return func(input, impl); });
+}
+
+template<typename HashFunc>
+void run_hmac(benchmark::State& state, const HashFunc& hash) {
+    const std::string password = "VOkJxbRl1RmTxUk/WvJxBt";
+    const util::ConstBinaryView pv(password.data(), password.size());
+    const auto ipad = crypto::hmac::IPadKey::from_key(pv, hash).unwrap();
+    const auto opad = crypto::hmac::OPadKey::from_key(pv, hash).unwrap();
+    const std::vector<uint8_t> data(state.range(0), 0x5a);
+    const std::vector<util::ConstBinaryView> input = {util::ConstBinaryView(data)};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(crypto::hmac::digest(input, opad, ipad, hash));
+    }
+}
+
+// HMAC-SHA1 of 64 messages of state.range(0) bytes.
+void run_hmac_multi(benchmark::State& state, crypto::builtin::MultiImpl impl) {
+    if (!crypto::builtin::is_supported(impl)) {
+        state.SkipWithError("Not supported by CPU");
+        return;
+    }
+    const std::string password = "VOkJxbRl1RmTxUk/WvJxBt";
+    const util::ConstBinaryView pv(password.data(), password.size());
+    const auto ipad = crypto::hmac::IPadKey::from_key(pv, crypto::builtin::sha1).unwrap();
+    const auto opad = crypto::hmac::OPadKey::from_key(pv, crypto::builtin::sha1).unwrap();
+    const auto key = crypto::hmac::SHA1PrecomputedKey::from_pads(ipad, opad, crypto::builtin::sha1_resumable()).unwrap();
+    const std::vector<uint8_t> data(state.range(0), 0x5a);
+    const std::vector<util::ConstBinaryView> input = {util::ConstBinaryView(data)};
+    const std::vector<crypto::builtin::HMACSHA1Job> jobs(64, crypto::builtin::HMACSHA1Job{key, input});
+    for (auto _: state) {
+        benchmark::DoNotOptimize(crypto::builtin::hmac_sha1_multi(jobs, impl));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(jobs.size()));
+}
+
+}
+
+static void crypto_sha1_openssl(benchmark::State& state) {
+    run<crypto::SHA1Hash>(state, crypto::openssl::sha1);
+}
+BENCHMARK(crypto_sha1_openssl)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha1_builtin(benchmark::State& state) {
+    run<crypto::SHA1Hash>(state, crypto::builtin::sha1);
+}
+BENCHMARK(crypto_sha1_builtin)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha1_builtin_scalar(benchmark::State& state) {
+    run_impl<crypto::SHA1Hash>(state, crypto::builtin::Impl::scalar, crypto::builtin::sha1_with_impl);
+}
+BENCHMARK(crypto_sha1_builtin_scalar)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha1_builtin_x86_sha(benchmark::State& state) {
+    run_impl<crypto::SHA1Hash>(state, crypto::builtin::Impl::x86_sha, crypto::builtin::sha1_with_impl);
+}
+BENCHMARK(crypto_sha1_builtin_x86_sha)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha1_builtin_armv8_sha(benchmark::State& state) {
+    run_impl<crypto::SHA1Hash>(state, crypto::builtin::Impl::armv8_sha, crypto::builtin::sha1_with_impl);
+}
+BENCHMARK(crypto_sha1_builtin_armv8_sha)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha256_openssl(benchmark::State& state) {
+    run<crypto::SHA256Hash>(state, crypto::openssl::sha256);
+}
+BENCHMARK(crypto_sha256_openssl)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha256_builtin(benchmark::State& state) {
+    run<crypto::SHA256Hash>(state, crypto::builtin::sha256);
+}
+BENCHMARK(crypto_sha256_builtin)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha256_builtin_scalar(benchmark::State& state) {
+    run_impl<crypto::SHA256Hash>(state, crypto::builtin::Impl::scalar, crypto::builtin::sha256_with_impl);
+}
+BENCHMARK(crypto_sha256_builtin_scalar)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha256_builtin_x86_sha(benchmark::State& state) {
+    run_impl<crypto::SHA256Hash>(state, crypto::builtin::Impl::x86_sha, crypto::builtin::sha256_with_impl);
+}
+BENCHMARK(crypto_sha256_builtin_x86_sha)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_sha256_builtin_armv8_sha(benchmark::State& state) {
+    run_impl<crypto::SHA256Hash>(state, crypto::builtin::Impl::armv8_sha, crypto::builtin::sha256_with_impl);
+}
+BENCHMARK(crypto_sha256_builtin_armv8_sha)->Arg(64)->Arg(128)->Arg(1024);
+
+static void crypto_hmac_sha1_multi_single(benchmark::State& state) {
+    run_hmac_multi(state, crypto::builtin::MultiImpl::single);
+}
+BENCHMARK(crypto_hmac_sha1_multi_single)->Arg(100);
+
+static void crypto_hmac_sha1_multi_lanes4(benchmark::State& state) {
+    run_hmac_multi(state, crypto::builtin::MultiImpl::lanes4);
+}
+BENCHMARK(crypto_hmac_sha1_multi_lanes4)->Arg(100);
+
+static void crypto_hmac_sha1_multi_lanes8_avx2(benchmark::State& state) {
+    run_hmac_multi(state, crypto::builtin::MultiImpl::lanes8_avx2);
+}
+BENCHMARK(crypto_hmac_sha1_multi_lanes8_avx2)->Arg(100);
+
+static void crypto_hmac_sha1_multi_lanes16_avx512(benchmark::State& state) {
+    run_hmac_multi(state, crypto::builtin::MultiImpl::lanes16_avx512);
+}
+BENCHMARK(crypto_hmac_sha1_multi_lanes16_avx512)->Arg(100);
+
+static void crypto_hmac_sha1_builtin_func(benchmark::State& state) {
+    run_hmac(state, crypto::SHA1Hash::Func{crypto::builtin::sha1});
+}
+BENCHMARK(crypto_hmac_sha1_builtin_func)->Arg(100);
+
+static void crypto_hmac_sha1_builtin_direct(benchmark::State& state) {
+    run_hmac(state, crypto::builtin::sha1);
+}
+BENCHMARK(crypto_hmac_sha1_builtin_direct)->Arg(100);
+
+}
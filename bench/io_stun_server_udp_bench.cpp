@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Linux UDP driver of STUN server benchmarks
+//
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <random>
+
+#include "crypto/openssl/openssl_hash.hpp"
+#include "io/io_stun_server_udp.hpp"
+
+namespace freewebrtc::bench {
+
+// Loopback binding requests: client sends range(0) requests by
+// one sendmmsg, server receives, processes and responds them by
+// one recvmmsg / sendmmsg, client receives responses. All is done
+// in one thread so items per second is packets per second per core
+// (both client and server side are included). p99_us is 99th
+// percentile of round trip of the batch.
+static void io_stun_server_udp_loopback(benchmark::State& state) {
+    const size_t batch_size = size_t(state.range(0));
+    const auto loopback = net::ip::Address::from_string("127.0.0.1").unwrap();
+    stun::server::Stateless server(crypto::openssl::sha1);
+    io::StunServerUDP driver(io::UdpSocket::bind(net::UdpEndpoint{loopback, net::Port(0)}).unwrap(),
+                             server,
+                             io::StunServerUDP::Settings{.batch_size = batch_size});
+    const auto server_ep = driver.socket().local_endpoint().unwrap();
+    auto client = io::UdpSocket::bind(net::UdpEndpoint{loopback, net::Port(0)}).unwrap();
+    std::random_device random;
+    const auto request = stun::Message{
+        stun::Header{stun::Class::request(), stun::Method::binding(), stun::TransactionId::generate(random)},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{false},
+        none()
+    }.build().unwrap();
+    io::UdpBatch batch(batch_size);
+    std::vector<double> latency;
+    for (auto _: state) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch_size; ++i) {
+            auto buffer = batch.send_buffer();
+            std::copy(request.begin(), request.end(), buffer.begin());
+            batch.queue_send(request.size(), server_ep, none());
+        }
+        client.send(batch).unwrap();
+        size_t processed = 0;
+        while (processed < batch_size) {
+            processed += driver.process().unwrap();
+        }
+        size_t received = 0;
+        while (received < batch_size) {
+            received += client.receive(batch).unwrap();
+        }
+        latency.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * batch_size));
+    std::sort(latency.begin(), latency.end());
+    state.counters["p99_us"] = latency[latency.size() * 99 / 100];
+}
+BENCHMARK(io_stun_server_udp_loopback)->Arg(1)->Arg(8)->Arg(64);
+
+}
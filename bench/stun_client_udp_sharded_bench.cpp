@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Sharded STUN client benchmarks
+//
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+
+#include "crypto/openssl/openssl_hash.hpp"
+#include "stun/stun_client_udp_sharded.hpp"
+#include "stun/stun_server_stateless.hpp"
+
+namespace freewebrtc::bench {
+
+// Full transaction (request, response, result) in the shard
+// of each thread. Shards do not share state so items per
+// second should grow linearly with number of threads.
+static void stun_client_udp_sharded_transaction(benchmark::State& state) {
+    using ClientUDP = stun::ClientUDP;
+    static std::unique_ptr<stun::ShardedClientUDP> sharded;
+    if (state.thread_index() == 0) {
+        sharded = std::make_unique<stun::ShardedClientUDP>(size_t(state.threads()), ClientUDP::Settings{});
+    }
+    const auto local = net::ip::Address::from_string("192.168.0.1").unwrap();
+    const auto target = net::ip::Address::from_string("192.168.0.2").unwrap();
+    const net::UdpEndpoint nat_ep{net::ip::Address::from_string("10.0.0.1").unwrap(), net::Port(3478)};
+    stun::server::Stateless server(crypto::openssl::sha1);
+    std::mt19937 rng(2023 + state.thread_index());
+    auto now = clock::Timepoint::epoch();
+    const size_t index = size_t(state.thread_index());
+    // Loop start synchronizes threads so shards are created
+    // before they are used.
+    for (auto _: state) {
+        auto& shard = sharded->shard(index);
+        sharded->create(rng, index, now, ClientUDP::Request{{local, target}, {}}).unwrap();
+        const auto send = std::get<ClientUDP::SendData>(shard.next(now));
+        const auto respond = std::get<stun::server::Stateless::Respond>(server.process(nat_ep, send.message_view));
+        const auto response = respond.response.build(respond.maybe_integrity).unwrap();
+        // Retransmit timer
+        benchmark::DoNotOptimize(shard.next(now));
+        now = now.advance(std::chrono::milliseconds(1));
+        benchmark::DoNotOptimize(sharded->response(now, util::ConstBinaryView(response)));
+        // Transaction result and idle
+        benchmark::DoNotOptimize(shard.next(now));
+        benchmark::DoNotOptimize(shard.next(now));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+    if (state.thread_index() == 0) {
+        sharded.reset();
+    }
+}
+BENCHMARK(stun_client_udp_sharded_transaction)->ThreadRange(1, 8)->UseRealTime();
+
+}
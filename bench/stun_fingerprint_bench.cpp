@@ -0,0 +1,32 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN FINGERPRINT (CRC-32) benchmarks
+//
+
+#include <benchmark/benchmark.h>
+
+#include "stun/details/stun_fingerprint.hpp"
+
+namespace freewebrtc::bench {
+
+static void stun_crc32(benchmark::State& state, stun::CRC32Impl impl) {
+    if (!stun::crc32_is_supported(impl)) {
+        state.SkipWithError("not supported by CPU");
+        return;
+    }
+    const util::ByteVec data(state.range(0), 0x5a);
+    const util::ConstBinaryView view(data);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(stun::crc32(view, impl));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK_CAPTURE(stun_crc32, bytewise, stun::CRC32Impl::bytewise)->Arg(100)->Arg(548)->Arg(1500);
+BENCHMARK_CAPTURE(stun_crc32, slice_by_8, stun::CRC32Impl::slice_by_8)->Arg(100)->Arg(548)->Arg(1500);
+BENCHMARK_CAPTURE(stun_crc32, pclmul, stun::CRC32Impl::pclmul)->Arg(100)->Arg(548)->Arg(1500);
+BENCHMARK_CAPTURE(stun_crc32, armv8_crc, stun::CRC32Impl::armv8_crc)->Arg(100)->Arg(548)->Arg(1500);
+
+}
@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN message parse / build benchmarks on RFC5769 vectors
+//
+
+#include <benchmark/benchmark.h>
+#include <array>
+
+#include "stun/stun_message.hpp"
+#include "stun/stun_message_view.hpp"
+#include "stun/stun_integrity_batch.hpp"
+#include "stun/stun_request_template.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+#include "crypto/builtin/builtin_hash.hpp"
+
+namespace freewebrtc::bench {
+
+namespace {
+
+// RFC5769 2.1. Sample Request
+const std::vector<uint8_t> rfc5769_request = {
+    0x00, 0x01, 0x00, 0x58, 0x21, 0x12, 0xa4, 0x42,
+    0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86,
+    0xfa, 0x87, 0xdf, 0xae, 0x80, 0x22, 0x00, 0x10,
+    0x53, 0x54, 0x55, 0x4e, 0x20, 0x74, 0x65, 0x73,
+    0x74, 0x20, 0x63, 0x6c, 0x69, 0x65, 0x6e, 0x74,
+    0x00, 0x24, 0x00, 0x04, 0x6e, 0x00, 0x01, 0xff,
+    0x80, 0x29, 0x00, 0x08, 0x93, 0x2f, 0xf9, 0xb1,
+    0x51, 0x26, 0x3b, 0x36, 0x00, 0x06, 0x00, 0x09,
+    0x65, 0x76, 0x74, 0x6a, 0x3a, 0x68, 0x36, 0x76,
+    0x59, 0x20, 0x20, 0x20, 0x00, 0x08, 0x00, 0x14,
+    0x9a, 0xea, 0xa7, 0x0c, 0xbf, 0xd8, 0xcb, 0x56,
+    0x78, 0x1e, 0xf2, 0xb5, 0xb2, 0xd3, 0xf2, 0x49,
+    0xc1, 0xb5, 0x71, 0xa2, 0x80, 0x28, 0x00, 0x04,
+    0xe5, 0x7a, 0x3b, 0xcf
+};
+
+// RFC5769 2.2. Sample IPv4 Response
+const std::vector<uint8_t> rfc5769_response = {
+    0x01, 0x01, 0x00, 0x3c, 0x21, 0x12, 0xa4, 0x42,
+    0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86,
+    0xfa, 0x87, 0xdf, 0xae, 0x80, 0x22, 0x00, 0x0b,
+    0x74, 0x65, 0x73, 0x74, 0x20, 0x76, 0x65, 0x63,
+    0x74, 0x6f, 0x72, 0x20, 0x00, 0x20, 0x00, 0x08,
+    0x00, 0x01, 0xa1, 0x47, 0xe1, 0x12, 0xa6, 0x43,
+    0x00, 0x08, 0x00, 0x14, 0x2b, 0x91, 0xf5, 0x99,
+    0xfd, 0x9e, 0x90, 0xc3, 0x8c, 0x74, 0x89, 0xf9,
+    0x2a, 0xf9, 0xba, 0x53, 0xf0, 0x6b, 0xe7, 0xd7,
+    0x80, 0x28, 0x00, 0x04, 0xc0, 0x7d, 0x4c, 0x96
+};
+
+const precis::OpaqueString rfc5769_password{"VOkJxbRl1RmTxUk/WvJxBt"};
+
+stun::Message parse_or_abort(const std::vector<uint8_t>& data) {
+    stun::ParseStat stat;
+    return stun::Message::parse(util::ConstBinaryView(data), stat).unwrap();
+}
+
+stun::IntegrityData rfc5769_integrity() {
+    return stun::IntegrityData{
+        stun::Password::short_term(rfc5769_password, crypto::openssl::sha1).unwrap(),
+        crypto::openssl::sha1
+    };
+}
+
+stun::IntegrityData rfc5769_precomputed_integrity() {
+    return stun::IntegrityData{
+        stun::Password::short_term(rfc5769_password, crypto::openssl::sha1, crypto::openssl::sha1_resumable()).unwrap(),
+        crypto::openssl::sha1
+    };
+}
+
+}
+
+static void stun_message_parse_rfc5769_request(benchmark::State& state) {
+    stun::ParseStat stat;
+    const util::ConstBinaryView data(rfc5769_request);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(stun::Message::parse(data, stat));
+    }
+}
+BENCHMARK(stun_message_parse_rfc5769_request);
+
+static void stun_message_parse_rfc5769_response(benchmark::State& state) {
+    stun::ParseStat stat;
+    const util::ConstBinaryView data(rfc5769_response);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(stun::Message::parse(data, stat));
+    }
+}
+BENCHMARK(stun_message_parse_rfc5769_response);
+
+static void stun_message_view_parse_rfc5769_request(benchmark::State& state) {
+    stun::ParseStat stat;
+    const util::ConstBinaryView data(rfc5769_request);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(stun::MessageView::parse(data, stat));
+    }
+}
+BENCHMARK(stun_message_view_parse_rfc5769_request);
+
+static void stun_message_build_rfc5769_request(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build());
+    }
+}
+BENCHMARK(stun_message_build_rfc5769_request);
+
+static void stun_message_build_rfc5769_request_with_integrity(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    const stun::MaybeIntegrity integrity = rfc5769_integrity();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build(integrity));
+    }
+}
+BENCHMARK(stun_message_build_rfc5769_request_with_integrity);
+
+static void stun_message_build_rfc5769_response(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_response);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build());
+    }
+}
+BENCHMARK(stun_message_build_rfc5769_response);
+
+static void stun_message_build_into_rfc5769_response(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_response);
+    std::array<uint8_t, 1500> buffer;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build_into(buffer));
+    }
+}
+BENCHMARK(stun_message_build_into_rfc5769_response);
+
+static void stun_message_build_into_rfc5769_request_with_integrity(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    const stun::MaybeIntegrity integrity = rfc5769_integrity();
+    std::array<uint8_t, 1500> buffer;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build_into(buffer, integrity));
+    }
+}
+BENCHMARK(stun_message_build_into_rfc5769_request_with_integrity);
+
+static void stun_request_template_build_into_rfc5769_request(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    const auto tmpl = stun::RequestTemplate::create(msg, rfc5769_precomputed_integrity()).unwrap();
+    const auto& tid = msg.header.transaction_id;
+    std::array<uint8_t, 1500> buffer;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(tmpl.build_into(buffer, tid));
+    }
+}
+BENCHMARK(stun_request_template_build_into_rfc5769_request);
+
+static void stun_message_build_into_rfc5769_request_precomputed(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    const stun::MaybeIntegrity integrity = rfc5769_precomputed_integrity();
+    std::array<uint8_t, 1500> buffer;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build_into(buffer, integrity));
+    }
+}
+BENCHMARK(stun_message_build_into_rfc5769_request_precomputed);
+
+static void stun_message_build_gather_rfc5769_request(benchmark::State& state) {
+    const auto msg = parse_or_abort(rfc5769_request);
+    stun::MessageGather gather;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.build_gather(gather));
+    }
+}
+BENCHMARK(stun_message_build_gather_rfc5769_request);
+
+static void stun_message_is_valid_rfc5769_request(benchmark::State& state) {
+    const util::ConstBinaryView data(rfc5769_request);
+    const auto msg = parse_or_abort(rfc5769_request);
+    const auto integrity = rfc5769_integrity();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.is_valid(data, integrity));
+    }
+}
+BENCHMARK(stun_message_is_valid_rfc5769_request);
+
+static void stun_message_is_valid_rfc5769_request_precomputed(benchmark::State& state) {
+    const util::ConstBinaryView data(rfc5769_request);
+    const auto msg = parse_or_abort(rfc5769_request);
+    const auto integrity = rfc5769_precomputed_integrity();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(msg.is_valid(data, integrity));
+    }
+}
+BENCHMARK(stun_message_is_valid_rfc5769_request_precomputed);
+
+static void stun_message_is_valid_batch_rfc5769_request(benchmark::State& state) {
+    const util::ConstBinaryView data(rfc5769_request);
+    stun::ParseStat stat;
+    const auto view = stun::MessageView::parse(data, stat).unwrap();
+    const auto password = stun::Password::short_term(rfc5769_password, crypto::openssl::sha1, crypto::builtin::sha1_resumable()).unwrap();
+    const std::vector<stun::IntegrityCheck> checks(state.range(0), stun::IntegrityCheck{view, password});
+    for (auto _: state) {
+        benchmark::DoNotOptimize(stun::is_valid_batch(checks, crypto::openssl::sha1));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(stun_message_is_valid_batch_rfc5769_request)->Arg(1)->Arg(16)->Arg(64);
+
+}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN stateless server benchmarks
+//
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <memory>
+#include <random>
+
+#include "crypto/openssl/openssl_hash.hpp"
+#include "stun/stun_server_stateless.hpp"
+
+namespace freewebrtc::bench {
+
+// Authenticated binding requests (ICE connectivity checks) are
+// processed by one server instance that is shared by all threads.
+// Users and settings are read-only for processing and statistics
+// is per-thread so items per second should grow linearly with
+// number of threads (up to number of cores).
+static void stun_server_stateless_shared(benchmark::State& state) {
+    using Stateless = stun::server::Stateless;
+    static std::unique_ptr<Stateless> server;
+    const precis::OpaqueString username{"user"};
+    const auto password = stun::Password::short_term(precis::OpaqueString("password"), crypto::openssl::sha1).unwrap();
+    if (state.thread_index() == 0) {
+        server = std::make_unique<Stateless>(crypto::openssl::sha1);
+        server->add_user(username, password);
+    }
+    std::random_device random;
+    const auto request = stun::Message{
+        stun::Header{stun::Class::request(), stun::Method::binding(), stun::TransactionId::generate(random)},
+        stun::AttributeSet::create({stun::UsernameAttribute{username}, stun::FingerprintAttribute{0}}),
+        stun::IsRFC3489{false},
+        none()
+    }.build(stun::IntegrityData{password, crypto::openssl::sha1}).unwrap();
+    const net::UdpEndpoint endpoint{net::ip::Address::from_string("10.0.0.1").unwrap(), net::Port(3478)};
+    // Loop start synchronizes threads so server is created
+    // before it is used.
+    for (auto _: state) {
+        benchmark::DoNotOptimize(server->process(endpoint, util::ConstBinaryView(request)));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+    if (state.thread_index() == 0) {
+        server.reset();
+    }
+}
+BENCHMARK(stun_server_stateless_shared)->ThreadRange(1, 32)->UseRealTime();
+
+// Response of authenticated binding request is built to the send
+// buffer: process + Message::build_into vs process_into.
+static void stun_server_stateless_respond(benchmark::State& state) {
+    using Stateless = stun::server::Stateless;
+    const bool direct = state.range(0) != 0;
+    const precis::OpaqueString username{"user"};
+    const auto password = stun::Password::short_term(precis::OpaqueString("password"), crypto::openssl::sha1).unwrap();
+    Stateless server(crypto::openssl::sha1);
+    server.add_user(username, password);
+    std::random_device random;
+    const auto request = stun::Message{
+        stun::Header{stun::Class::request(), stun::Method::binding(), stun::TransactionId::generate(random)},
+        stun::AttributeSet::create({stun::UsernameAttribute{username}, stun::FingerprintAttribute{0}}),
+        stun::IsRFC3489{false},
+        none()
+    }.build(stun::IntegrityData{password, crypto::openssl::sha1}).unwrap();
+    const net::UdpEndpoint endpoint{net::ip::Address::from_string("10.0.0.1").unwrap(), net::Port(3478)};
+    std::array<uint8_t, 1500> out;
+    for (auto _: state) {
+        if (direct) {
+            benchmark::DoNotOptimize(server.process_into(endpoint, util::ConstBinaryView(request), out));
+        } else {
+            const auto r = server.process(endpoint, util::ConstBinaryView(request));
+            const auto& respond = std::get<Stateless::Respond>(r);
+            benchmark::DoNotOptimize(respond.response.build_into(out, respond.maybe_integrity));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+    state.SetLabel(direct ? "process_into" : "process+build_into");
+}
+BENCHMARK(stun_server_stateless_respond)->Arg(0)->Arg(1);
+
+}
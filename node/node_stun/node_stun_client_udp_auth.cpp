@@ -21,7 +21,7 @@ Result<stun::ClientUDP::Auth> parse_auth(craftnapi::Object obj) {
     auto password_rv = (obj.named_property("password")
         > [](auto&& val) { return val.as_string(); }
         > [&](std::string&& str) {
-            return stun::Password::short_term(precis::OpaqueString{std::move(str)}, sha1);
+            return stun::Password::short_term(precis::OpaqueString{std::move(str)}, sha1, freewebrtc::crypto::node_openssl::sha1_resumable());
         }
         ).add_context("password attribute");
 
@@ -21,7 +21,8 @@ Result<craftnapi::Value> client_udp_handle_to_craftnapi(craftnapi::Env& env, stu
 //
 inline Result<craftnapi::Value> client_udp_handle_to_craftnapi(craftnapi::Env& env, stun::ClientUDP::Handle hnd) {
     return env.create_object({
-            {"value", env.create_int32(hnd.value)}
+            {"index", env.create_int32(int32_t(hnd.index))},
+            {"generation", env.create_int32(int32_t(hnd.generation))}
         })
         .fmap(craftnapi::Object::fmap_to_value);
 }
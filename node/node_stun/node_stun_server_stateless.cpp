@@ -104,7 +104,7 @@ Result<Value> add_user(Env& env, const CallbackInfo& info) {
     auto password_rv = (info[1]
         > [](const auto& arg) { return arg.as_string(); }
         > [](const auto& str) {
-            return stun::Password::short_term(precis::OpaqueString{str}, crypto::node_openssl::sha1);
+            return stun::Password::short_term(precis::OpaqueString{str}, crypto::node_openssl::sha1, crypto::node_openssl::sha1_resumable());
         }).add_context("password (2nd parameter)");
 
     auto obj_rvv = info.this_arg.unwrap<stun::server::Stateless>().add_context("object unwrap");
@@ -0,0 +1,398 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Hierarchical timer wheel
+//
+// Timers are placed into slots of the wheel levels by their
+// expiration tick (level 0 - tick resolution, each next level is
+// 256 times coarser). Timers of the higher levels are moved to lower
+// ones (cascaded) when time reaches their slot. Schedule and cancel
+// are O(1). Memory of the cancelled and fired timers is reused by
+// next scheduled timers so memory does not grow with timers churn.
+//
+// Timers are never fired earlier than scheduled: exact expiration
+// time is compared for timers of the current tick.
+//
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "clock/clock_timepoint.hpp"
+#include "util/util_maybe.hpp"
+
+namespace freewebrtc::clock {
+
+template<typename T>
+class TimerWheel {
+public:
+    struct Id {
+        uint32_t index;
+        uint32_t generation;
+        bool operator==(const Id&) const noexcept = default;
+    };
+    explicit TimerWheel(NativeDuration tick = std::chrono::milliseconds(1));
+
+    // Schedule timer with value. O(1)
+    Id schedule(Timepoint expires, const T&);
+    // Cancel timer. O(1). Returns false if timer is already
+    // fired or cancelled.
+    bool cancel(const Id&) noexcept;
+    // Take value of one timer that is expired at now (if any).
+    // Timers that are expired at the same tick are taken in order
+    // of schedule.
+    Maybe<T> pop_expired(Timepoint now);
+    // Earliest expiration time of the active timers.
+    Maybe<Timepoint> next_expiration() const noexcept;
+
+    // Number of active timers
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+private:
+    using Tick = uint64_t;
+    using Index = uint32_t;
+    static constexpr size_t LEVEL_BITS = 8;
+    static constexpr size_t SLOTS = size_t{1} << LEVEL_BITS;
+    static constexpr Tick SLOT_MASK = SLOTS - 1;
+    static constexpr size_t LEVELS = 4;
+    static constexpr Index NIL = ~Index{0};
+    // Lists of the slots are followed by list of expired timers
+    // and list of free nodes.
+    static constexpr Index EXPIRED = LEVELS * SLOTS;
+    static constexpr Index FREE = EXPIRED + 1;
+
+    struct Node {
+        Timepoint expires;
+        Tick tick;
+        T value;
+        Index list;
+        Index prev;
+        Index next;
+        uint32_t generation;
+    };
+    struct List {
+        Index head = NIL;
+        Index tail = NIL;
+    };
+    using Bitmap = std::array<uint64_t, SLOTS / 64>;
+
+    static constexpr Index slot_list(size_t level, size_t slot) noexcept;
+    static constexpr Tick level_shift(size_t level) noexcept;
+    Tick tick_of(const Timepoint&) const noexcept;
+    Index allocate(const Timepoint&, const T&);
+    void release(Index) noexcept;
+    void link(Index list, Index) noexcept;
+    void unlink(Index) noexcept;
+    // Put node to the slot according to its tick.
+    void place(Index) noexcept;
+    void cascade(size_t level) noexcept;
+    void advance(Tick target) noexcept;
+    // Tick of the next event (expiration or cascade) after current tick
+    // on the level.
+    Maybe<Tick> next_event(size_t level) const noexcept;
+    // First non-empty slot from the slot (inclusive) in circular order.
+    Maybe<size_t> find_slot(size_t level, size_t from) const noexcept;
+
+    const NativeDuration m_tick;
+    Maybe<Timepoint> m_origin = None{};
+    Tick m_current = 0;
+    std::vector<Node> m_nodes;
+    std::array<List, FREE + 1> m_lists;
+    std::array<Bitmap, LEVELS> m_occupied = {};
+    size_t m_size = 0;
+    size_t m_in_wheel = 0;
+};
+
+//
+// implementation
+//
+template<typename T>
+TimerWheel<T>::TimerWheel(NativeDuration tick)
+    : m_tick(tick)
+{}
+
+template<typename T>
+typename TimerWheel<T>::Id TimerWheel<T>::schedule(Timepoint expires, const T& value) {
+    if (m_origin.is_none()) {
+        m_origin = expires;
+    }
+    const Index index = allocate(expires, value);
+    place(index);
+    ++m_size;
+    return Id{index, m_nodes[index].generation};
+}
+
+template<typename T>
+bool TimerWheel<T>::cancel(const Id& id) noexcept {
+    if (id.index >= m_nodes.size()) {
+        return false;
+    }
+    const Node& node = m_nodes[id.index];
+    if (node.generation != id.generation || node.list == FREE) {
+        return false;
+    }
+    unlink(id.index);
+    release(id.index);
+    return true;
+}
+
+template<typename T>
+Maybe<T> TimerWheel<T>::pop_expired(Timepoint now) {
+    if (m_size == 0) {
+        return none();
+    }
+    advance(tick_of(now));
+    if (m_lists[EXPIRED].head == NIL) {
+        // Timers of the current tick are checked by exact time.
+        Index index = m_lists[slot_list(0, m_current & SLOT_MASK)].head;
+        while (index != NIL) {
+            const Index next = m_nodes[index].next;
+            if (!m_nodes[index].expires.is_after(now)) {
+                unlink(index);
+                link(EXPIRED, index);
+            }
+            index = next;
+        }
+    }
+    const Index index = m_lists[EXPIRED].head;
+    if (index == NIL) {
+        return none();
+    }
+    T value = m_nodes[index].value;
+    unlink(index);
+    release(index);
+    return value;
+}
+
+template<typename T>
+Maybe<Timepoint> TimerWheel<T>::next_expiration() const noexcept {
+    Maybe<Timepoint> best = none();
+    Maybe<Tick> best_tick = none();
+    auto scan = [&](Index list) {
+        for (Index index = m_lists[list].head; index != NIL; index = m_nodes[index].next) {
+            const Timepoint& expires = m_nodes[index].expires;
+            if (best.is_none() || expires.is_before(best.unwrap())) {
+                best = expires;
+                best_tick = m_nodes[index].tick;
+            }
+        }
+    };
+    scan(EXPIRED);
+    for (size_t level = 0; level < LEVELS; ++level) {
+        const Tick base = m_current >> level_shift(level);
+        const size_t from = (base + (level == 0 ? 0 : 1)) & SLOT_MASK;
+        find_slot(level, from)
+            .with_inner([&](size_t slot) {
+                // All timers of the slot are not earlier than start
+                // tick of the slot.
+                const Tick distance = (slot - from) & SLOT_MASK;
+                const Tick start = level == 0
+                    ? m_current + distance
+                    : (base + 1 + distance) << level_shift(level);
+                if (best_tick.is_none() || start <= best_tick.unwrap()) {
+                    scan(slot_list(level, slot));
+                }
+            });
+    }
+    return best;
+}
+
+template<typename T>
+size_t TimerWheel<T>::size() const noexcept {
+    return m_size;
+}
+
+template<typename T>
+bool TimerWheel<T>::empty() const noexcept {
+    return m_size == 0;
+}
+
+template<typename T>
+constexpr typename TimerWheel<T>::Index TimerWheel<T>::slot_list(size_t level, size_t slot) noexcept {
+    return Index(level * SLOTS + slot);
+}
+
+template<typename T>
+constexpr typename TimerWheel<T>::Tick TimerWheel<T>::level_shift(size_t level) noexcept {
+    return level * LEVEL_BITS;
+}
+
+template<typename T>
+typename TimerWheel<T>::Tick TimerWheel<T>::tick_of(const Timepoint& tp) const noexcept {
+    const auto since_origin = tp - m_origin.value();
+    if (since_origin.count() <= 0) {
+        return 0;
+    }
+    return Tick(since_origin / m_tick);
+}
+
+template<typename T>
+typename TimerWheel<T>::Index TimerWheel<T>::allocate(const Timepoint& expires, const T& value) {
+    const Index index = m_lists[FREE].head;
+    if (index == NIL) {
+        m_nodes.emplace_back(Node{expires, tick_of(expires), value, FREE, NIL, NIL, 0});
+        return Index(m_nodes.size() - 1);
+    }
+    unlink(index);
+    Node& node = m_nodes[index];
+    node.expires = expires;
+    node.tick = tick_of(expires);
+    node.value = value;
+    return index;
+}
+
+template<typename T>
+void TimerWheel<T>::release(Index index) noexcept {
+    ++m_nodes[index].generation;
+    link(FREE, index);
+    --m_size;
+}
+
+template<typename T>
+void TimerWheel<T>::link(Index list, Index index) noexcept {
+    Node& node = m_nodes[index];
+    List& l = m_lists[list];
+    node.list = list;
+    node.prev = l.tail;
+    node.next = NIL;
+    if (l.tail != NIL) {
+        m_nodes[l.tail].next = index;
+    } else {
+        l.head = index;
+    }
+    l.tail = index;
+    if (list < EXPIRED) {
+        m_occupied[list / SLOTS][(list % SLOTS) / 64] |= uint64_t{1} << (list % 64);
+        ++m_in_wheel;
+    }
+}
+
+template<typename T>
+void TimerWheel<T>::unlink(Index index) noexcept {
+    Node& node = m_nodes[index];
+    List& l = m_lists[node.list];
+    if (node.prev != NIL) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        l.head = node.next;
+    }
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = node.prev;
+    } else {
+        l.tail = node.prev;
+    }
+    if (node.list < EXPIRED) {
+        if (l.head == NIL) {
+            m_occupied[node.list / SLOTS][(node.list % SLOTS) / 64] &= ~(uint64_t{1} << (node.list % 64));
+        }
+        --m_in_wheel;
+    }
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+template<typename T>
+void TimerWheel<T>::place(Index index) noexcept {
+    const Tick tick = m_nodes[index].tick;
+    if (tick < m_current) {
+        link(EXPIRED, index);
+        return;
+    }
+    const Tick delta = tick - m_current;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        if (delta < (Tick{1} << level_shift(level + 1))) {
+            link(slot_list(level, (tick >> level_shift(level)) & SLOT_MASK), index);
+            return;
+        }
+    }
+    // Too far in the future: place to the farthest slot of the top
+    // level. Timer is placed again when the slot is cascaded.
+    const Tick farthest = m_current + (Tick{1} << level_shift(LEVELS)) - 1;
+    link(slot_list(LEVELS - 1, (farthest >> level_shift(LEVELS - 1)) & SLOT_MASK), index);
+}
+
+template<typename T>
+void TimerWheel<T>::cascade(size_t level) noexcept {
+    const Index list = slot_list(level, (m_current >> level_shift(level)) & SLOT_MASK);
+    Index index = m_lists[list].head;
+    while (index != NIL) {
+        const Index next = m_nodes[index].next;
+        unlink(index);
+        place(index);
+        index = next;
+    }
+}
+
+template<typename T>
+void TimerWheel<T>::advance(Tick target) noexcept {
+    while (m_current < target) {
+        // Target is after the current tick so all timers of the
+        // current tick are expired.
+        const Index current = slot_list(0, m_current & SLOT_MASK);
+        while (m_lists[current].head != NIL) {
+            const Index index = m_lists[current].head;
+            unlink(index);
+            link(EXPIRED, index);
+        }
+        Tick next = target;
+        for (size_t level = 0; level < LEVELS && m_in_wheel != 0; ++level) {
+            next_event(level)
+                .with_inner([&](Tick event) {
+                    next = std::min(next, event);
+                });
+        }
+        m_current = next;
+        for (size_t level = LEVELS - 1; level > 0; --level) {
+            if ((m_current & ((Tick{1} << level_shift(level)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+    }
+}
+
+template<typename T>
+Maybe<typename TimerWheel<T>::Tick> TimerWheel<T>::next_event(size_t level) const noexcept {
+    if (level == 0) {
+        const size_t from = (m_current + 1) & SLOT_MASK;
+        return find_slot(0, from)
+            .fmap([&](size_t slot) {
+                return m_current + 1 + ((slot - from) & SLOT_MASK);
+            });
+    }
+    const Tick base = m_current >> level_shift(level);
+    return find_slot(level, (base + 1) & SLOT_MASK)
+        .fmap([&](size_t slot) {
+            const Tick distance = (slot - base) & SLOT_MASK;
+            return (base + (distance == 0 ? SLOTS : distance)) << level_shift(level);
+        });
+}
+
+template<typename T>
+Maybe<size_t> TimerWheel<T>::find_slot(size_t level, size_t from) const noexcept {
+    const Bitmap& bitmap = m_occupied[level];
+    constexpr size_t WORDS = std::tuple_size_v<Bitmap>;
+    // Bits from "from" in the first word, then next words, then
+    // beginning of the first word.
+    for (size_t i = 0; i <= WORDS; ++i) {
+        const size_t word = (from / 64 + i) % WORDS;
+        uint64_t bits = bitmap[word];
+        if (i == 0) {
+            bits &= ~uint64_t{0} << (from % 64);
+        } else if (i == WORDS) {
+            bits &= ~(~uint64_t{0} << (from % 64));
+        }
+        if (bits != 0) {
+            return word * 64 + size_t(std::countr_zero(bits));
+        }
+    }
+    return none();
+}
+
+}
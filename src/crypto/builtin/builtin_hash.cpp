@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Built-in implementation of hash functions
+//
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "crypto/builtin/builtin_hash.hpp"
+#include "crypto/builtin/details/builtin_compress.hpp"
+#include "crypto/builtin/details/builtin_md_engine.hpp"
+
+namespace freewebrtc::crypto::builtin {
+
+namespace {
+
+using SHA1Engine = details::MDEngine<details::SHA1Words>;
+using SHA256Engine = details::MDEngine<details::SHA256Words>;
+
+#if defined(__x86_64__)
+
+bool cpu_has_x86_sha() {
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+    const bool has_ssse3 = (ecx & bit_SSSE3) != 0;
+    const bool has_sse41 = (ecx & bit_SSE4_1) != 0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+    const bool has_sha = (ebx & bit_SHA) != 0;
+    return has_ssse3 && has_sse41 && has_sha;
+}
+
+#endif
+
+#if defined(__aarch64__)
+
+bool cpu_has_armv8_sha() {
+#if defined(__ARM_FEATURE_SHA2)
+    return true;
+#elif defined(__linux__)
+    const auto hwcap = getauxval(AT_HWCAP);
+    return (hwcap & HWCAP_SHA1) != 0 && (hwcap & HWCAP_SHA2) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif
+
+details::SHA1Compress best_sha1_compress() {
+    static const details::SHA1Compress best = details::sha1_compress(best_impl());
+    return best;
+}
+
+details::SHA256Compress best_sha256_compress() {
+    static const details::SHA256Compress best = details::sha256_compress(best_impl());
+    return best;
+}
+
+template<typename Hash, typename Engine>
+typename Hash::Result calc(Engine&& engine, const typename Hash::Input& input) {
+    for (const auto& v: input) {
+        engine.update(v);
+    }
+    return Hash::move_from(engine.finalize());
+}
+
+}
+
+bool is_supported(Impl impl) {
+    switch (impl) {
+    case Impl::scalar:
+        return true;
+    case Impl::x86_sha:
+#if defined(__x86_64__)
+        return cpu_has_x86_sha();
+#else
+        return false;
+#endif
+    case Impl::armv8_sha:
+#if defined(__aarch64__)
+        return cpu_has_armv8_sha();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+Impl best_impl() {
+    for (auto impl: {Impl::x86_sha, Impl::armv8_sha}) {
+        if (is_supported(impl)) {
+            return impl;
+        }
+    }
+    return Impl::scalar;
+}
+
+crypto::SHA1Hash::Result sha1(const crypto::SHA1Hash::Input& input) {
+    return calc<crypto::SHA1Hash>(SHA1Engine(best_sha1_compress(), details::SHA1_INIT), input);
+}
+
+crypto::SHA256Hash::Result sha256(const crypto::SHA256Hash::Input& input) {
+    return calc<crypto::SHA256Hash>(SHA256Engine(best_sha256_compress(), details::SHA256_INIT), input);
+}
+
+crypto::SHA1Hash::Result sha1_with_impl(const crypto::SHA1Hash::Input& input, Impl impl) {
+    return calc<crypto::SHA1Hash>(SHA1Engine(details::sha1_compress(impl), details::SHA1_INIT), input);
+}
+
+crypto::SHA256Hash::Result sha256_with_impl(const crypto::SHA256Hash::Input& input, Impl impl) {
+    return calc<crypto::SHA256Hash>(SHA256Engine(details::sha256_compress(impl), details::SHA256_INIT), input);
+}
+
+Result<crypto::SHA1State> sha1_start(const util::ConstBinaryView& data) {
+    if (data.size() % crypto::SHA1State::block_size != 0) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    details::SHA1Words h = details::SHA1_INIT;
+    best_sha1_compress()(h, data.data(), data.size() / crypto::SHA1State::block_size);
+    return crypto::SHA1State{h, data.size()};
+}
+
+crypto::SHA1Hash::Result sha1_finish(const crypto::SHA1State& state, const crypto::SHA1Hash::Input& input) {
+    return calc<crypto::SHA1Hash>(SHA1Engine(best_sha1_compress(), state.h, state.length), input);
+}
+
+crypto::SHA1Resumable sha1_resumable() {
+    return crypto::SHA1Resumable{sha1_start, sha1_finish};
+}
+
+}
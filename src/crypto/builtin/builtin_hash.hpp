@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Built-in implementation of hash functions (no external
+// dependencies). Uses CPU SHA extensions when available.
+//
+
+#pragma once
+
+#include "crypto/crypto_hash.hpp"
+#include "crypto/crypto_sha1_state.hpp"
+
+namespace freewebrtc::crypto::builtin {
+
+crypto::SHA1Hash::Result sha1(const crypto::SHA1Hash::Input&);
+crypto::SHA256Hash::Result sha256(const crypto::SHA256Hash::Input&);
+
+// Resumable SHA-1 (see crypto::SHA1Resumable)
+Result<crypto::SHA1State> sha1_start(const util::ConstBinaryView&);
+crypto::SHA1Hash::Result sha1_finish(const crypto::SHA1State&, const crypto::SHA1Hash::Input&);
+crypto::SHA1Resumable sha1_resumable();
+
+// Implementations of compression functions. Functions above
+// use the best implementation supported by CPU (selected once
+// at runtime).
+enum class Impl {
+    scalar,         // Portable implementation
+    x86_sha,        // x86 SHA extensions (SHA-NI)
+    armv8_sha       // ARMv8 cryptographic extension
+};
+
+bool is_supported(Impl);
+Impl best_impl();
+// Calculate hash using specific implementation (plain sha1 /
+// sha256 are not overloaded to be convertible to Hash::Func).
+// Implementation must be supported by CPU.
+crypto::SHA1Hash::Result sha1_with_impl(const crypto::SHA1Hash::Input&, Impl);
+crypto::SHA256Hash::Result sha256_with_impl(const crypto::SHA256Hash::Input&, Impl);
+
+}
@@ -0,0 +1,306 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Multi-buffer HMAC-SHA1
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "crypto/builtin/builtin_hmac_multi.hpp"
+#include "util/util_reduce.hpp"
+
+namespace freewebrtc::crypto::builtin {
+
+namespace {
+
+using V4 = uint32_t __attribute__((vector_size(16)));
+using V8 = uint32_t __attribute__((vector_size(32)));
+using V16 = uint32_t __attribute__((vector_size(64)));
+
+constexpr size_t block_size = SHA1State::block_size;
+constexpr size_t max_lanes = 16;
+
+uint32_t read_u32be(const uint8_t *p) {
+    return (uint32_t(p[0]) << 24)
+        | (uint32_t(p[1]) << 16)
+        | (uint32_t(p[2]) << 8)
+        | uint32_t(p[3]);
+}
+
+void write_u32be(uint8_t *p, uint32_t v) {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+// Append SHA-1 padding to data of size (already in buf) where
+// total_size is size including previously hashed blocks.
+// Returns number of blocks in buf.
+size_t pad(uint8_t *buf, size_t size, uint64_t total_size) {
+    const size_t num_blocks = (size + 1 + sizeof(uint64_t) + block_size - 1) / block_size;
+    const size_t padded_size = num_blocks * block_size;
+    buf[size] = 0x80;
+    std::memset(buf + size + 1, 0, padded_size - size - 1 - sizeof(uint64_t));
+    const uint64_t bits = total_size << 3;
+    write_u32be(buf + padded_size - 8, uint32_t(bits >> 32));
+    write_u32be(buf + padded_size - 4, uint32_t(bits));
+    return num_blocks;
+}
+
+size_t padded_size(size_t size) {
+    return (size + 1 + sizeof(uint64_t) + block_size - 1) / block_size * block_size;
+}
+
+// SHA-1 compression of one block per lane. Vector element i
+// holds i-th lane. Functions below are always inlined into
+// kernels compiled for specific target so vector operations
+// are lowered to the instructions of that target.
+template<typename V>
+__attribute__((always_inline))
+inline void sha1_block(V (&h)[5], const uint8_t *const *blocks) {
+    constexpr size_t N = sizeof(V) / sizeof(uint32_t);
+    // Transpose blocks: w[t] holds t-th word of all lanes
+    uint32_t words[16][N];
+    for (size_t lane = 0; lane < N; ++lane) {
+        for (size_t t = 0; t < 16; ++t) {
+            words[t][lane] = read_u32be(blocks[lane] + 4 * t);
+        }
+    }
+    V w[16];
+    std::memcpy(w, words, sizeof(w));
+    V a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    auto round = [&](size_t t, const V& f, uint32_t k) __attribute__((always_inline)) {
+        if (t >= 16) {
+            const V x = w[(t + 13) & 15] ^ w[(t + 8) & 15] ^ w[(t + 2) & 15] ^ w[t & 15];
+            w[t & 15] = (x << 1) | (x >> 31);
+        }
+        const V tmp = ((a << 5) | (a >> 27)) + f + e + k + w[t & 15];
+        e = d;
+        d = c;
+        c = (b << 30) | (b >> 2);
+        b = a;
+        a = tmp;
+    };
+    size_t t = 0;
+    for (; t < 20; ++t) {
+        round(t, (b & c) | (~b & d), 0x5a827999);
+    }
+    for (; t < 40; ++t) {
+        round(t, b ^ c ^ d, 0x6ed9eba1);
+    }
+    for (; t < 60; ++t) {
+        round(t, (b & c) | (b & d) | (c & d), 0x8f1bbcdc);
+    }
+    for (; t < 80; ++t) {
+        round(t, b ^ c ^ d, 0xca62c1d6);
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+// HMAC-SHA1 of N = lanes messages. scratch must have
+// N * stride bytes where stride is enough for the longest
+// padded message.
+template<typename V>
+__attribute__((always_inline))
+inline void hmac_sha1_lanes(const HMACSHA1Job *jobs, SHA1Hash::Value *out, uint8_t *scratch, size_t stride) {
+    constexpr size_t N = sizeof(V) / sizeof(uint32_t);
+    V h[5];
+    size_t num_blocks[N];
+    size_t max_blocks = 0;
+    for (size_t lane = 0; lane < N; ++lane) {
+        const auto& inner = jobs[lane].key.get().inner();
+        uint8_t *buf = scratch + lane * stride;
+        size_t size = 0;
+        for (const auto& v: jobs[lane].data) {
+            std::memcpy(buf + size, v.data(), v.size());
+            size += v.size();
+        }
+        num_blocks[lane] = pad(buf, size, inner.length + size);
+        max_blocks = std::max(max_blocks, num_blocks[lane]);
+        for (size_t i = 0; i < 5; ++i) {
+            h[i][lane] = inner.h[i];
+        }
+    }
+
+    // Inner hash. Lanes with shorter messages repeat their last
+    // block while longer messages are processed: the state of such
+    // lane is taken right after the last block and extra
+    // calculations are ignored.
+    uint8_t outer_blocks[N][block_size];
+    for (size_t b = 0; b < max_blocks; ++b) {
+        const uint8_t *blocks[N];
+        for (size_t lane = 0; lane < N; ++lane) {
+            blocks[lane] = scratch + lane * stride + block_size * std::min(b, num_blocks[lane] - 1);
+        }
+        sha1_block(h, blocks);
+        for (size_t lane = 0; lane < N; ++lane) {
+            if (b + 1 == num_blocks[lane]) {
+                for (size_t i = 0; i < 5; ++i) {
+                    write_u32be(outer_blocks[lane] + 4 * i, h[i][lane]);
+                }
+            }
+        }
+    }
+
+    // Outer hash: inner digest always fits one block.
+    const uint8_t *blocks[N];
+    for (size_t lane = 0; lane < N; ++lane) {
+        const auto& outer = jobs[lane].key.get().outer();
+        pad(outer_blocks[lane], SHA1Hash::size, outer.length + SHA1Hash::size);
+        blocks[lane] = outer_blocks[lane];
+        for (size_t i = 0; i < 5; ++i) {
+            h[i][lane] = outer.h[i];
+        }
+    }
+    sha1_block(h, blocks);
+    for (size_t lane = 0; lane < N; ++lane) {
+        for (size_t i = 0; i < 5; ++i) {
+            write_u32be(out[lane].data() + 4 * i, h[i][lane]);
+        }
+    }
+}
+
+using LanesFunc = void (*)(const HMACSHA1Job *, SHA1Hash::Value *, uint8_t *, size_t);
+
+void hmac_sha1_lanes4(const HMACSHA1Job *jobs, SHA1Hash::Value *out, uint8_t *scratch, size_t stride) {
+    hmac_sha1_lanes<V4>(jobs, out, scratch, stride);
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+void hmac_sha1_lanes8_avx2(const HMACSHA1Job *jobs, SHA1Hash::Value *out, uint8_t *scratch, size_t stride) {
+    hmac_sha1_lanes<V8>(jobs, out, scratch, stride);
+}
+
+__attribute__((target("avx512f")))
+void hmac_sha1_lanes16_avx512(const HMACSHA1Job *jobs, SHA1Hash::Value *out, uint8_t *scratch, size_t stride) {
+    hmac_sha1_lanes<V16>(jobs, out, scratch, stride);
+}
+
+#endif
+
+LanesFunc lanes_func(MultiImpl impl) {
+    switch (impl) {
+    case MultiImpl::single:
+        return nullptr;
+    case MultiImpl::lanes4:
+        return &hmac_sha1_lanes4;
+    case MultiImpl::lanes8_avx2:
+#if defined(__x86_64__)
+        return &hmac_sha1_lanes8_avx2;
+#else
+        break;
+#endif
+    case MultiImpl::lanes16_avx512:
+#if defined(__x86_64__)
+        return &hmac_sha1_lanes16_avx512;
+#else
+        break;
+#endif
+    }
+    return nullptr;
+}
+
+size_t job_size(const HMACSHA1Job& job) {
+    size_t result = 0;
+    for (const auto& v: job.data) {
+        result += v.size();
+    }
+    return result;
+}
+
+}
+
+bool is_supported(MultiImpl impl) {
+    switch (impl) {
+    case MultiImpl::single:
+    case MultiImpl::lanes4:
+        return true;
+    case MultiImpl::lanes8_avx2:
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    case MultiImpl::lanes16_avx512:
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("avx512f");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+MultiImpl best_multi_impl() {
+    for (auto impl: {MultiImpl::lanes16_avx512, MultiImpl::lanes8_avx2}) {
+        if (is_supported(impl)) {
+            return impl;
+        }
+    }
+    return MultiImpl::lanes4;
+}
+
+size_t lanes(MultiImpl impl) {
+    switch (impl) {
+    case MultiImpl::single:
+        return 1;
+    case MultiImpl::lanes4:
+        return 4;
+    case MultiImpl::lanes8_avx2:
+        return 8;
+    case MultiImpl::lanes16_avx512:
+        return 16;
+    }
+    return 1;
+}
+
+Result<std::vector<hmac::Digest<SHA1Hash>>> hmac_sha1_multi(std::span<const HMACSHA1Job> jobs, MultiImpl impl) {
+    using DigestVec = std::vector<hmac::Digest<SHA1Hash>>;
+    DigestVec result;
+    result.reserve(jobs.size());
+    const auto func = lanes_func(impl);
+    const size_t n = lanes(impl);
+    const size_t num_multi = func != nullptr ? jobs.size() / n * n : 0;
+    if (num_multi > 0) {
+        size_t stride = 0;
+        for (size_t i = 0; i < num_multi; ++i) {
+            stride = std::max(stride, padded_size(job_size(jobs[i])));
+        }
+        util::ByteVec scratch(n * stride);
+        std::array<SHA1Hash::Value, max_lanes> out;
+        for (size_t i = 0; i < num_multi; i += n) {
+            func(jobs.data() + i, out.data(), scratch.data(), stride);
+            for (size_t lane = 0; lane < n; ++lane) {
+                result.emplace_back(SHA1Hash::move_from(std::move(out[lane])));
+            }
+        }
+    }
+    // Tail is processed by single-buffer implementation
+    return util::reduce(jobs.begin() + num_multi, jobs.end(), [&](const HMACSHA1Job& job) -> MaybeError {
+            return job.key.get().digest(job.data)
+                .bind([&](auto&& digest) -> MaybeError {
+                    result.emplace_back(std::move(digest));
+                    return success();
+                });
+        })
+        .fmap([&](auto&&) {
+            return std::move(result);
+        });
+}
+
+Result<std::vector<hmac::Digest<SHA1Hash>>> hmac_sha1_multi(std::span<const HMACSHA1Job> jobs) {
+    static const MultiImpl best = best_multi_impl();
+    return hmac_sha1_multi(jobs, best);
+}
+
+}
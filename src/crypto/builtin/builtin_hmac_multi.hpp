@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Multi-buffer HMAC-SHA1: calculates HMACs of independent
+// messages in parallel (one message per SIMD lane).
+//
+
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "crypto/crypto_hmac.hpp"
+
+namespace freewebrtc::crypto::builtin {
+
+struct HMACSHA1Job {
+    std::reference_wrapper<const hmac::SHA1PrecomputedKey> key;
+    // Views list must outlive the job.
+    SHA1Hash::Input data;
+};
+
+enum class MultiImpl {
+    single,             // One message at a time (SHA1PrecomputedKey::digest)
+    lanes4,             // 4 lanes (SSE2 / NEON)
+    lanes8_avx2,        // 8 lanes (AVX2)
+    lanes16_avx512      // 16 lanes (AVX-512F)
+};
+
+bool is_supported(MultiImpl);
+MultiImpl best_multi_impl();
+size_t lanes(MultiImpl);
+
+// Calculate HMAC-SHA1 for each job. Jobs are processed by groups
+// of lanes(impl) messages. Messages that do not fill whole group
+// are processed one by one. Results are in order of jobs.
+// Implementation must be supported by CPU.
+Result<std::vector<hmac::Digest<SHA1Hash>>> hmac_sha1_multi(std::span<const HMACSHA1Job>, MultiImpl);
+// Same as above with best implementation supported by CPU.
+Result<std::vector<hmac::Digest<SHA1Hash>>> hmac_sha1_multi(std::span<const HMACSHA1Job>);
+
+}
@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// SHA-1 compression functions (FIPS 180-4)
+//
+
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "crypto/builtin/details/builtin_compress.hpp"
+
+namespace freewebrtc::crypto::builtin::details {
+
+namespace {
+
+uint32_t read_u32be(const uint8_t *p) {
+    return (uint32_t(p[0]) << 24)
+        | (uint32_t(p[1]) << 16)
+        | (uint32_t(p[2]) << 8)
+        | uint32_t(p[3]);
+}
+
+void sha1_compress_scalar(SHA1Words& h, const uint8_t *data, size_t num_blocks) {
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        uint32_t w[80];
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = read_u32be(data + 4 * i);
+        }
+        for (size_t i = 16; i < 80; ++i) {
+            w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (size_t i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            const uint32_t t = std::rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+}
+
+#if defined(__x86_64__)
+
+// Four rounds (group g of 20) with message schedule update.
+// MSG[g % 4] holds W[4g..4g+3]. Message words of the next groups
+// are calculated in-place by sha1msg1 / sha1msg2 / xor.
+#define FREEWEBRTC_SHA1_X86_GROUP(g)                            \
+    E[(g) % 2] = _mm_sha1nexte_epu32(E[(g) % 2], MSG[(g) % 4]);         \
+    E[((g) + 1) % 2] = ABCD;                                            \
+    MSG[((g) + 1) % 4] = _mm_sha1msg2_epu32(MSG[((g) + 1) % 4], MSG[(g) % 4]); \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E[(g) % 2], (g) / 5);              \
+    MSG[((g) + 3) % 4] = _mm_sha1msg1_epu32(MSG[((g) + 3) % 4], MSG[(g) % 4]); \
+    MSG[((g) + 2) % 4] = _mm_xor_si128(MSG[((g) + 2) % 4], MSG[(g) % 4])
+
+__attribute__((target("sha,sse4.1")))
+__m128i load_be(const uint8_t *p) {
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), mask);
+}
+
+// Based on Intel SHA extensions reference code.
+__attribute__((target("sha,sse4.1")))
+void sha1_compress_x86(SHA1Words& h, const uint8_t *data, size_t num_blocks) {
+    __m128i ABCD = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h.data()));
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1b);
+    __m128i E[2] = { _mm_set_epi32(int(h[4]), 0, 0, 0), _mm_setzero_si128() };
+    __m128i MSG[4];
+
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        const __m128i ABCD_SAVE = ABCD;
+        const __m128i E_SAVE = E[0];
+
+        // Rounds 0-3
+        MSG[0] = load_be(data);
+        E[0] = _mm_add_epi32(E[0], MSG[0]);
+        E[1] = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[0], 0);
+
+        // Rounds 4-7
+        MSG[1] = load_be(data + 16);
+        E[1] = _mm_sha1nexte_epu32(E[1], MSG[1]);
+        E[0] = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[1], 0);
+        MSG[0] = _mm_sha1msg1_epu32(MSG[0], MSG[1]);
+
+        // Rounds 8-11
+        MSG[2] = load_be(data + 32);
+        E[0] = _mm_sha1nexte_epu32(E[0], MSG[2]);
+        E[1] = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[0], 0);
+        MSG[1] = _mm_sha1msg1_epu32(MSG[1], MSG[2]);
+        MSG[0] = _mm_xor_si128(MSG[0], MSG[2]);
+
+        // Rounds 12-67
+        MSG[3] = load_be(data + 48);
+        FREEWEBRTC_SHA1_X86_GROUP(3);
+        FREEWEBRTC_SHA1_X86_GROUP(4);
+        FREEWEBRTC_SHA1_X86_GROUP(5);
+        FREEWEBRTC_SHA1_X86_GROUP(6);
+        FREEWEBRTC_SHA1_X86_GROUP(7);
+        FREEWEBRTC_SHA1_X86_GROUP(8);
+        FREEWEBRTC_SHA1_X86_GROUP(9);
+        FREEWEBRTC_SHA1_X86_GROUP(10);
+        FREEWEBRTC_SHA1_X86_GROUP(11);
+        FREEWEBRTC_SHA1_X86_GROUP(12);
+        FREEWEBRTC_SHA1_X86_GROUP(13);
+        FREEWEBRTC_SHA1_X86_GROUP(14);
+        FREEWEBRTC_SHA1_X86_GROUP(15);
+        FREEWEBRTC_SHA1_X86_GROUP(16);
+
+        // Rounds 68-71
+        E[1] = _mm_sha1nexte_epu32(E[1], MSG[1]);
+        E[0] = ABCD;
+        MSG[2] = _mm_sha1msg2_epu32(MSG[2], MSG[1]);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[1], 3);
+        MSG[3] = _mm_xor_si128(MSG[3], MSG[1]);
+
+        // Rounds 72-75
+        E[0] = _mm_sha1nexte_epu32(E[0], MSG[2]);
+        E[1] = ABCD;
+        MSG[3] = _mm_sha1msg2_epu32(MSG[3], MSG[2]);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[0], 3);
+
+        // Rounds 76-79
+        E[1] = _mm_sha1nexte_epu32(E[1], MSG[3]);
+        E[0] = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E[1], 3);
+
+        E[0] = _mm_sha1nexte_epu32(E[0], E_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1b);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h.data()), ABCD);
+    h[4] = uint32_t(_mm_extract_epi32(E[0], 3));
+}
+
+#undef FREEWEBRTC_SHA1_X86_GROUP
+
+#endif
+
+#if defined(__aarch64__)
+
+__attribute__((target("+sha2")))
+void sha1_compress_armv8(SHA1Words& h, const uint8_t *data, size_t num_blocks) {
+    static const uint32_t K[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+    uint32x4_t ABCD = vld1q_u32(h.data());
+    uint32_t E = h[4];
+
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        uint32x4_t W[20];
+        for (size_t i = 0; i < 4; ++i) {
+            W[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+        for (size_t i = 4; i < 20; ++i) {
+            W[i] = vsha1su1q_u32(vsha1su0q_u32(W[i - 4], W[i - 3], W[i - 2]), W[i - 1]);
+        }
+        uint32x4_t abcd = ABCD;
+        uint32_t e = E;
+        for (size_t i = 0; i < 20; ++i) {
+            const uint32x4_t wk = vaddq_u32(W[i], vdupq_n_u32(K[i / 5]));
+            const uint32_t next_e = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+            if (i < 5) {
+                abcd = vsha1cq_u32(abcd, e, wk);
+            } else if (i >= 10 && i < 15) {
+                abcd = vsha1mq_u32(abcd, e, wk);
+            } else {
+                abcd = vsha1pq_u32(abcd, e, wk);
+            }
+            e = next_e;
+        }
+        ABCD = vaddq_u32(ABCD, abcd);
+        E += e;
+    }
+
+    vst1q_u32(h.data(), ABCD);
+    h[4] = E;
+}
+
+#endif
+
+}
+
+SHA1Compress sha1_compress(Impl impl) {
+    switch (impl) {
+    case Impl::scalar:
+        return &sha1_compress_scalar;
+    case Impl::x86_sha:
+#if defined(__x86_64__)
+        return &sha1_compress_x86;
+#else
+        break;
+#endif
+    case Impl::armv8_sha:
+#if defined(__aarch64__)
+        return &sha1_compress_armv8;
+#else
+        break;
+#endif
+    }
+    return &sha1_compress_scalar;
+}
+
+}
@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// SHA-256 compression functions (FIPS 180-4)
+//
+
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "crypto/builtin/details/builtin_compress.hpp"
+
+namespace freewebrtc::crypto::builtin::details {
+
+namespace {
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+uint32_t read_u32be(const uint8_t *p) {
+    return (uint32_t(p[0]) << 24)
+        | (uint32_t(p[1]) << 16)
+        | (uint32_t(p[2]) << 8)
+        | uint32_t(p[3]);
+}
+
+void sha256_compress_scalar(SHA256Words& h, const uint8_t *data, size_t num_blocks) {
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        uint32_t w[64];
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = read_u32be(data + 4 * i);
+        }
+        for (size_t i = 16; i < 64; ++i) {
+            const uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (size_t i = 0; i < 64; ++i) {
+            const uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+            const uint32_t ch = (e & f) ^ (~e & g);
+            const uint32_t t1 = hh + s1 + ch + K[i] + w[i];
+            const uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+            const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            const uint32_t t2 = s0 + maj;
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+    }
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sha,sse4.1")))
+__m128i load_be(const uint8_t *p) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), mask);
+}
+
+// Four rounds (group g of 16): two sha256rnds2 with W[4g..4g+3] + K
+__attribute__((target("sha,sse4.1")))
+void rounds4(__m128i& STATE0, __m128i& STATE1, __m128i msg, size_t g) {
+    __m128i wk = _mm_add_epi32(msg, _mm_load_si128(reinterpret_cast<const __m128i *>(K + 4 * g)));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, wk);
+    wk = _mm_shuffle_epi32(wk, 0x0e);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, wk);
+}
+
+// Based on Intel SHA extensions reference code.
+__attribute__((target("sha,sse4.1")))
+void sha256_compress_x86(SHA256Words& h, const uint8_t *data, size_t num_blocks) {
+    __m128i TMP = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h.data()));
+    __m128i STATE1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h.data() + 4));
+    TMP = _mm_shuffle_epi32(TMP, 0xb1);                // CDAB
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1b);          // EFGH
+    __m128i STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);  // ABEF
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xf0);       // CDGH
+
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        const __m128i ABEF_SAVE = STATE0;
+        const __m128i CDGH_SAVE = STATE1;
+        // MSG[g % 4] holds W[4g..4g+3]
+        __m128i MSG[4];
+        for (size_t g = 0; g < 4; ++g) {
+            MSG[g] = load_be(data + 16 * g);
+        }
+        for (size_t g = 0; g < 16; ++g) {
+            rounds4(STATE0, STATE1, MSG[g % 4], g);
+            if (g >= 3 && g < 15) {
+                // W[4(g+1)..]: finish schedule started by sha256msg1
+                __m128i& next = MSG[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(MSG[g % 4], MSG[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, MSG[g % 4]);
+            }
+            if (g >= 1 && g < 13) {
+                __m128i& prev = MSG[(g + 3) % 4];
+                prev = _mm_sha256msg1_epu32(prev, MSG[g % 4]);
+            }
+        }
+        STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+        STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+    }
+
+    TMP = _mm_shuffle_epi32(STATE0, 0x1b);             // FEBA
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xb1);          // DCHG
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xf0);       // DCBA
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);          // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h.data()), STATE0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h.data() + 4), STATE1);
+}
+
+#endif
+
+#if defined(__aarch64__)
+
+__attribute__((target("+sha2")))
+void sha256_compress_armv8(SHA256Words& h, const uint8_t *data, size_t num_blocks) {
+    uint32x4_t STATE0 = vld1q_u32(h.data());
+    uint32x4_t STATE1 = vld1q_u32(h.data() + 4);
+
+    for (; num_blocks > 0; --num_blocks, data += 64) {
+        uint32x4_t MSG[4];
+        for (size_t i = 0; i < 4; ++i) {
+            MSG[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+        uint32x4_t abcd = STATE0;
+        uint32x4_t efgh = STATE1;
+        for (size_t g = 0; g < 16; ++g) {
+            const uint32x4_t wk = vaddq_u32(MSG[g % 4], vld1q_u32(K + 4 * g));
+            const uint32x4_t prev_abcd = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, prev_abcd, wk);
+            if (g < 12) {
+                MSG[g % 4] = vsha256su1q_u32(vsha256su0q_u32(MSG[g % 4], MSG[(g + 1) % 4]),
+                                             MSG[(g + 2) % 4], MSG[(g + 3) % 4]);
+            }
+        }
+        STATE0 = vaddq_u32(STATE0, abcd);
+        STATE1 = vaddq_u32(STATE1, efgh);
+    }
+
+    vst1q_u32(h.data(), STATE0);
+    vst1q_u32(h.data() + 4, STATE1);
+}
+
+#endif
+
+}
+
+SHA256Compress sha256_compress(Impl impl) {
+    switch (impl) {
+    case Impl::scalar:
+        return &sha256_compress_scalar;
+    case Impl::x86_sha:
+#if defined(__x86_64__)
+        return &sha256_compress_x86;
+#else
+        break;
+#endif
+    case Impl::armv8_sha:
+#if defined(__aarch64__)
+        return &sha256_compress_armv8;
+#else
+        break;
+#endif
+    }
+    return &sha256_compress_scalar;
+}
+
+}
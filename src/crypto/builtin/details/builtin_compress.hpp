@@ -0,0 +1,37 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// SHA-1 / SHA-256 compression functions
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "crypto/builtin/builtin_hash.hpp"
+
+namespace freewebrtc::crypto::builtin::details {
+
+using SHA1Words = std::array<uint32_t, 5>;
+using SHA256Words = std::array<uint32_t, 8>;
+
+using SHA1Compress = void (*)(SHA1Words&, const uint8_t *blocks, size_t num_blocks);
+using SHA256Compress = void (*)(SHA256Words&, const uint8_t *blocks, size_t num_blocks);
+
+static constexpr SHA1Words SHA1_INIT = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static constexpr SHA256Words SHA256_INIT = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Implementation must be supported by CPU.
+SHA1Compress sha1_compress(Impl);
+SHA256Compress sha256_compress(Impl);
+
+}
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Merkle-Damgard construction for SHA-1 / SHA-256
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "util/util_binary_view.hpp"
+
+namespace freewebrtc::crypto::builtin::details {
+
+// Buffers input and feeds whole 64-byte blocks to compression
+// function. Finalization uses SHA padding (0x80, zeroes, 64-bit
+// big-endian length in bits).
+template<typename Words>
+class MDEngine {
+public:
+    static constexpr size_t block_size = 64;
+    static constexpr size_t digest_size = sizeof(typename Words::value_type) * std::tuple_size_v<Words>;
+    using Compress = void (*)(Words&, const uint8_t *blocks, size_t num_blocks);
+    using Digest = std::array<uint8_t, digest_size>;
+
+    // length - number of bytes that are already processed
+    // in words (must be multiple of block_size).
+    MDEngine(Compress, const Words&, uint64_t length = 0) noexcept;
+
+    void update(const util::ConstBinaryView&) noexcept;
+    Digest finalize() noexcept;
+
+private:
+    Compress m_compress;
+    Words m_words;
+    uint64_t m_length;
+    std::array<uint8_t, block_size> m_buffer;
+    size_t m_buffer_size = 0;
+};
+
+//
+// inlines
+//
+template<typename Words>
+inline MDEngine<Words>::MDEngine(Compress compress, const Words& words, uint64_t length) noexcept
+    : m_compress(compress)
+    , m_words(words)
+    , m_length(length)
+{}
+
+template<typename Words>
+inline void MDEngine<Words>::update(const util::ConstBinaryView& vv) noexcept {
+    const uint8_t *data = vv.data();
+    size_t size = vv.size();
+    m_length += size;
+    if (m_buffer_size > 0) {
+        const size_t n = std::min(size, block_size - m_buffer_size);
+        std::memcpy(m_buffer.data() + m_buffer_size, data, n);
+        m_buffer_size += n;
+        data += n;
+        size -= n;
+        if (m_buffer_size < block_size) {
+            return;
+        }
+        m_compress(m_words, m_buffer.data(), 1);
+        m_buffer_size = 0;
+    }
+    const size_t num_blocks = size / block_size;
+    if (num_blocks > 0) {
+        m_compress(m_words, data, num_blocks);
+        data += num_blocks * block_size;
+        size -= num_blocks * block_size;
+    }
+    if (size > 0) {
+        std::memcpy(m_buffer.data(), data, size);
+        m_buffer_size = size;
+    }
+}
+
+template<typename Words>
+inline typename MDEngine<Words>::Digest MDEngine<Words>::finalize() noexcept {
+    constexpr size_t length_offset = block_size - sizeof(uint64_t);
+    const uint64_t bits = m_length << 3;
+    m_buffer[m_buffer_size++] = 0x80;
+    if (m_buffer_size > length_offset) {
+        std::memset(m_buffer.data() + m_buffer_size, 0, block_size - m_buffer_size);
+        m_compress(m_words, m_buffer.data(), 1);
+        m_buffer_size = 0;
+    }
+    std::memset(m_buffer.data() + m_buffer_size, 0, length_offset - m_buffer_size);
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        m_buffer[length_offset + i] = uint8_t(bits >> (56 - 8 * i));
+    }
+    m_compress(m_words, m_buffer.data(), 1);
+    m_buffer_size = 0;
+
+    Digest result;
+    for (size_t i = 0; i < m_words.size(); ++i) {
+        result[4 * i + 0] = uint8_t(m_words[i] >> 24);
+        result[4 * i + 1] = uint8_t(m_words[i] >> 16);
+        result[4 * i + 2] = uint8_t(m_words[i] >> 8);
+        result[4 * i + 3] = uint8_t(m_words[i]);
+    }
+    return result;
+}
+
+}
@@ -12,8 +12,11 @@
 
 #include <vector>
 #include <array>
+#include <span>
+#include <initializer_list>
 #include <system_error>
 #include <functional>
+#include <type_traits>
 
 #include "util/util_binary_view.hpp"
 #include "util/util_result.hpp"
@@ -21,13 +24,69 @@
 
 namespace freewebrtc::crypto {
 
+// Non-owning list of views that are hashed one after another.
+// Views may be followed by views of another input (e.g. HMAC
+// prepends ipad without copying of the list).
+// Input must not outlive views that it refers to. In particular,
+// input created from braced list is valid only until the end of
+// full expression (so it is ok only as function argument).
+class HashInput {
+public:
+    using View = util::ConstBinaryView;
+    class Iterator;
+
+    HashInput(std::initializer_list<View>) noexcept;
+    HashInput(const std::vector<View>&) noexcept;
+    template<size_t N>
+    HashInput(const std::array<View, N>&) noexcept;
+    HashInput(std::span<const View>) noexcept;
+    // One view followed by views of the rest. Both are referred
+    // by the input so temporaries are not accepted.
+    HashInput(const View& first, const HashInput& rest) noexcept;
+    HashInput(View&&, const HashInput&) = delete;
+    HashInput(const View&, HashInput&&) = delete;
+    HashInput(View&&, HashInput&&) = delete;
+
+    Iterator begin() const noexcept;
+    Iterator end() const noexcept;
+    // Number of views
+    size_t size() const noexcept;
+
+private:
+    std::span<const View> m_views;
+    const HashInput *m_next = nullptr;
+};
+
+class HashInput::Iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = View;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const View *;
+    using reference = const View&;
+
+    Iterator() = default;
+    Iterator(const HashInput *, size_t) noexcept;
+    reference operator*() const noexcept;
+    pointer operator->() const noexcept;
+    Iterator& operator++() noexcept;
+    Iterator operator++(int) noexcept;
+    bool operator==(const Iterator&) const noexcept = default;
+
+private:
+    void skip_empty() noexcept;
+    const HashInput *m_input = nullptr;
+    size_t m_index = 0;
+};
+
 template<typename TagType, size_t SIZE>
 class Hash {
 public:
     using Tag = TagType;
     using Value = std::array<uint8_t, SIZE>;
-    using Input = std::vector<util::ConstBinaryView>;
+    using Input = HashInput;
     using Result = ::freewebrtc::Result<Hash>;
+    // Run-time hash provider (see HashProvider)
     using Func = std::function<Result(const Input&)>;
 
     static constexpr auto size = SIZE;
@@ -58,9 +117,94 @@ using MD5Hash = Hash<MD5HashTag, 16>;
 using SHA1Hash = Hash<SHA1HashTag, 20>;
 using SHA256Hash = Hash<SHA256HashTag, 32>;
 
+// Compile-time hash provider: any callable that calculates hash
+// of the input (e.g. crypto::openssl::sha1). Algorithms that are
+// templated on provider call it directly, Hash::Func adapts any
+// provider to run-time dispatch.
+template<typename Provider, typename HashT>
+concept HashProvider = std::is_invocable_r_v<typename HashT::Result, const Provider&, const HashInput&>;
+
+// Hash type calculated by provider
+template<typename Provider>
+using ProviderHash = typename std::invoke_result_t<const Provider&, const HashInput&>::Value;
+
 //
 // implementation
 //
+inline HashInput::HashInput(std::initializer_list<View> views) noexcept
+    : m_views(views.begin(), views.size())
+{}
+
+inline HashInput::HashInput(const std::vector<View>& views) noexcept
+    : m_views(views)
+{}
+
+template<size_t N>
+inline HashInput::HashInput(const std::array<View, N>& views) noexcept
+    : m_views(views)
+{}
+
+inline HashInput::HashInput(std::span<const View> views) noexcept
+    : m_views(views)
+{}
+
+inline HashInput::HashInput(const View& first, const HashInput& rest) noexcept
+    : m_views(&first, 1)
+    , m_next(&rest)
+{}
+
+inline HashInput::Iterator HashInput::begin() const noexcept {
+    return Iterator(this, 0);
+}
+
+inline HashInput::Iterator HashInput::end() const noexcept {
+    return Iterator();
+}
+
+inline size_t HashInput::size() const noexcept {
+    size_t result = 0;
+    for (auto input = this; input != nullptr; input = input->m_next) {
+        result += input->m_views.size();
+    }
+    return result;
+}
+
+inline HashInput::Iterator::Iterator(const HashInput *input, size_t index) noexcept
+    : m_input(input)
+    , m_index(index)
+{
+    skip_empty();
+}
+
+inline HashInput::Iterator::reference HashInput::Iterator::operator*() const noexcept {
+    return m_input->m_views[m_index];
+}
+
+inline HashInput::Iterator::pointer HashInput::Iterator::operator->() const noexcept {
+    return &m_input->m_views[m_index];
+}
+
+inline HashInput::Iterator& HashInput::Iterator::operator++() noexcept {
+    ++m_index;
+    skip_empty();
+    return *this;
+}
+
+inline HashInput::Iterator HashInput::Iterator::operator++(int) noexcept {
+    Iterator result = *this;
+    ++*this;
+    return result;
+}
+
+inline void HashInput::Iterator::skip_empty() noexcept {
+    // Move to the next input when views of current one are over.
+    // End iterator has no input.
+    while (m_input != nullptr && m_index == m_input->m_views.size()) {
+        m_input = m_input->m_next;
+        m_index = 0;
+    }
+}
+
 template<typename TagType, size_t SIZE>
 Maybe<Hash<TagType, SIZE>> Hash<TagType, SIZE>::from_view(const util::ConstBinaryView& vv) {
     if (vv.size() != size) {
@@ -16,6 +16,7 @@
 #include "util/util_result.hpp"
 #include "util/util_flat.hpp"
 #include "crypto/crypto_hash.hpp"
+#include "crypto/crypto_sha1_state.hpp"
 
 namespace freewebrtc::crypto::hmac {
 
@@ -46,10 +47,32 @@ template<typename Hash>
 using Digest = util::TaggedType<Hash>;
 
 template<typename HashFunc>
-using HMACResult = Result<Digest<typename HashFunc::result_type::Value>>;
+using HMACResult = Result<Digest<ProviderHash<HashFunc>>>;
 
+// HashFunc is hash provider (see crypto::HashProvider). If it is
+// known at compile time (e.g. function) then it is called directly.
 template<typename HashFunc>
-HMACResult<HashFunc> digest(const std::vector<util::ConstBinaryView>& data, const OPadKey& opad, const IPadKey& ipad, HashFunc h);
+requires HashProvider<HashFunc, ProviderHash<HashFunc>>
+HMACResult<HashFunc> digest(const HashInput& data, const OPadKey& opad, const IPadKey& ipad, const HashFunc& h);
+
+// HMAC-SHA1 key with cached SHA-1 states after ipad and opad
+// blocks. It saves two SHA-1 block calculations per digest.
+class SHA1PrecomputedKey {
+public:
+    static Result<SHA1PrecomputedKey> from_pads(const IPadKey&, const OPadKey&, const SHA1Resumable&);
+
+    Result<Digest<SHA1Hash>> digest(const SHA1Hash::Input&) const;
+    // SHA-1 states after ipad / opad blocks
+    const SHA1State& inner() const noexcept;
+    const SHA1State& outer() const noexcept;
+
+    bool operator==(const SHA1PrecomputedKey&) const noexcept;
+private:
+    SHA1PrecomputedKey(const SHA1State& inner, const SHA1State& outer, const SHA1Resumable::Finish&);
+    SHA1State m_inner;
+    SHA1State m_outer;
+    SHA1Resumable::Finish m_finish;
+};
 
 //
 // implementation
@@ -90,20 +113,49 @@ inline util::ConstBinaryView PadKey<xorv>::view() const noexcept {
 }
 
 template<typename HashFunc>
-HMACResult<HashFunc> digest(const std::vector<util::ConstBinaryView>& data, const OPadKey& opad, const IPadKey& ipad, HashFunc h) {
-    using HashFuncInput = std::vector<util::ConstBinaryView>;
-    HashFuncInput inner_data = {ipad.view()};
-    inner_data.reserve(data.size() + 1);
-    std::copy(data.begin(), data.end(), std::back_inserter(inner_data));
-    using HashFuncResult = std::invoke_result_t<HashFunc, HashFuncInput>;
-    using HashValue = typename HashFuncResult::Value;
-    using ResultT = typename HMACResult<HashFunc>::Value;
-    return h(inner_data)
+requires HashProvider<HashFunc, ProviderHash<HashFunc>>
+HMACResult<HashFunc> digest(const HashInput& data, const OPadKey& opad, const IPadKey& ipad, const HashFunc& h) {
+    using HashValue = ProviderHash<HashFunc>;
+    const auto ipad_view = ipad.view();
+    return h(HashInput(ipad_view, data))
         .bind([&](HashValue&& inner) {
-            // TODO: is result of inner.view is valid after exit from this function?
             return h({opad.view(), inner.view()});
         })
-        .fmap(ResultT::move_from);
+        .fmap(Digest<HashValue>::move_from);
+}
+
+inline SHA1PrecomputedKey::SHA1PrecomputedKey(const SHA1State& inner, const SHA1State& outer, const SHA1Resumable::Finish& finish)
+    : m_inner(inner)
+    , m_outer(outer)
+    , m_finish(finish)
+{}
+
+inline Result<SHA1PrecomputedKey> SHA1PrecomputedKey::from_pads(const IPadKey& ipad, const OPadKey& opad, const SHA1Resumable& sha1) {
+    return combine([&](SHA1State&& inner, SHA1State&& outer) -> Result<SHA1PrecomputedKey> {
+            return SHA1PrecomputedKey(inner, outer, sha1.finish);
+        },
+        sha1.start(ipad.view()),
+        sha1.start(opad.view()));
+}
+
+inline Result<Digest<SHA1Hash>> SHA1PrecomputedKey::digest(const SHA1Hash::Input& data) const {
+    return m_finish(m_inner, data)
+        .bind([&](SHA1Hash&& inner) {
+            return m_finish(m_outer, {inner.view()});
+        })
+        .fmap(Digest<SHA1Hash>::move_from);
+}
+
+inline const SHA1State& SHA1PrecomputedKey::inner() const noexcept {
+    return m_inner;
+}
+
+inline const SHA1State& SHA1PrecomputedKey::outer() const noexcept {
+    return m_outer;
+}
+
+inline bool SHA1PrecomputedKey::operator==(const SHA1PrecomputedKey& other) const noexcept {
+    return m_inner == other.m_inner && m_outer == other.m_outer;
 }
 
 }
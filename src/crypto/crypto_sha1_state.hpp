@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Resumable SHA-1 state
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+#include "util/util_binary_view.hpp"
+#include "util/util_result.hpp"
+#include "crypto/crypto_hash.hpp"
+
+namespace freewebrtc::crypto {
+
+// Internal state of SHA-1 after processing of whole number
+// of blocks. Hashing may be resumed from this state without
+// processing of the prefix again (e.g. HMAC ipad / opad blocks).
+struct SHA1State {
+    static constexpr size_t block_size = 64;
+    std::array<uint32_t, 5> h;
+    // Number of processed bytes (multiple of block_size)
+    uint64_t length;
+
+    bool operator==(const SHA1State&) const noexcept = default;
+};
+
+// Resumable SHA-1 implementation.
+struct SHA1Resumable {
+    // Process data of size multiple of SHA1State::block_size
+    // from initial SHA-1 state.
+    using Start = std::function<Result<SHA1State>(const util::ConstBinaryView&)>;
+    // Process input starting from the state and finalize hash.
+    using Finish = std::function<SHA1Hash::Result(const SHA1State&, const SHA1Hash::Input&)>;
+    Start start;
+    Finish finish;
+};
+
+}
@@ -6,8 +6,13 @@
 // OpenSSL implementation for hash functions
 //
 
+// SHA1_* functions are used to access internal SHA-1 state.
+// They are deprecated in OpenSSL 3.0 but there is no replacement.
+#define OPENSSL_SUPPRESS_DEPRECATED
+
 #include <openssl/evp.h>
 #include <openssl/err.h>
+#include <openssl/sha.h>
 #include <memory>
 
 #include "util/util_result.hpp"
@@ -17,6 +22,8 @@
 
 namespace freewebrtc::crypto::openssl {
 
+// Calculates digest using context that is created once per
+// thread and reinitialized by EVP_DigestInit_ex for each digest.
 class MessageDigest {
 public:
     explicit MessageDigest(const EVP_MD *md);
@@ -30,26 +37,111 @@ private:
     template<typename Hash>
     typename Hash::Result finalize();
 
-    using EVPMDContextPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
-    EVPMDContextPtr m_ctx;
+    static EVP_MD_CTX *thread_context();
+
+    EVP_MD_CTX * const m_ctx;
     const EVP_MD * const m_md;
 };
 
+namespace {
+
+// Digest algorithm is looked up once. With OpenSSL 3 explicitly
+// fetched algorithm also saves implicit fetch from provider in
+// each EVP_DigestInit_ex.
+const EVP_MD *fetch_md([[maybe_unused]] const char *name, const EVP_MD *legacy) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    // Fetched algorithm is kept until exit.
+    if (EVP_MD *md = EVP_MD_fetch(nullptr, name, nullptr); md != nullptr) {
+        return md;
+    }
+#endif
+    return legacy;
+}
+
+const EVP_MD *sha1_md() {
+    static const EVP_MD *md = fetch_md("SHA1", EVP_sha1());
+    return md;
+}
+
+const EVP_MD *sha256_md() {
+    static const EVP_MD *md = fetch_md("SHA256", EVP_sha256());
+    return md;
+}
+
+const EVP_MD *md5_md() {
+    static const EVP_MD *md = fetch_md("MD5", EVP_md5());
+    return md;
+}
+
+}
+
 
 crypto::SHA1Hash::Result sha1(const crypto::SHA1Hash::Input& input) {
-    return MessageDigest(EVP_sha1()).calc<crypto::SHA1Hash>(input);
+    return MessageDigest(sha1_md()).calc<crypto::SHA1Hash>(input);
+}
+
+crypto::SHA256Hash::Result sha256(const crypto::SHA256Hash::Input& input) {
+    return MessageDigest(sha256_md()).calc<crypto::SHA256Hash>(input);
 }
 
 crypto::MD5Hash::Result md5(const crypto::MD5Hash::Input& input) {
-    return MessageDigest(EVP_md5()).calc<crypto::MD5Hash>(input);
+    return MessageDigest(md5_md()).calc<crypto::MD5Hash>(input);
+}
+
+Result<crypto::SHA1State> sha1_start(const util::ConstBinaryView& data) {
+    if (data.size() % crypto::SHA1State::block_size != 0) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    SHA_CTX ctx;
+    ERR_clear_error();
+    if (SHA1_Init(&ctx) != 1 || SHA1_Update(&ctx, data.data(), data.size()) != 1) {
+        return make_error_code(ERR_get_error());
+    }
+    return crypto::SHA1State{{ctx.h0, ctx.h1, ctx.h2, ctx.h3, ctx.h4}, data.size()};
+}
+
+crypto::SHA1Hash::Result sha1_finish(const crypto::SHA1State& state, const crypto::SHA1Hash::Input& input) {
+    SHA_CTX ctx;
+    ERR_clear_error();
+    if (SHA1_Init(&ctx) != 1) {
+        return make_error_code(ERR_get_error());
+    }
+    ctx.h0 = state.h[0];
+    ctx.h1 = state.h[1];
+    ctx.h2 = state.h[2];
+    ctx.h3 = state.h[3];
+    ctx.h4 = state.h[4];
+    // Length in bits
+    ctx.Nl = static_cast<SHA_LONG>(state.length << 3);
+    ctx.Nh = static_cast<SHA_LONG>(state.length >> 29);
+    for (const auto& v: input) {
+        if (SHA1_Update(&ctx, v.data(), v.size()) != 1) {
+            return make_error_code(ERR_get_error());
+        }
+    }
+    crypto::SHA1Hash::Value v;
+    if (SHA1_Final(v.data(), &ctx) != 1) {
+        return make_error_code(ERR_get_error());
+    }
+    return crypto::SHA1Hash::move_from(std::move(v));
+}
+
+crypto::SHA1Resumable sha1_resumable() {
+    return crypto::SHA1Resumable{sha1_start, sha1_finish};
 }
 
 // MessageDigest implementation
 MessageDigest::MessageDigest(const EVP_MD *md)
-    : m_ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free)
+    : m_ctx(thread_context())
     , m_md(md)
 {}
 
+EVP_MD_CTX *MessageDigest::thread_context() {
+    using EVPMDContextPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+    thread_local EVPMDContextPtr ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+    return ctx.get();
+}
+
 template<typename Hash>
 typename Hash::Result MessageDigest::calc(const typename Hash::Input& input) {
     return init()
@@ -68,7 +160,7 @@ MaybeError MessageDigest::init() {
         return std::make_error_code(std::errc::not_enough_memory);
     }
     ERR_clear_error();
-    if (EVP_DigestInit_ex(m_ctx.get(), m_md, NULL) != 1) {
+    if (EVP_DigestInit_ex(m_ctx, m_md, NULL) != 1) {
         return make_error_code(ERR_get_error());
     }
     return success();
@@ -76,7 +168,7 @@ MaybeError MessageDigest::init() {
 
 MaybeError MessageDigest::update(const util::ConstBinaryView& view) {
     ERR_clear_error();
-    if (EVP_DigestUpdate(m_ctx.get(), view.data(), view.size()) != 1) {
+    if (EVP_DigestUpdate(m_ctx, view.data(), view.size()) != 1) {
         return make_error_code(ERR_get_error());
     }
     return success();
@@ -86,7 +178,7 @@ template<typename Hash>
 typename Hash::Result MessageDigest::finalize() {
     typename Hash::Value v;
     ERR_clear_error();
-    if (EVP_DigestFinal_ex(m_ctx.get(), v.data(), NULL) != 1) {
+    if (EVP_DigestFinal_ex(m_ctx, v.data(), NULL) != 1) {
         return make_error_code(ERR_get_error());
     }
     return Hash::move_from(std::move(v));
@@ -9,12 +9,19 @@
 #pragma once
 
 #include "crypto/crypto_hash.hpp"
+#include "crypto/crypto_sha1_state.hpp"
 
 namespace freewebrtc::crypto::openssl {
 
 crypto::SHA1Hash::Result sha1(const crypto::SHA1Hash::Input&);
+crypto::SHA256Hash::Result sha256(const crypto::SHA256Hash::Input&);
 crypto::MD5Hash::Result md5(const crypto::MD5Hash::Input&);
 
+// Resumable SHA-1 (see crypto::SHA1Resumable)
+Result<crypto::SHA1State> sha1_start(const util::ConstBinaryView&);
+crypto::SHA1Hash::Result sha1_finish(const crypto::SHA1State&, const crypto::SHA1Hash::Input&);
+crypto::SHA1Resumable sha1_resumable();
+
 }
 
 
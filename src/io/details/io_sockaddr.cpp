@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Conversion between network endpoints and socket addresses
+//
+
+#include <arpa/inet.h>
+#include <cstring>
+
+#include "io/details/io_sockaddr.hpp"
+#include "util/util_variant_overloaded.hpp"
+
+namespace freewebrtc::io::details {
+
+socklen_t to_sockaddr(const net::UdpEndpoint& ep, sockaddr_storage& storage) noexcept {
+    std::memset(&storage, 0, sizeof(storage));
+    const auto addr = ep.address.view();
+    return std::visit(
+        util::overloaded {
+            [&](const net::ip::AddressV4&) {
+                auto& sin = reinterpret_cast<sockaddr_in&>(storage);
+                sin.sin_family = AF_INET;
+                sin.sin_port = htons(ep.port.value());
+                std::memcpy(&sin.sin_addr, addr.data(), addr.size());
+                return socklen_t(sizeof(sin));
+            },
+            [&](const net::ip::AddressV6&) {
+                auto& sin6 = reinterpret_cast<sockaddr_in6&>(storage);
+                sin6.sin6_family = AF_INET6;
+                sin6.sin6_port = htons(ep.port.value());
+                std::memcpy(&sin6.sin6_addr, addr.data(), addr.size());
+                return socklen_t(sizeof(sin6));
+            }
+        },
+        ep.address.value());
+}
+
+Maybe<net::UdpEndpoint> from_sockaddr(const sockaddr_storage& storage) noexcept {
+    switch (storage.ss_family) {
+    case AF_INET: {
+        const auto& sin = reinterpret_cast<const sockaddr_in&>(storage);
+        return net::UdpEndpoint{
+            net::ip::AddressV4::from_view(util::ConstBinaryView(&sin.sin_addr, sizeof(sin.sin_addr))).unwrap(),
+            net::Port(ntohs(sin.sin_port))
+        };
+    }
+    case AF_INET6: {
+        const auto& sin6 = reinterpret_cast<const sockaddr_in6&>(storage);
+        return net::UdpEndpoint{
+            net::ip::AddressV6::from_view(util::ConstBinaryView(&sin6.sin6_addr, sizeof(sin6.sin6_addr))).unwrap(),
+            net::Port(ntohs(sin6.sin6_port))
+        };
+    }
+    }
+    return none();
+}
+
+Maybe<net::ip::Address> read_pktinfo(const msghdr& msg) noexcept {
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&msg), cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            in_pktinfo info;
+            std::memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            return net::ip::Address(net::ip::AddressV4::from_view(util::ConstBinaryView(&info.ipi_addr, sizeof(info.ipi_addr))).unwrap());
+        }
+        if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+            in6_pktinfo info;
+            std::memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            return net::ip::Address(net::ip::AddressV6::from_view(util::ConstBinaryView(&info.ipi6_addr, sizeof(info.ipi6_addr))).unwrap());
+        }
+    }
+    return none();
+}
+
+socklen_t write_pktinfo(const net::ip::Address& local, void* control) noexcept {
+    std::memset(control, 0, PKTINFO_CONTROL_SIZE);
+    auto* cmsg = reinterpret_cast<cmsghdr*>(control);
+    const auto addr = local.view();
+    return std::visit(
+        util::overloaded {
+            [&](const net::ip::AddressV4&) {
+                in_pktinfo info{};
+                std::memcpy(&info.ipi_spec_dst, addr.data(), addr.size());
+                cmsg->cmsg_level = IPPROTO_IP;
+                cmsg->cmsg_type = IP_PKTINFO;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(info));
+                std::memcpy(CMSG_DATA(cmsg), &info, sizeof(info));
+                return socklen_t(CMSG_SPACE(sizeof(info)));
+            },
+            [&](const net::ip::AddressV6&) {
+                in6_pktinfo info{};
+                std::memcpy(&info.ipi6_addr, addr.data(), addr.size());
+                cmsg->cmsg_level = IPPROTO_IPV6;
+                cmsg->cmsg_type = IPV6_PKTINFO;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(info));
+                std::memcpy(CMSG_DATA(cmsg), &info, sizeof(info));
+                return socklen_t(CMSG_SPACE(sizeof(info)));
+            }
+        },
+        local.value());
+}
+
+}
@@ -0,0 +1,33 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Conversion between network endpoints and socket addresses
+//
+
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "net/net_endpoint.hpp"
+#include "util/util_maybe.hpp"
+
+namespace freewebrtc::io::details {
+
+// Size of control buffer for IP_PKTINFO / IPV6_PKTINFO
+constexpr size_t PKTINFO_CONTROL_SIZE = CMSG_SPACE(sizeof(in6_pktinfo));
+
+// Returns size of the address written to storage
+socklen_t to_sockaddr(const net::UdpEndpoint&, sockaddr_storage&) noexcept;
+// None if address family is not IPv4 / IPv6
+Maybe<net::UdpEndpoint> from_sockaddr(const sockaddr_storage&) noexcept;
+
+// Local address of the received datagram
+Maybe<net::ip::Address> read_pktinfo(const msghdr&) noexcept;
+// Set source address of the datagram to send. Returns size of
+// the control data written to the buffer of PKTINFO_CONTROL_SIZE.
+socklen_t write_pktinfo(const net::ip::Address&, void* control) noexcept;
+
+}
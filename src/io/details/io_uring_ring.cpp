@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Minimal io_uring rings over raw system calls
+//
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "io/details/io_uring_ring.hpp"
+
+namespace freewebrtc::io::details {
+
+namespace {
+
+std::error_code last_error() {
+    return std::error_code(errno, std::generic_category());
+}
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return int(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t argsz) {
+    return int(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+Result<void*> map(int fd, size_t size, off_t offset) {
+    void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    if (ptr == MAP_FAILED) {
+        return last_error();
+    }
+    return ptr;
+}
+
+void unmap(void* ptr, size_t size) {
+    if (ptr != nullptr) {
+        ::munmap(ptr, size);
+    }
+}
+
+}
+
+Result<UringRing> UringRing::create(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd = io_uring_setup(entries, &params);
+    if (fd < 0) {
+        return last_error();
+    }
+    // Features that are used by the driver
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 || (params.features & IORING_FEAT_EXT_ARG) == 0) {
+        ::close(fd);
+        return std::make_error_code(std::errc::not_supported);
+    }
+    const size_t rings_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                       params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    const size_t sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    auto rings_rv = map(fd, rings_size, IORING_OFF_SQ_RING);
+    if (rings_rv.is_err()) {
+        ::close(fd);
+        return rings_rv.unwrap_err();
+    }
+    auto sqes_rv = map(fd, sqes_size, IORING_OFF_SQES);
+    if (sqes_rv.is_err()) {
+        unmap(rings_rv.unwrap(), rings_size);
+        ::close(fd);
+        return sqes_rv.unwrap_err();
+    }
+    // Submission and completion rings share one mapping
+    const Mapping rings{rings_rv.unwrap(), rings_size};
+    return UringRing(fd, params, rings, Mapping{rings.ptr, 0}, Mapping{sqes_rv.unwrap(), sqes_size});
+}
+
+UringRing::UringRing(int fd, const io_uring_params& params, Mapping sq, Mapping cq, Mapping sqes)
+    : m_fd(fd)
+    , m_sq(sq)
+    , m_cq(cq)
+    , m_sqes(sqes)
+    , m_sq_head(field(sq, params.sq_off.head))
+    , m_sq_tail(field(sq, params.sq_off.tail))
+    , m_sq_array(field(sq, params.sq_off.array))
+    , m_sq_mask(*field(sq, params.sq_off.ring_mask))
+    , m_sq_entries(*field(sq, params.sq_off.ring_entries))
+    , m_cq_head(field(cq, params.cq_off.head))
+    , m_cq_tail(field(cq, params.cq_off.tail))
+    , m_cq_mask(*field(cq, params.cq_off.ring_mask))
+    , m_cqes(reinterpret_cast<io_uring_cqe*>(static_cast<uint8_t*>(cq.ptr) + params.cq_off.cqes))
+    , m_sqe_tail(*m_sq_tail)
+{}
+
+UringRing::UringRing(UringRing&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1))
+    , m_sq(std::exchange(other.m_sq, Mapping{}))
+    , m_cq(std::exchange(other.m_cq, Mapping{}))
+    , m_sqes(std::exchange(other.m_sqes, Mapping{}))
+    , m_sq_head(other.m_sq_head)
+    , m_sq_tail(other.m_sq_tail)
+    , m_sq_array(other.m_sq_array)
+    , m_sq_mask(other.m_sq_mask)
+    , m_sq_entries(other.m_sq_entries)
+    , m_cq_head(other.m_cq_head)
+    , m_cq_tail(other.m_cq_tail)
+    , m_cq_mask(other.m_cq_mask)
+    , m_cqes(other.m_cqes)
+    , m_sqe_tail(other.m_sqe_tail)
+{}
+
+UringRing::~UringRing() {
+    unmap(m_sqes.ptr, m_sqes.size);
+    unmap(m_sq.ptr, m_sq.size);
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+unsigned* UringRing::field(const Mapping& m, uint32_t offset) noexcept {
+    return reinterpret_cast<unsigned*>(static_cast<uint8_t*>(m.ptr) + offset);
+}
+
+Maybe<std::reference_wrapper<io_uring_sqe>> UringRing::get_sqe() noexcept {
+    const unsigned head = std::atomic_ref<unsigned>(*m_sq_head).load(std::memory_order_acquire);
+    if (m_sqe_tail - head >= m_sq_entries) {
+        return none();
+    }
+    const unsigned index = m_sqe_tail & m_sq_mask;
+    m_sq_array[index] = index;
+    ++m_sqe_tail;
+    auto& sqe = static_cast<io_uring_sqe*>(m_sqes.ptr)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    return std::ref(sqe);
+}
+
+Result<unsigned> UringRing::submit_and_wait(unsigned min_complete, const Maybe<clock::NativeDuration>& maybe_timeout) {
+    const unsigned to_submit = m_sqe_tail - *m_sq_tail;
+    std::atomic_ref<unsigned>(*m_sq_tail).store(m_sqe_tail, std::memory_order_release);
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    maybe_timeout.with_inner([&](const clock::NativeDuration& timeout) {
+        const auto wait = std::max(timeout, clock::NativeDuration{0});
+        const auto sec = std::chrono::duration_cast<std::chrono::seconds>(wait);
+        ts.tv_sec = sec.count();
+        ts.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(wait - sec).count();
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+    });
+    const bool ext = (flags & IORING_ENTER_EXT_ARG) != 0;
+    const int rc = io_uring_enter(m_fd, to_submit, min_complete, flags,
+                                  ext ? static_cast<const void*>(&arg) : nullptr,
+                                  ext ? sizeof(arg) : 0);
+    if (rc < 0) {
+        // Timeout or signal is not an error of the ring
+        if (errno == ETIME || errno == EINTR) {
+            return 0u;
+        }
+        return last_error();
+    }
+    return unsigned(rc);
+}
+
+UringBuffers::UringBuffers(uint16_t group, unsigned count, size_t buffer_size)
+    : m_group(group)
+    , m_buffer_size(buffer_size)
+    , m_data(size_t(count) * buffer_size)
+{
+    m_returned.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        m_returned.push_back(uint16_t(i));
+    }
+}
+
+}
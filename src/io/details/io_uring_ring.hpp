@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Minimal io_uring rings over raw system calls
+//
+// Only what is needed by UringDriver: submission / completion
+// queues and provided buffers for multishot receive.
+// Rings are used by one thread.
+//
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "clock/clock_timepoint.hpp"
+#include "util/util_maybe.hpp"
+#include "util/util_result.hpp"
+
+namespace freewebrtc::io::details {
+
+class UringRing {
+public:
+    static Result<UringRing> create(unsigned entries);
+    UringRing(UringRing&&) noexcept;
+    UringRing(const UringRing&) = delete;
+    UringRing& operator=(const UringRing&) = delete;
+    ~UringRing();
+
+    int fd() const noexcept;
+    // Next submission entry (zeroed). None if submission queue
+    // is full.
+    Maybe<std::reference_wrapper<io_uring_sqe>> get_sqe() noexcept;
+    // Number of entries that are not submitted yet
+    unsigned pending() const noexcept;
+    // Submit queued entries and wait for completions but not longer
+    // than timeout (forever if none). Returns number of submitted
+    // entries.
+    Result<unsigned> submit_and_wait(unsigned min_complete, const Maybe<clock::NativeDuration>& timeout);
+    // Pass all ready completions to the function and release them.
+    // Returns number of completions.
+    template<typename F>
+    unsigned for_each_cqe(F&&);
+
+private:
+    struct Mapping {
+        void* ptr = nullptr;
+        size_t size = 0;
+    };
+    UringRing(int fd, const io_uring_params&, Mapping sq, Mapping cq, Mapping sqes);
+    static unsigned* field(const Mapping&, uint32_t offset) noexcept;
+
+    int m_fd;
+    Mapping m_sq;
+    Mapping m_cq;
+    Mapping m_sqes;
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned* m_sq_array;
+    unsigned m_sq_mask;
+    unsigned m_sq_entries;
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    unsigned m_cq_mask;
+    io_uring_cqe* m_cqes;
+    // Tail of the entries that are prepared but not submitted
+    unsigned m_sqe_tail;
+};
+
+// Buffers provided to the kernel (IORING_OP_PROVIDE_BUFFERS) for
+// receive operations with IOSQE_BUFFER_SELECT. Buffer is owned by
+// the kernel from provide until it is selected by receive.
+class UringBuffers {
+public:
+    // All buffers are returned initially. Number of buffers is
+    // limited by 65536 (16-bit buffer id).
+    UringBuffers(uint16_t group, unsigned count, size_t buffer_size);
+
+    uint16_t group() const noexcept;
+    std::span<uint8_t> buffer(uint16_t id) noexcept;
+    // Return buffer selected by receive
+    void add(uint16_t id);
+    // Prepare provide operations of returned buffers with
+    // submission entries of the function (returns Result of
+    // entry). Buffers with consecutive ids are provided by one
+    // operation. Buffers that are not provided because of error
+    // are kept for next provide.
+    template<typename F>
+    MaybeError provide(F&& sqe, uint64_t user_data);
+
+private:
+    const uint16_t m_group;
+    const size_t m_buffer_size;
+    std::vector<uint8_t> m_data;
+    std::vector<uint16_t> m_returned;
+};
+
+//
+// implementation
+//
+inline int UringRing::fd() const noexcept {
+    return m_fd;
+}
+
+inline unsigned UringRing::pending() const noexcept {
+    return m_sqe_tail - *m_sq_tail;
+}
+
+template<typename F>
+inline unsigned UringRing::for_each_cqe(F&& f) {
+    unsigned head = *m_cq_head;
+    const unsigned tail = std::atomic_ref<unsigned>(*m_cq_tail).load(std::memory_order_acquire);
+    unsigned count = 0;
+    for (; head != tail; ++head, ++count) {
+        f(static_cast<const io_uring_cqe&>(m_cqes[head & m_cq_mask]));
+    }
+    std::atomic_ref<unsigned>(*m_cq_head).store(head, std::memory_order_release);
+    return count;
+}
+
+inline uint16_t UringBuffers::group() const noexcept {
+    return m_group;
+}
+
+inline std::span<uint8_t> UringBuffers::buffer(uint16_t id) noexcept {
+    return std::span<uint8_t>(m_data.data() + size_t(id) * m_buffer_size, m_buffer_size);
+}
+
+inline void UringBuffers::add(uint16_t id) {
+    m_returned.push_back(id);
+}
+
+template<typename F>
+inline MaybeError UringBuffers::provide(F&& sqe, uint64_t user_data) {
+    std::sort(m_returned.begin(), m_returned.end());
+    size_t i = 0;
+    while (i < m_returned.size()) {
+        const uint16_t first = m_returned[i];
+        size_t count = 1;
+        while (i + count < m_returned.size() && m_returned[i + count] == first + count) {
+            ++count;
+        }
+        auto sqe_rv = sqe();
+        if (sqe_rv.is_err()) {
+            m_returned.erase(m_returned.begin(), m_returned.begin() + i);
+            return sqe_rv.unwrap_err();
+        }
+        io_uring_sqe& s = sqe_rv.unwrap();
+        s.opcode = IORING_OP_PROVIDE_BUFFERS;
+        s.fd = int(count);
+        s.addr = reinterpret_cast<uint64_t>(buffer(first).data());
+        s.len = uint32_t(m_buffer_size);
+        s.off = first;
+        s.buf_group = m_group;
+        s.user_data = user_data;
+        i += count;
+    }
+    m_returned.clear();
+    return success();
+}
+
+}
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Reference UDP driver of STUN stateless server
+//
+
+#include "io/io_stun_server_udp.hpp"
+#include "util/util_variant_overloaded.hpp"
+
+namespace freewebrtc::io {
+
+using Stateless = stun::server::Stateless;
+
+StunServerUDP::StunServerUDP(UdpSocket&& socket, Stateless& server, const Maybe<Settings>& maybe_settings)
+    : m_socket(std::move(socket))
+    , m_server(server)
+    , m_batch(maybe_settings.value_or(Settings{}).batch_size,
+              maybe_settings.value_or(Settings{}).max_datagram_size)
+{
+    m_packets.reserve(m_batch.capacity());
+}
+
+Result<size_t> StunServerUDP::process() {
+    return m_socket.receive(m_batch)
+        .bind([&](size_t count) -> Result<size_t> {
+            const auto& received = m_batch.received();
+            m_packets.clear();
+            for (const auto& r: received) {
+                m_stat.received.inc();
+                m_packets.push_back(Stateless::Packet{net::Endpoint(r.remote), r.data});
+            }
+            const auto results = m_server.process_batch(m_packets);
+            for (size_t i = 0; i < results.size(); ++i) {
+                std::visit(
+                    util::overloaded {
+                        [&](const Stateless::Respond& respond) {
+                            auto size_rv = respond.response.build_into(m_batch.send_buffer(), respond.maybe_integrity);
+                            if (size_rv.is_err()) {
+                                m_stat.build_errors.inc();
+                                return;
+                            }
+                            m_stat.responses.inc();
+                            m_batch.queue_send(size_rv.unwrap(), received[i].remote, received[i].maybe_local);
+                        },
+                        [&](const Stateless::Ignore&) {
+                            m_stat.ignored.inc();
+                        },
+                        [&](const Stateless::Error&) {
+                            m_stat.errors.inc();
+                        }
+                    },
+                    results[i]);
+            }
+            if (m_batch.send_count() == 0) {
+                return count;
+            }
+            const size_t queued = m_batch.send_count();
+            return m_socket.send(m_batch)
+                .fmap([&](size_t sent) {
+                    m_stat.send_dropped.add(queued - sent);
+                    return count;
+                });
+        });
+}
+
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Reference UDP driver of STUN stateless server
+//
+// Receives batch of datagrams by recvmmsg, processes them by
+// server::Stateless::process_batch and sends all responses by one
+// sendmmsg. Responses are sent from the local address that request
+// is sent to.
+//
+
+#pragma once
+
+#include "stat/stat_counter.hpp"
+#include "stun/stun_server_stateless.hpp"
+#include "io/io_udp_socket.hpp"
+
+namespace freewebrtc::io {
+
+class StunServerUDP {
+public:
+    struct Settings {
+        // Maximum number of datagrams per system call
+        size_t batch_size = 64;
+        size_t max_datagram_size = UdpBatch::DEFAULT_MAX_DATAGRAM_SIZE;
+    };
+    StunServerUDP(UdpSocket&&, stun::server::Stateless&, const Maybe<Settings>& = None{});
+
+    // Process one batch of requests. Waits for the first request
+    // if socket is blocking. Returns number of received datagrams.
+    Result<size_t> process();
+
+    const UdpSocket& socket() const noexcept;
+
+    struct Statistics {
+        stat::Counter received;
+        stat::Counter responses;
+        stat::Counter ignored;
+        stat::Counter errors;
+        stat::Counter build_errors;
+        // Responses that are not sent by socket
+        stat::Counter send_dropped;
+    };
+    const Statistics& stat() const noexcept;
+
+private:
+    UdpSocket m_socket;
+    stun::server::Stateless& m_server;
+    UdpBatch m_batch;
+    std::vector<stun::server::Stateless::Packet> m_packets;
+    Statistics m_stat;
+};
+
+//
+// inlines
+//
+inline const UdpSocket& StunServerUDP::socket() const noexcept {
+    return m_socket;
+}
+
+inline const StunServerUDP::Statistics& StunServerUDP::stat() const noexcept {
+    return m_stat;
+}
+
+}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Batch of UDP datagrams for recvmmsg / sendmmsg
+//
+
+#include <cstring>
+
+#include "io/io_udp_batch.hpp"
+
+namespace freewebrtc::io {
+
+UdpBatch::UdpBatch(size_t capacity, size_t max_datagram_size)
+    : m_max_datagram_size(max_datagram_size)
+    , m_recv(capacity, max_datagram_size)
+    , m_send(capacity, max_datagram_size)
+{
+    m_received.reserve(capacity);
+}
+
+std::span<uint8_t> UdpBatch::send_buffer() noexcept {
+    if (m_send_count >= m_send.msgs.size()) {
+        return {};
+    }
+    return std::span<uint8_t>(m_send.buffer.data() + m_send_count * m_max_datagram_size, m_max_datagram_size);
+}
+
+void UdpBatch::queue_send(size_t size, const net::UdpEndpoint& remote, const Maybe<net::ip::Address>& maybe_local) {
+    const size_t i = m_send_count++;
+    auto& hdr = m_send.msgs[i].msg_hdr;
+    m_send.iovs[i].iov_len = size;
+    hdr.msg_namelen = details::to_sockaddr(remote, m_send.addrs[i]);
+    // Source address is set only if it is in the same address
+    // family as destination.
+    const bool same_family = maybe_local
+        .fmap([&](const net::ip::Address& local) {
+            return local.value().index() == remote.address.value().index();
+        })
+        .value_or(false);
+    if (same_family) {
+        hdr.msg_control = m_send.controls[i].data;
+        hdr.msg_controllen = details::write_pktinfo(maybe_local.unwrap(), m_send.controls[i].data);
+    } else {
+        hdr.msg_control = nullptr;
+        hdr.msg_controllen = 0;
+    }
+}
+
+UdpBatch::Slots::Slots(size_t capacity, size_t max_datagram_size)
+    : buffer(capacity * max_datagram_size)
+    , msgs(capacity)
+    , iovs(capacity)
+    , addrs(capacity)
+    , controls(capacity)
+{
+    for (size_t i = 0; i < capacity; ++i) {
+        iovs[i].iov_base = buffer.data() + i * max_datagram_size;
+        iovs[i].iov_len = max_datagram_size;
+        auto& hdr = msgs[i].msg_hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &addrs[i];
+        hdr.msg_namelen = sizeof(sockaddr_storage);
+        hdr.msg_iov = &iovs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = controls[i].data;
+        hdr.msg_controllen = sizeof(Control);
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Batch of UDP datagrams for recvmmsg / sendmmsg
+//
+
+#pragma once
+
+#include <sys/socket.h>
+#include <span>
+#include <vector>
+
+#include "net/net_endpoint.hpp"
+#include "net/net_path.hpp"
+#include "util/util_binary_view.hpp"
+#include "util/util_maybe.hpp"
+#include "io/details/io_sockaddr.hpp"
+
+namespace freewebrtc::io {
+
+class UdpSocket;
+
+// Preallocated buffers of the datagrams that are received / sent
+// by one system call. Batch refers to its own buffers so it is
+// not copyable and not movable.
+class UdpBatch {
+public:
+    static constexpr size_t DEFAULT_MAX_DATAGRAM_SIZE = 1500;
+    explicit UdpBatch(size_t capacity, size_t max_datagram_size = DEFAULT_MAX_DATAGRAM_SIZE);
+    UdpBatch(const UdpBatch&) = delete;
+    UdpBatch& operator=(const UdpBatch&) = delete;
+
+    size_t capacity() const noexcept;
+
+    struct Received {
+        // Sender of the datagram
+        net::UdpEndpoint remote;
+        // Local address that datagram is sent to (IP_PKTINFO /
+        // IPV6_PKTINFO). It is source address of the response.
+        Maybe<net::ip::Address> maybe_local;
+        // Refers to the buffer of the batch. Valid until next
+        // receive to the batch.
+        util::ConstBinaryView data;
+
+        // Network path of the response
+        Maybe<net::Path> path() const;
+    };
+    const std::vector<Received>& received() const noexcept;
+
+    // Buffer for the next datagram to send. Empty if all send
+    // slots are used.
+    std::span<uint8_t> send_buffer() noexcept;
+    // Queue datagram of size bytes written to send_buffer(). If
+    // local address is defined then it is used as source address.
+    void queue_send(size_t size, const net::UdpEndpoint& remote, const Maybe<net::ip::Address>& maybe_local);
+    size_t send_count() const noexcept;
+
+private:
+    friend class UdpSocket;
+    struct alignas(cmsghdr) Control {
+        uint8_t data[details::PKTINFO_CONTROL_SIZE];
+    };
+    struct Slots {
+        Slots(size_t capacity, size_t max_datagram_size);
+        util::ByteVec buffer;
+        std::vector<mmsghdr> msgs;
+        std::vector<iovec> iovs;
+        std::vector<sockaddr_storage> addrs;
+        std::vector<Control> controls;
+    };
+    const size_t m_max_datagram_size;
+    Slots m_recv;
+    Slots m_send;
+    std::vector<Received> m_received;
+    size_t m_send_count = 0;
+};
+
+//
+// inlines
+//
+inline size_t UdpBatch::capacity() const noexcept {
+    return m_recv.msgs.size();
+}
+
+inline const std::vector<UdpBatch::Received>& UdpBatch::received() const noexcept {
+    return m_received;
+}
+
+inline size_t UdpBatch::send_count() const noexcept {
+    return m_send_count;
+}
+
+inline Maybe<net::Path> UdpBatch::Received::path() const {
+    return maybe_local
+        .fmap([&](const net::ip::Address& local) {
+            return net::Path{local, remote.address};
+        });
+}
+
+}
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Linux UDP socket with batched receive / send
+//
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
+#include "io/io_udp_socket.hpp"
+#include "io/details/io_sockaddr.hpp"
+
+namespace freewebrtc::io {
+
+namespace {
+
+std::error_code last_error() {
+    return std::error_code(errno, std::generic_category());
+}
+
+// Errors of the socket itself. Other errors of sendmmsg are
+// errors of the first datagram that is not sent (e.g. unreachable
+// destination or full socket buffer).
+bool is_socket_error(int err) {
+    return err == EBADF || err == ENOTSOCK || err == EFAULT;
+}
+
+}
+
+Result<UdpSocket> UdpSocket::bind(const net::UdpEndpoint& ep) {
+    sockaddr_storage storage;
+    const socklen_t len = details::to_sockaddr(ep, storage);
+    const int fd = ::socket(storage.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return last_error();
+    }
+    UdpSocket sock(fd);
+    const int on = 1;
+    const int rc = storage.ss_family == AF_INET
+        ? ::setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on))
+        : ::setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on));
+    // IPv6 socket is not dual-stack: otherwise IPv4 clients are
+    // reported as IPv4-mapped IPv6 addresses.
+    const bool v6only_failed = storage.ss_family == AF_INET6
+        && ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) != 0;
+    if (rc != 0 || v6only_failed || ::bind(fd, reinterpret_cast<const sockaddr*>(&storage), len) != 0) {
+        return last_error();
+    }
+    return sock;
+}
+
+UdpSocket::UdpSocket(int fd)
+    : m_fd(fd)
+{}
+
+UdpSocket::UdpSocket(UdpSocket&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1))
+{}
+
+UdpSocket& UdpSocket::operator=(UdpSocket&& other) noexcept {
+    if (this != &other) {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+        m_fd = std::exchange(other.m_fd, -1);
+    }
+    return *this;
+}
+
+UdpSocket::~UdpSocket() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+Result<net::UdpEndpoint> UdpSocket::local_endpoint() const {
+    sockaddr_storage storage;
+    socklen_t len = sizeof(storage);
+    if (::getsockname(m_fd, reinterpret_cast<sockaddr*>(&storage), &len) != 0) {
+        return last_error();
+    }
+    auto maybe_ep = details::from_sockaddr(storage);
+    if (maybe_ep.is_none()) {
+        return std::make_error_code(std::errc::address_family_not_supported);
+    }
+    return maybe_ep.unwrap();
+}
+
+MaybeError UdpSocket::set_nonblocking() {
+    const int flags = ::fcntl(m_fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return last_error();
+    }
+    return success();
+}
+
+Result<size_t> UdpSocket::receive(UdpBatch& batch) {
+    auto& slots = batch.m_recv;
+    batch.m_received.clear();
+    for (auto& msg: slots.msgs) {
+        msg.msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        msg.msg_hdr.msg_controllen = sizeof(UdpBatch::Control);
+        msg.msg_hdr.msg_flags = 0;
+    }
+    const int rc = ::recvmmsg(m_fd, slots.msgs.data(), slots.msgs.size(), MSG_WAITFORONE, nullptr);
+    if (rc < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        return last_error();
+    }
+    for (size_t i = 0; i < size_t(rc); ++i) {
+        const auto& msg = slots.msgs[i];
+        // Truncated datagrams cannot be valid STUN messages
+        if ((msg.msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+            continue;
+        }
+        details::from_sockaddr(slots.addrs[i])
+            .with_inner([&](net::UdpEndpoint&& remote) {
+                batch.m_received.push_back(UdpBatch::Received{
+                    std::move(remote),
+                    details::read_pktinfo(msg.msg_hdr),
+                    util::ConstBinaryView(slots.iovs[i].iov_base, msg.msg_len)
+                });
+            });
+    }
+    return size_t(rc);
+}
+
+Result<size_t> UdpSocket::send(UdpBatch& batch) {
+    auto& slots = batch.m_send;
+    const size_t count = std::exchange(batch.m_send_count, 0);
+    size_t sent = 0;
+    size_t dropped = 0;
+    while (sent < count) {
+        const int rc = ::sendmmsg(m_fd, slots.msgs.data() + sent, count - sent, 0);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (is_socket_error(errno)) {
+                return last_error();
+            }
+            // Skip datagram that cannot be sent
+            dropped += 1;
+            sent += 1;
+            continue;
+        }
+        sent += size_t(rc);
+    }
+    return sent - dropped;
+}
+
+}
@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Linux UDP socket with batched receive / send
+//
+
+#pragma once
+
+#include "net/net_endpoint.hpp"
+#include "util/util_result.hpp"
+#include "io/io_udp_batch.hpp"
+
+namespace freewebrtc::io {
+
+class UdpSocket {
+public:
+    // Bind socket to the local endpoint. Local address of each
+    // received datagram is reported so socket may be bound to
+    // wildcard address. IPv6 socket receives only IPv6 datagrams
+    // (IPV6_V6ONLY) so IPv4 and IPv6 clients are served by two
+    // sockets that may be bound to the same port.
+    static Result<UdpSocket> bind(const net::UdpEndpoint&);
+    UdpSocket(UdpSocket&&) noexcept;
+    UdpSocket& operator=(UdpSocket&&) noexcept;
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+    ~UdpSocket();
+
+    int fd() const noexcept;
+    // Actual local endpoint (e.g. if port 0 is bound)
+    Result<net::UdpEndpoint> local_endpoint() const;
+    MaybeError set_nonblocking();
+
+    // Receive up to capacity of the batch by one recvmmsg. Waits
+    // only for the first datagram if socket is blocking. Returns
+    // number of received datagrams (0 if nothing is ready on
+    // non-blocking socket).
+    Result<size_t> receive(UdpBatch&);
+    // Send all queued datagrams of the batch by sendmmsg. Batch
+    // is cleared even if not all datagrams are sent. Datagrams
+    // that cannot be sent (e.g. destination is unreachable or
+    // socket buffer is full) are skipped. Returns number of sent
+    // datagrams; error is returned only for errors of the socket.
+    Result<size_t> send(UdpBatch&);
+
+private:
+    explicit UdpSocket(int fd);
+    int m_fd;
+};
+
+//
+// inlines
+//
+inline int UdpSocket::fd() const noexcept {
+    return m_fd;
+}
+
+}
@@ -0,0 +1,406 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// io_uring event loop driver of STUN client and server
+//
+
+#include <cstring>
+
+#include "clock/clock_std.hpp"
+#include "io/io_uring_driver.hpp"
+#include "io/details/io_sockaddr.hpp"
+#include "util/util_variant_overloaded.hpp"
+
+namespace freewebrtc::io {
+
+namespace {
+
+// User data of the submission: operation | source | send slot
+enum class Operation : uint64_t {
+    receive = 1,
+    send = 2,
+    provide = 3
+};
+
+uint64_t user_data(Operation op, size_t source, uint32_t slot) {
+    return (uint64_t(op) << 56) | (uint64_t(source & 0xFFFFFF) << 32) | slot;
+}
+
+Operation operation(uint64_t data) {
+    return Operation(data >> 56);
+}
+
+size_t source_index(uint64_t data) {
+    return size_t((data >> 32) & 0xFFFFFF);
+}
+
+uint32_t slot_index(uint64_t data) {
+    return uint32_t(data);
+}
+
+constexpr uint16_t BUFFER_GROUP = 0;
+
+}
+
+// Sends requests of the client and forwards results to the user
+class UringDriver::ClientSink : public stun::ClientUDP::EffectSink {
+public:
+    ClientSink(UringDriver& driver, size_t source, Client& client)
+        : m_driver(driver)
+        , m_source(source)
+        , m_client(client)
+    {}
+    void send_data(const stun::ClientUDP::SendData& send) override {
+        if (m_error.is_err()) {
+            return;
+        }
+        const auto& data = send.message_view;
+        auto maybe_dest = m_client.destination(send.handle);
+        auto maybe_slot = m_driver.alloc_send_slot();
+        if (maybe_dest.is_none() || maybe_slot.is_none()) {
+            m_driver.m_stat.send_dropped.inc();
+            return;
+        }
+        const uint32_t slot = maybe_slot.unwrap();
+        auto buffer = m_driver.send_buffer(slot);
+        if (data.size() > buffer.size()) {
+            m_driver.m_free_slots.push_back(slot);
+            m_driver.m_stat.send_dropped.inc();
+            return;
+        }
+        std::copy(data.begin(), data.end(), buffer.begin());
+        m_error = m_driver.send(m_source, slot, data.size(), maybe_dest.unwrap(), none());
+    }
+    void transaction_ok(stun::ClientUDP::TransactionOk&& ok) override {
+        m_client.sink.get().transaction_ok(std::move(ok));
+    }
+    void transaction_failed(stun::ClientUDP::TransactionFailed&& failed) override {
+        m_client.sink.get().transaction_failed(std::move(failed));
+    }
+    // First error of the ring. Requests are not sent after error.
+    const MaybeError& error() const noexcept {
+        return m_error;
+    }
+private:
+    UringDriver& m_driver;
+    const size_t m_source;
+    Client& m_client;
+    MaybeError m_error = success();
+};
+
+Result<UringDriver> UringDriver::create(const Maybe<Settings>& maybe_settings) {
+    const auto settings = maybe_settings.value_or(Settings{});
+    if (settings.recv_buffers == 0 || settings.recv_buffers > MAX_RECV_BUFFERS
+        || settings.send_slots == 0 || settings.send_buffer_size == 0) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    return details::UringRing::create(settings.ring_entries)
+        .bind([&](details::UringRing&& ring) -> Result<UringDriver> {
+            UringDriver driver(std::move(ring), settings);
+            auto rv = driver.provide_buffers();
+            if (rv.is_err()) {
+                return rv.unwrap_err();
+            }
+            return driver;
+        });
+}
+
+UringDriver::UringDriver(details::UringRing&& ring, const Settings& settings)
+    : m_settings(settings)
+    , m_ring(std::move(ring))
+    , m_buffers(BUFFER_GROUP, settings.recv_buffers, settings.recv_buffer_size)
+    , m_send_slots(settings.send_slots)
+    , m_send_data(settings.send_slots * settings.send_buffer_size)
+{
+    m_free_slots.reserve(settings.send_slots);
+    for (uint32_t i = settings.send_slots; i-- > 0;) {
+        m_free_slots.push_back(i);
+    }
+}
+
+UringDriver::Source::Source(UdpSocket&& s, std::variant<ServerRef, Client>&& h)
+    : socket(std::move(s))
+    , handler(std::move(h))
+{
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_namelen = sizeof(sockaddr_storage);
+    msg.msg_controllen = details::PKTINFO_CONTROL_SIZE;
+}
+
+MaybeError UringDriver::add_server(UdpSocket&& socket, stun::server::Stateless& server) {
+    m_sources.emplace_back(std::make_unique<Source>(std::move(socket), ServerRef(server)));
+    return arm_receive(m_sources.size() - 1);
+}
+
+MaybeError UringDriver::add_client(UdpSocket&& socket, stun::ClientUDP& client, Destination&& destination, stun::ClientUDP::EffectSink& sink) {
+    m_sources.emplace_back(std::make_unique<Source>(std::move(socket), Client{client, std::move(destination), sink}));
+    return arm_receive(m_sources.size() - 1);
+}
+
+Result<size_t> UringDriver::run_once(const Maybe<clock::NativeDuration>& max_wait) {
+    const auto now = clock::steady_clock_now();
+    Maybe<clock::NativeDuration> maybe_wait = max_wait;
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+        auto* client = std::get_if<Client>(&m_sources[i]->handler);
+        if (client == nullptr) {
+            continue;
+        }
+        ClientSink sink(*this, i, *client);
+        client->client.get().drain(now, sink)
+            .with_inner([&](const Timepoint& next) {
+                const auto wait = next - now;
+                maybe_wait = maybe_wait
+                    .fmap([&](const clock::NativeDuration& w) { return std::min(w, wait); })
+                    .value_or(wait);
+            });
+        if (sink.error().is_err()) {
+            return sink.error().unwrap_err();
+        }
+    }
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+        if (!m_sources[i]->armed) {
+            auto rv = arm_receive(i);
+            if (rv.is_err()) {
+                return rv.unwrap_err();
+            }
+        }
+    }
+    return m_ring.submit_and_wait(1, maybe_wait)
+        .bind([&](unsigned) -> Result<size_t> {
+            const size_t received = m_stat.received.count();
+            m_ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+                on_completion(cqe);
+            });
+            auto process_rv = process_received(clock::steady_clock_now());
+            if (process_rv.is_err()) {
+                return process_rv.unwrap_err();
+            }
+            const size_t count = m_stat.received.count() - received;
+            if (m_ring.pending() == 0) {
+                return count;
+            }
+            // Responses are submitted at once without wait
+            return m_ring.submit_and_wait(0, none())
+                .fmap([&](unsigned) {
+                    return count;
+                });
+        });
+}
+
+Result<std::reference_wrapper<io_uring_sqe>> UringDriver::sqe() {
+    while (true) {
+        auto maybe_sqe = m_ring.get_sqe();
+        if (maybe_sqe.is_some()) {
+            return maybe_sqe.unwrap();
+        }
+        // Submission queue is full: submit without wait
+        auto submit_rv = m_ring.submit_and_wait(0, none());
+        if (submit_rv.is_err()) {
+            return submit_rv.unwrap_err();
+        }
+    }
+}
+
+MaybeError UringDriver::arm_receive(size_t source) {
+    auto& src = *m_sources[source];
+    auto sqe_rv = sqe();
+    if (sqe_rv.is_err()) {
+        return sqe_rv.unwrap_err();
+    }
+    io_uring_sqe& s = sqe_rv.unwrap();
+    s.opcode = IORING_OP_RECVMSG;
+    s.fd = src.socket.fd();
+    s.addr = reinterpret_cast<uint64_t>(&src.msg);
+    s.len = 1;
+    s.ioprio = IORING_RECV_MULTISHOT;
+    s.flags = IOSQE_BUFFER_SELECT;
+    s.buf_group = m_buffers.group();
+    s.user_data = user_data(Operation::receive, source, 0);
+    src.armed = true;
+    return success();
+}
+
+MaybeError UringDriver::provide_buffers() {
+    return m_buffers.provide([&] { return sqe(); },
+                             user_data(Operation::provide, 0, 0));
+}
+
+Maybe<uint32_t> UringDriver::alloc_send_slot() {
+    if (m_free_slots.empty()) {
+        return none();
+    }
+    const uint32_t slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return slot;
+}
+
+std::span<uint8_t> UringDriver::send_buffer(uint32_t slot) noexcept {
+    return std::span<uint8_t>(m_send_data.data() + size_t(slot) * m_settings.send_buffer_size, m_settings.send_buffer_size);
+}
+
+MaybeError UringDriver::send(size_t source, uint32_t slot, size_t size, const net::UdpEndpoint& remote, const Maybe<net::ip::Address>& maybe_local) {
+    auto sqe_rv = sqe();
+    if (sqe_rv.is_err()) {
+        m_free_slots.push_back(slot);
+        return sqe_rv.unwrap_err();
+    }
+    auto& ss = m_send_slots[slot];
+    std::memset(&ss.msg, 0, sizeof(ss.msg));
+    ss.iov.iov_base = send_buffer(slot).data();
+    ss.iov.iov_len = size;
+    ss.msg.msg_iov = &ss.iov;
+    ss.msg.msg_iovlen = 1;
+    ss.msg.msg_name = &ss.addr;
+    ss.msg.msg_namelen = details::to_sockaddr(remote, ss.addr);
+    maybe_local.with_inner([&](const net::ip::Address& local) {
+        if (local.value().index() == remote.address.value().index()) {
+            ss.msg.msg_control = ss.control.data;
+            ss.msg.msg_controllen = details::write_pktinfo(local, ss.control.data);
+        }
+    });
+    io_uring_sqe& s = sqe_rv.unwrap();
+    s.opcode = IORING_OP_SENDMSG;
+    s.fd = m_sources[source]->socket.fd();
+    s.addr = reinterpret_cast<uint64_t>(&ss.msg);
+    s.len = 1;
+    s.user_data = user_data(Operation::send, source, slot);
+    return success();
+}
+
+void UringDriver::on_completion(const io_uring_cqe& cqe) {
+    const size_t source = source_index(cqe.user_data);
+    switch (operation(cqe.user_data)) {
+    case Operation::send:
+        m_free_slots.push_back(slot_index(cqe.user_data));
+        if (cqe.res < 0) {
+            m_stat.send_errors.inc();
+        } else {
+            m_stat.sent.inc();
+        }
+        return;
+    case Operation::provide:
+        // Provide fails only if kernel is out of memory. Receives
+        // fail with ENOBUFS in this case.
+        return;
+    case Operation::receive:
+        break;
+    }
+    auto& src = *m_sources[source];
+    if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+        // Multishot receive is finished (e.g. no buffers). It
+        // is armed again by next run_once.
+        src.armed = false;
+    }
+    if (cqe.res < 0) {
+        if (cqe.res == -ENOBUFS) {
+            m_stat.no_buffers.inc();
+        }
+        return;
+    }
+    const uint16_t buffer_id = uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    const auto buffer = m_buffers.buffer(buffer_id);
+    // Layout of the buffer: io_uring_recvmsg_out | name | control | payload
+    io_uring_recvmsg_out out;
+    std::memcpy(&out, buffer.data(), sizeof(out));
+    const size_t name_offset = sizeof(out);
+    const size_t control_offset = name_offset + src.msg.msg_namelen;
+    const size_t payload_offset = control_offset + src.msg.msg_controllen;
+    if ((out.flags & MSG_TRUNC) != 0 || payload_offset + out.payloadlen > size_t(cqe.res)) {
+        m_stat.truncated.inc();
+        m_buffers.add(buffer_id);
+        return;
+    }
+    sockaddr_storage addr;
+    std::memset(&addr, 0, sizeof(addr));
+    std::memcpy(&addr, buffer.data() + name_offset, std::min<size_t>(out.namelen, src.msg.msg_namelen));
+    msghdr control{};
+    control.msg_control = buffer.data() + control_offset;
+    control.msg_controllen = std::min<size_t>(out.controllen, src.msg.msg_controllen);
+    auto maybe_remote = details::from_sockaddr(addr);
+    if (maybe_remote.is_none()) {
+        m_buffers.add(buffer_id);
+        return;
+    }
+    m_stat.received.inc();
+    m_received.push_back(Received{
+        source,
+        buffer_id,
+        UdpBatch::Received{
+            std::move(maybe_remote).unwrap(),
+            details::read_pktinfo(control),
+            // Datagram is not copied from the provided buffer
+            util::ConstBinaryView(buffer.data() + payload_offset, out.payloadlen)
+        }
+    });
+}
+
+MaybeError UringDriver::process_received(Timepoint now) {
+    MaybeError result = success();
+    for (size_t i = 0; i < m_sources.size() && result.is_ok(); ++i) {
+        result = std::visit(
+            util::overloaded {
+                [&](ServerRef& server) -> MaybeError {
+                    m_packets.clear();
+                    for (const auto& r: m_received) {
+                        if (r.source == i) {
+                            m_packets.push_back(stun::server::Stateless::Packet{net::Endpoint(r.datagram.remote), r.datagram.data});
+                        }
+                    }
+                    if (m_packets.empty()) {
+                        return success();
+                    }
+                    const auto results = server.get().process_batch(m_packets);
+                    size_t k = 0;
+                    for (const auto& r: m_received) {
+                        if (r.source != i) {
+                            continue;
+                        }
+                        const auto* respond = std::get_if<stun::server::Stateless::Respond>(&results[k++]);
+                        if (respond == nullptr) {
+                            continue;
+                        }
+                        auto maybe_slot = alloc_send_slot();
+                        if (maybe_slot.is_none()) {
+                            m_stat.send_dropped.inc();
+                            continue;
+                        }
+                        const uint32_t slot = maybe_slot.unwrap();
+                        auto size_rv = respond->response.build_into(send_buffer(slot), respond->maybe_integrity);
+                        if (size_rv.is_err()) {
+                            m_free_slots.push_back(slot);
+                            m_stat.send_dropped.inc();
+                            continue;
+                        }
+                        auto send_rv = send(i, slot, size_rv.unwrap(), r.datagram.remote, r.datagram.maybe_local);
+                        if (send_rv.is_err()) {
+                            return send_rv;
+                        }
+                    }
+                    return success();
+                },
+                [&](Client& client) -> MaybeError {
+                    for (const auto& r: m_received) {
+                        if (r.source == i) {
+                            // Errors (e.g. stray responses) are counted by client
+                            client.client.get().response(now, r.datagram.data);
+                        }
+                    }
+                    return success();
+                }
+            },
+            m_sources[i]->handler);
+    }
+    // Buffers are returned even if processing is failed
+    for (const auto& r: m_received) {
+        m_buffers.add(r.buffer_id);
+    }
+    m_received.clear();
+    if (result.is_err()) {
+        return result;
+    }
+    return provide_buffers();
+}
+
+}
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// io_uring event loop driver of STUN client and server
+//
+// One driver (ring) is used per thread. Datagrams are received by
+// multishot recvmsg into provided buffers and passed to the
+// client / server without copy. Responses to all datagrams that
+// are received by one wait are submitted by one system call. Wait
+// is limited by timers of the clients (Sleep effect).
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <variant>
+#include <vector>
+
+#include "clock/clock_timepoint.hpp"
+#include "stat/stat_counter.hpp"
+#include "stun/stun_client_udp.hpp"
+#include "stun/stun_server_stateless.hpp"
+#include "io/io_udp_socket.hpp"
+#include "io/details/io_uring_ring.hpp"
+
+namespace freewebrtc::io {
+
+class UringDriver {
+public:
+    static constexpr unsigned MAX_RECV_BUFFERS = 1u << 16;
+    struct Settings {
+        unsigned ring_entries = 256;
+        // Provided buffers for receive (up to MAX_RECV_BUFFERS).
+        // Buffer contains datagram and its addresses.
+        unsigned recv_buffers = 256;
+        size_t recv_buffer_size = 2048;
+        // Maximum number of sends in flight
+        unsigned send_slots = 256;
+        // Maximum size of the sent datagram (request of the
+        // client or response of the server). Larger datagrams
+        // are dropped.
+        size_t send_buffer_size = UdpBatch::DEFAULT_MAX_DATAGRAM_SIZE;
+    };
+    static Result<UringDriver> create(const Maybe<Settings>& = None{});
+    UringDriver(UringDriver&&) = default;
+
+    // Serve STUN requests received by the socket
+    MaybeError add_server(UdpSocket&&, stun::server::Stateless&);
+    // Destination of the client transaction. ClientUDP knows only
+    // addresses of the transaction path so port is provided by user.
+    using Destination = std::function<Maybe<net::UdpEndpoint>(const stun::ClientUDP::Handle&)>;
+    // Requests of the client are sent by the socket. Responses
+    // received by the socket are passed to the client. Results of
+    // the transactions are passed to the sink. Client timers
+    // use clock::steady_clock_now().
+    MaybeError add_client(UdpSocket&&, stun::ClientUDP&, Destination&&, stun::ClientUDP::EffectSink&);
+
+    // One iteration of the loop: submit sends, wait for completions
+    // not longer than max wait and next timer of the clients, process
+    // received datagrams. Returns number of received datagrams.
+    Result<size_t> run_once(const Maybe<clock::NativeDuration>& max_wait = None{});
+
+    struct Statistics {
+        stat::Counter received;
+        stat::Counter sent;
+        stat::Counter send_errors;
+        // No free send slot or datagram is larger than send buffer
+        stat::Counter send_dropped;
+        // Receive buffers are exhausted
+        stat::Counter no_buffers;
+        stat::Counter truncated;
+    };
+    const Statistics& stat() const noexcept;
+
+private:
+    using Timepoint = clock::Timepoint;
+    using ServerRef = std::reference_wrapper<stun::server::Stateless>;
+    struct Client {
+        std::reference_wrapper<stun::ClientUDP> client;
+        Destination destination;
+        std::reference_wrapper<stun::ClientUDP::EffectSink> sink;
+    };
+    struct Source {
+        Source(UdpSocket&&, std::variant<ServerRef, Client>&&);
+        UdpSocket socket;
+        std::variant<ServerRef, Client> handler;
+        // Sizes of name / control of multishot recvmsg. Must be
+        // valid while receive is armed.
+        msghdr msg;
+        bool armed = false;
+    };
+    struct SendSlot {
+        msghdr msg;
+        iovec iov;
+        sockaddr_storage addr;
+        struct alignas(cmsghdr) {
+            uint8_t data[details::PKTINFO_CONTROL_SIZE];
+        } control;
+    };
+    struct Received {
+        size_t source;
+        uint16_t buffer_id;
+        UdpBatch::Received datagram;
+    };
+    class ClientSink;
+
+    UringDriver(details::UringRing&&, const Settings&);
+    // Free submission entry. Submits queued entries if submission
+    // queue is full.
+    Result<std::reference_wrapper<io_uring_sqe>> sqe();
+    MaybeError arm_receive(size_t source);
+    // Return received buffers to the kernel
+    MaybeError provide_buffers();
+    // Buffer for the datagram to send. None if all slots are used.
+    Maybe<uint32_t> alloc_send_slot();
+    std::span<uint8_t> send_buffer(uint32_t slot) noexcept;
+    // Slot is released if send is not queued
+    MaybeError send(size_t source, uint32_t slot, size_t size, const net::UdpEndpoint&, const Maybe<net::ip::Address>& maybe_local);
+    void on_completion(const io_uring_cqe&);
+    MaybeError process_received(Timepoint now);
+
+    const Settings m_settings;
+    details::UringRing m_ring;
+    details::UringBuffers m_buffers;
+    std::vector<std::unique_ptr<Source>> m_sources;
+    std::vector<SendSlot> m_send_slots;
+    std::vector<uint8_t> m_send_data;
+    std::vector<uint32_t> m_free_slots;
+    std::vector<Received> m_received;
+    std::vector<stun::server::Stateless::Packet> m_packets;
+    Statistics m_stat;
+};
+
+//
+// inlines
+//
+inline const UringDriver::Statistics& UringDriver::stat() const noexcept {
+    return m_stat;
+}
+
+}
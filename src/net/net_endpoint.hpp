@@ -21,6 +21,7 @@ template<typename Tag>
 struct GenericEndpoint {
     ip::Address address;
     net::Port port;
+    bool operator==(const GenericEndpoint&) const noexcept = default;
 };
 
 struct UdpEndpointTag{};
@@ -40,6 +41,7 @@ public:
     bool is_udp() const noexcept;
     const ip::Address& address() const noexcept;
     net::Port port() const noexcept;
+    bool operator==(const Endpoint&) const noexcept = default;
 
 private:
     Value m_value;
@@ -7,12 +7,24 @@
 //
 
 #include <functional>
+#include <string_view>
 #include "precis/precis_opaque_string.hpp"
 
 namespace freewebrtc::precis {
 
+// Hash and equality support lookup by string view without
+// creation of OpaqueString (heterogeneous lookup).
 struct OpaqueStringHash {
+    using is_transparent = void;
     size_t operator()(const OpaqueString& s) const noexcept;
+    size_t operator()(std::string_view) const noexcept;
+};
+
+struct OpaqueStringEqual {
+    using is_transparent = void;
+    bool operator()(const OpaqueString&, const OpaqueString&) const noexcept;
+    bool operator()(const OpaqueString&, std::string_view) const noexcept;
+    bool operator()(std::string_view, const OpaqueString&) const noexcept;
 };
 
 //
@@ -23,4 +35,22 @@ inline size_t OpaqueStringHash::operator()(const OpaqueString& s) const noexcept
     return hasher(s.value);
 }
 
+inline size_t OpaqueStringHash::operator()(std::string_view s) const noexcept {
+    // Same as hash of std::string with the same characters
+    std::hash<std::string_view> hasher;
+    return hasher(s);
+}
+
+inline bool OpaqueStringEqual::operator()(const OpaqueString& a, const OpaqueString& b) const noexcept {
+    return a.value == b.value;
+}
+
+inline bool OpaqueStringEqual::operator()(const OpaqueString& a, std::string_view b) const noexcept {
+    return a.value == b;
+}
+
+inline bool OpaqueStringEqual::operator()(std::string_view a, const OpaqueString& b) const noexcept {
+    return a == b.value;
+}
+
 }
@@ -5,15 +5,21 @@
 //
 // Statistics / Counter for statistics
 //
+// Counter is updated by one thread but it may be read by other
+// threads (e.g. sum of per-thread shards, see stat::Sharded).
+//
 
 #pragma once
 
+#include <atomic>
+
 namespace freewebrtc::stat {
 
 class Counter {
 public:
     using ValueType = unsigned;
     void inc() noexcept;
+    void add(ValueType) noexcept;
 
     ValueType count() const noexcept;
 private:
@@ -24,11 +30,16 @@ private:
 // inlines
 //
 inline void Counter::inc() noexcept {
-    m_value++;
+    add(1);
+}
+
+inline void Counter::add(ValueType v) noexcept {
+    // Not read-modify-write: only owning thread writes the value
+    std::atomic_ref<ValueType>(m_value).store(m_value + v, std::memory_order_relaxed);
 }
 
 inline Counter::ValueType Counter::count() const noexcept {
-    return m_value;
+    return std::atomic_ref<const ValueType>(m_value).load(std::memory_order_relaxed);
 }
 
 
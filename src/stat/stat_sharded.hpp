@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Per-thread shards of statistics
+//
+// Each running thread updates its own shard (selected by
+// util::thread_index) so shard is written by one thread only and
+// T does not need atomic updates (e.g. stat::Counter). Shards are
+// summed on read. Shards are aligned to cache line so threads do
+// not share cache lines. Shards are allocated by segments when
+// thread with new index uses them first.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+
+#include "util/util_thread_index.hpp"
+
+namespace freewebrtc::stat {
+
+template<typename T>
+class Sharded {
+public:
+    // Shards of the first segment. Each next segment is twice
+    // larger than previous.
+    static constexpr size_t DEFAULT_SHARDS = 64;
+    explicit Sharded(size_t shards = DEFAULT_SHARDS);
+    Sharded(const Sharded&) = delete;
+    Sharded& operator=(const Sharded&) = delete;
+    ~Sharded();
+
+    // Shard of the calling thread
+    T& local();
+    // Sum of all shards. Add is function (T& sum, const T& shard).
+    template<typename Add>
+    T sum(Add&&) const;
+
+private:
+    struct alignas(64) Shard {
+        T value;
+    };
+    static constexpr size_t MAX_SEGMENTS = 32;
+    size_t segment_size(size_t segment) const noexcept;
+    Shard& allocate(size_t segment, size_t offset);
+
+    const size_t m_first;
+    std::array<std::atomic<Shard*>, MAX_SEGMENTS> m_segments;
+};
+
+//
+// implementation
+//
+template<typename T>
+Sharded<T>::Sharded(size_t shards)
+    : m_first(shards == 0 ? 1 : shards)
+{
+    for (auto& s: m_segments) {
+        s.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+Sharded<T>::~Sharded() {
+    for (auto& s: m_segments) {
+        delete[] s.load(std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+T& Sharded<T>::local() {
+    // Segment k contains indices starting from m_first * (2^k - 1)
+    const size_t index = util::thread_index();
+    const size_t segment = std::bit_width(index / m_first + 1) - 1;
+    const size_t offset = index - m_first * ((size_t{1} << segment) - 1);
+    Shard* shards = m_segments[segment].load(std::memory_order_acquire);
+    if (shards == nullptr) {
+        return allocate(segment, offset).value;
+    }
+    return shards[offset].value;
+}
+
+template<typename T>
+template<typename Add>
+T Sharded<T>::sum(Add&& add) const {
+    T result{};
+    // Segments may be allocated in any order
+    for (size_t k = 0; k < MAX_SEGMENTS; ++k) {
+        const Shard* shards = m_segments[k].load(std::memory_order_acquire);
+        if (shards == nullptr) {
+            continue;
+        }
+        for (size_t i = 0; i < segment_size(k); ++i) {
+            add(result, shards[i].value);
+        }
+    }
+    return result;
+}
+
+template<typename T>
+size_t Sharded<T>::segment_size(size_t segment) const noexcept {
+    return m_first << segment;
+}
+
+template<typename T>
+typename Sharded<T>::Shard& Sharded<T>::allocate(size_t segment, size_t offset) {
+    Shard* expected = nullptr;
+    Shard* shards = new Shard[segment_size(segment)]();
+    // Other thread may allocate the same segment at once
+    if (!m_segments[segment].compare_exchange_strong(expected, shards, std::memory_order_acq_rel)) {
+        delete[] shards;
+        shards = expected;
+    }
+    return shards[offset];
+}
+
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Send pacing for STUN UDP Client
+//
+
+#include <algorithm>
+#include "stun/details/stun_client_udp_pacer.hpp"
+
+namespace freewebrtc::stun::details {
+
+ClientUDPPacer::ClientUDPPacer(Duration interval, unsigned burst_size)
+    : m_interval(interval)
+    , m_tolerance(interval * (std::max(burst_size, 1u) - 1))
+    , m_tat(Timepoint::epoch())
+{}
+
+void ClientUDPPacer::push(const Handle& hnd) {
+    m_queue.push_back(hnd);
+}
+
+Maybe<ClientUDPPacer::Handle> ClientUDPPacer::ready(Timepoint now) const noexcept {
+    if (m_queue.empty() || !allowed(now)) {
+        return none();
+    }
+    return m_queue.front();
+}
+
+void ClientUDPPacer::release(Timepoint now) {
+    m_queue.pop_front();
+    // Bucket is refilled while clock goes ahead of
+    // theoretical time of the next send.
+    m_tat = m_tat.is_before(now) ? now : m_tat;
+    m_tat = m_tat.advance(m_interval);
+}
+
+void ClientUDPPacer::drop() {
+    m_queue.pop_front();
+}
+
+Maybe<ClientUDPPacer::Timepoint> ClientUDPPacer::next_release() const noexcept {
+    if (m_queue.empty()) {
+        return none();
+    }
+    return m_tat.advance(-m_tolerance);
+}
+
+size_t ClientUDPPacer::size() const noexcept {
+    return m_queue.size();
+}
+
+bool ClientUDPPacer::allowed(Timepoint now) const noexcept {
+    return !now.advance(m_tolerance).is_before(m_tat);
+}
+
+}
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Send pacing for STUN UDP Client
+//
+// Sends of all transactions are released not more often than once
+// per pacing interval (Ta in RFC8445). Token bucket allows burst
+// of sends after idle period. Bucket is implemented as generic cell
+// rate algorithm: only theoretical time of the next send is stored.
+//
+
+#pragma once
+
+#include <deque>
+
+#include "clock/clock_timepoint.hpp"
+#include "util/util_maybe.hpp"
+#include "stun/stun_client_udp_handle.hpp"
+
+namespace freewebrtc::stun::details {
+
+class ClientUDPPacer {
+public:
+    using Duration = clock::NativeDuration;
+    using Timepoint = clock::Timepoint;
+    using Handle = client_udp::Handle;
+    ClientUDPPacer(Duration interval, unsigned burst_size);
+
+    // Queue send of the transaction
+    void push(const Handle&);
+    // First queued send if it is allowed at now
+    Maybe<Handle> ready(Timepoint now) const noexcept;
+    // Remove ready send from the queue and consume token
+    void release(Timepoint now);
+    // Remove first send from the queue without token
+    // consumption (e.g. transaction is finished).
+    void drop();
+    // Time when first queued send is allowed. None if
+    // nothing is queued.
+    Maybe<Timepoint> next_release() const noexcept;
+    size_t size() const noexcept;
+
+private:
+    bool allowed(Timepoint now) const noexcept;
+
+    const Duration m_interval;
+    // Time that bucket is allowed to be ahead of now
+    const Duration m_tolerance;
+    // Theoretical time of the next send if bucket is empty
+    Timepoint m_tat;
+    std::deque<Handle> m_queue;
+};
+
+}
@@ -5,48 +5,254 @@
 //
 // Retransmit timeout (RTO) calculation for STUN UDP Client
 
+#include <algorithm>
 #include <cmath>
 #include "stun/details/stun_client_udp_rto.hpp"
+#include "stun/stun_error.hpp"
+#include "util/util_variant_overloaded.hpp"
 
 
 namespace freewebrtc::stun::details {
 
 using Duration = ClientUDPRtoCalculator::Duration;
 
+namespace {
+
+template<size_t SIZE>
+net::ip::details::Address<SIZE> mask_address(const net::ip::details::Address<SIZE>& addr, unsigned prefix_len) {
+    typename net::ip::details::Address<SIZE>::Value value;
+    const auto vv = addr.view();
+    std::copy(vv.begin(), vv.end(), value.begin());
+    for (size_t i = 0; i < value.size(); ++i) {
+        const size_t bit = i * 8;
+        if (bit >= prefix_len) {
+            value[i] = 0;
+        } else if (bit + 8 > prefix_len) {
+            value[i] &= uint8_t(0xff << (bit + 8 - prefix_len));
+        }
+    }
+    return net::ip::details::Address<SIZE>(std::move(value));
+}
+
+// Snapshot format (network byte order):
+//   magic "RTO" | version (1 byte)
+//   number of paths (4 bytes) | number of prefixes (4 bytes)
+//   entries of paths and then entries of prefixes
+// Entry:
+//   flags (1 byte) | source address | target address |
+//   age in milliseconds (4 bytes) |
+//   [SRTT, RTTVAR in microseconds (4 bytes each)] |
+//   [backoff in microseconds (4 bytes)]
+constexpr std::array<uint8_t, 4> SNAPSHOT_MAGIC = {'R', 'T', 'O', 1};
+constexpr uint8_t FLAG_SOURCE_IPV6 = 0x01;
+constexpr uint8_t FLAG_TARGET_IPV6 = 0x02;
+constexpr uint8_t FLAG_SMOOTH      = 0x04;
+constexpr uint8_t FLAG_BACKOFF     = 0x08;
+
+void write_u32(util::ByteVec& out, uint32_t v) {
+    for (size_t i = 0; i < sizeof(v); ++i) {
+        out.push_back(uint8_t(v >> (8 * (sizeof(v) - 1 - i))));
+    }
+}
+
+// Durations are saturated to 32 bits
+template<typename D>
+void write_duration(util::ByteVec& out, Duration d) {
+    const auto count = std::chrono::duration_cast<D>(d).count();
+    write_u32(out, uint32_t(std::clamp<int64_t>(count, 0, UINT32_MAX)));
+}
+
+void write_address(util::ByteVec& out, const net::ip::Address& addr) {
+    const auto vv = addr.view();
+    out.insert(out.end(), vv.begin(), vv.end());
+}
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const util::ConstBinaryView& vv)
+        : m_view(vv)
+    {}
+    Maybe<uint8_t> u8() {
+        return m_view.read_u8(m_offset).fmap([&](uint8_t v) { m_offset += 1; return v; });
+    }
+    Maybe<uint32_t> u32() {
+        return m_view.read_u32be(m_offset).fmap([&](uint32_t v) { m_offset += 4; return v; });
+    }
+    template<typename D>
+    Maybe<Duration> duration() {
+        return u32().fmap([](uint32_t v) { return std::chrono::duration_cast<Duration>(D(v)); });
+    }
+    Maybe<net::ip::Address> address(bool is_ipv6) {
+        const size_t size = is_ipv6 ? net::ip::AddressV6::size() : net::ip::AddressV4::size();
+        return m_view.subview(m_offset, size)
+            .bind([&](const util::ConstBinaryView& vv) -> Maybe<net::ip::Address> {
+                m_offset += size;
+                if (is_ipv6) {
+                    return net::ip::Address(net::ip::AddressV6::from_view(vv).unwrap());
+                }
+                return net::ip::Address(net::ip::AddressV4::from_view(vv).unwrap());
+            });
+    }
+    bool is_end() const noexcept {
+        return m_offset == m_view.size();
+    }
+private:
+    util::ConstBinaryView m_view;
+    size_t m_offset = 0;
+};
+
+}
+
 ClientUDPRtoCalculator::ClientUDPRtoCalculator(const Settings& settings)
     : m_settings(settings)
-    , m_timeline(&Data::link)
+    , m_paths(settings.max_paths, settings.history_duration)
+    , m_prefixes(settings.maybe_prefix_aggregation
+                    .fmap([](const auto& aggr) { return aggr.max_prefixes; })
+                    .value_or(0),
+                 settings.history_duration)
 {}
 
 Duration ClientUDPRtoCalculator::rto(const net::Path& path) const {
-    auto it = m_by_path.find(path);
-    if (it == m_by_path.end()) {
-        return m_settings.initial_rto;
-    }
-    const auto& data = it->second;
-    static constexpr unsigned K = 4;
+    // Use smoothed RTT of the prefix if there is no RTT of the
+    // path itself.
+    auto prefix_rto = [&] {
+        return m_settings.maybe_prefix_aggregation
+            .bind([&](const auto& aggr) { return m_prefixes.find(prefix_path(path, aggr)); })
+            .bind([&](const DataRef& data) { return smooth_rto(data.get()); })
+            .value_or(m_settings.initial_rto);
+    };
     // Karn's algorithm:
     // Use previous backoff for further RTO until
     // we get reliable RTT value.
-    return data.backoff
-        .value_or(
-            data.smooth.fmap([](auto&& s) { return s.srtt + K * s.rttvar; })
-                .value_or(m_settings.initial_rto));
+    return m_paths.find(path)
+        .bind([&](const DataRef& data) {
+            return data.get().backoff.is_some() ? data.get().backoff : smooth_rto(data.get());
+        })
+        .value_or_call(prefix_rto);
 }
 
 void ClientUDPRtoCalculator::new_rtt(Timepoint now, const net::Path& path, Duration rtt) {
-    auto it = m_by_path.find(path);
-    if (it == m_by_path.end()) {
-        auto [it2, _] = m_by_path.emplace(path, Data{path, now});
-        it = it2;
-    }
-    auto& data = it->second;
-    data.last_update = now;
-    m_timeline.push_back(data);
-    clear_outdated(now);
+    auto& data = m_paths.update(now, path);
     // Clear backoff value for further requests
     data.backoff = none();
-    // Update SRTT
+    update_smooth(data, rtt);
+    m_settings.maybe_prefix_aggregation
+        .with_inner([&](const auto& aggr) {
+            update_smooth(m_prefixes.update(now, prefix_path(path, aggr)), rtt);
+        });
+}
+
+void ClientUDPRtoCalculator::backoff(Timepoint now, const net::Path& path, Duration backoff) {
+    m_paths.update(now, path).backoff = backoff;
+}
+
+size_t ClientUDPRtoCalculator::paths_count() const noexcept {
+    return m_paths.size();
+}
+
+size_t ClientUDPRtoCalculator::prefixes_count() const noexcept {
+    return m_prefixes.size();
+}
+
+util::ByteVec ClientUDPRtoCalculator::snapshot(Timepoint now) const {
+    util::ByteVec result(SNAPSHOT_MAGIC.begin(), SNAPSHOT_MAGIC.end());
+    write_u32(result, uint32_t(m_paths.size()));
+    write_u32(result, uint32_t(m_prefixes.size()));
+    for (const History *history: {&m_paths, &m_prefixes}) {
+        for (const auto& ref: history->ordered()) {
+            const Data& data = ref.get();
+            const uint8_t flags =
+                (std::holds_alternative<net::ip::AddressV6>(data.path.source.value()) ? FLAG_SOURCE_IPV6 : 0)
+                | (std::holds_alternative<net::ip::AddressV6>(data.path.target.value()) ? FLAG_TARGET_IPV6 : 0)
+                | (data.smooth.is_some() ? FLAG_SMOOTH : 0)
+                | (data.backoff.is_some() ? FLAG_BACKOFF : 0);
+            result.push_back(flags);
+            write_address(result, data.path.source);
+            write_address(result, data.path.target);
+            write_duration<std::chrono::milliseconds>(result, history->age(now, data));
+            data.smooth
+                .with_inner([&](const Data::SmoothVals& smooth) {
+                    write_duration<std::chrono::microseconds>(result, smooth.srtt);
+                    write_duration<std::chrono::microseconds>(result, smooth.rttvar);
+                });
+            data.backoff
+                .with_inner([&](const Duration& backoff) {
+                    write_duration<std::chrono::microseconds>(result, backoff);
+                });
+        }
+    }
+    return result;
+}
+
+MaybeError ClientUDPRtoCalculator::restore(Timepoint now, const util::ConstBinaryView& vv, Duration elapsed) {
+    const auto invalid = make_error_code(ClientError::invalid_rto_snapshot);
+    SnapshotReader reader(vv);
+    for (const auto& magic: SNAPSHOT_MAGIC) {
+        if (reader.u8() != Maybe<uint8_t>{magic}) {
+            return invalid;
+        }
+    }
+    const auto maybe_paths = reader.u32();
+    const auto maybe_prefixes = reader.u32();
+    if (maybe_paths.is_none() || maybe_prefixes.is_none()) {
+        return invalid;
+    }
+    // Whole snapshot is checked before it is applied
+    std::vector<Restored> paths;
+    std::vector<Restored> prefixes;
+    struct Section {
+        uint32_t count;
+        std::vector<Restored>& entries;
+    };
+    for (auto& section: {Section{maybe_paths.unwrap(), paths},
+                         Section{maybe_prefixes.unwrap(), prefixes}}) {
+        for (uint32_t i = 0; i < section.count; ++i) {
+            const auto maybe_flags = reader.u8();
+            if (maybe_flags.is_none()) {
+                return invalid;
+            }
+            const uint8_t flags = maybe_flags.unwrap();
+            auto maybe_source = reader.address(flags & FLAG_SOURCE_IPV6);
+            auto maybe_target = reader.address(flags & FLAG_TARGET_IPV6);
+            const auto maybe_age = reader.duration<std::chrono::milliseconds>();
+            Maybe<Data::SmoothVals> maybe_smooth = none();
+            if (flags & FLAG_SMOOTH) {
+                const auto srtt = reader.duration<std::chrono::microseconds>();
+                const auto rttvar = reader.duration<std::chrono::microseconds>();
+                if (srtt.is_none() || rttvar.is_none()) {
+                    return invalid;
+                }
+                maybe_smooth = Data::SmoothVals{srtt.unwrap(), rttvar.unwrap()};
+            }
+            Maybe<Duration> maybe_backoff = none();
+            if (flags & FLAG_BACKOFF) {
+                maybe_backoff = reader.duration<std::chrono::microseconds>();
+                if (maybe_backoff.is_none()) {
+                    return invalid;
+                }
+            }
+            if (maybe_source.is_none() || maybe_target.is_none() || maybe_age.is_none()) {
+                return invalid;
+            }
+            section.entries.push_back(Restored{
+                net::Path{maybe_source.unwrap(), maybe_target.unwrap()},
+                maybe_age.unwrap() + elapsed,
+                maybe_smooth,
+                maybe_backoff
+            });
+        }
+    }
+    if (!reader.is_end()) {
+        return invalid;
+    }
+    m_paths.restore(now, paths);
+    if (m_settings.maybe_prefix_aggregation.is_some()) {
+        m_prefixes.restore(now, prefixes);
+    }
+    return success();
+}
+
+void ClientUDPRtoCalculator::update_smooth(Data& data, Duration rtt) {
     data.smooth = data.smooth
         .fmap([&](Data::SmoothVals smooth) -> Data::SmoothVals {
             auto& rttvar = smooth.rttvar;
@@ -71,25 +277,123 @@ void ClientUDPRtoCalculator::new_rtt(Timepoint now, const net::Path& path, Durat
         .value_or(Data::SmoothVals{rtt, rtt / 2});
 }
 
-void ClientUDPRtoCalculator::backoff(Timepoint now, const net::Path& path, Duration backoff) {
+Maybe<Duration> ClientUDPRtoCalculator::smooth_rto(const Data& data) const noexcept {
+    static constexpr unsigned K = 4;
+    return data.smooth.fmap([](auto&& s) { return s.srtt + K * s.rttvar; });
+}
+
+net::Path ClientUDPRtoCalculator::prefix_path(const net::Path& path, const Settings::PrefixAggregation& aggr) const {
+    return net::Path{
+        path.source,
+        std::visit(
+            util::overloaded {
+                [&](const net::ip::AddressV4& v4) -> net::ip::Address {
+                    return mask_address(v4, aggr.ipv4_prefix_len);
+                },
+                [&](const net::ip::AddressV6& v6) -> net::ip::Address {
+                    return mask_address(v6, aggr.ipv6_prefix_len);
+                }
+            },
+            path.target.value())
+    };
+}
+
+ClientUDPRtoCalculator::History::History(size_t max_size, Duration duration)
+    : m_max_size(std::max<size_t>(max_size, 1))
+    , m_duration(duration)
+    , m_timeline(&Data::link)
+{}
+
+Maybe<ClientUDPRtoCalculator::DataRef> ClientUDPRtoCalculator::History::find(const net::Path& path) const noexcept {
     auto it = m_by_path.find(path);
     if (it == m_by_path.end()) {
-        auto [it, _] = m_by_path.emplace(path, Data{path, now, backoff});
-        m_timeline.push_back(it->second);
-        return;
+        return none();
     }
-    auto& data = it->second;
-    data.last_update = now;
+    return std::cref(it->second);
+}
+
+ClientUDPRtoCalculator::Data& ClientUDPRtoCalculator::History::update(Timepoint now, const net::Path& path) {
+    const Timepoint expires = now.advance(m_duration);
+    auto it = m_by_path.find(path);
+    Data& data = it != m_by_path.end() ? it->second : emplace(path, expires);
+    data.expires = expires;
     m_timeline.push_back(data);
-    data.backoff = backoff;
     clear_outdated(now);
+    return data;
+}
+
+void ClientUDPRtoCalculator::History::restore(Timepoint now, const std::vector<Restored>& entries) {
+    clear_outdated(now);
+    for (const auto& entry: entries) {
+        if (entry.age > m_duration) {
+            continue;
+        }
+        auto [it, inserted] = m_by_path.try_emplace(entry.path, entry.path, now.advance(m_duration - entry.age));
+        if (inserted) {
+            it->second.smooth = entry.smooth;
+            it->second.backoff = entry.backoff;
+        }
+    }
+    // Restored data may be older than known data so timeline is
+    // rebuilt in order of expiration.
+    std::vector<MutDataRef> all;
+    all.reserve(m_by_path.size());
+    for (auto& [_, data]: m_by_path) {
+        all.emplace_back(data);
+    }
+    std::sort(all.begin(), all.end(),
+              [](const MutDataRef& a, const MutDataRef& b) {
+                  return a.get().expires.is_before(b.get().expires);
+              });
+    m_timeline.clear();
+    for (Data& data: all) {
+        m_timeline.push_back(data);
+    }
+    // Drop least recently updated data to keep the limit
+    while (m_by_path.size() > m_max_size) {
+        const net::Path oldest_path = m_timeline.front().unwrap().get().path;
+        m_by_path.erase(oldest_path);
+    }
+}
+
+size_t ClientUDPRtoCalculator::History::size() const noexcept {
+    return m_by_path.size();
 }
 
-void ClientUDPRtoCalculator::clear_outdated(Timepoint now) {
+std::vector<ClientUDPRtoCalculator::DataRef> ClientUDPRtoCalculator::History::ordered() const {
+    std::vector<DataRef> result;
+    result.reserve(m_by_path.size());
+    for (const auto& [_, data]: m_by_path) {
+        result.emplace_back(data);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const DataRef& a, const DataRef& b) {
+                  return a.get().expires.is_before(b.get().expires);
+              });
+    return result;
+}
+
+Duration ClientUDPRtoCalculator::History::age(Timepoint now, const Data& data) const noexcept {
+    return std::max(m_duration - (data.expires - now), Duration{0});
+}
+
+ClientUDPRtoCalculator::Data& ClientUDPRtoCalculator::History::emplace(const net::Path& path, Timepoint expires) {
+    // Drop least recently updated data to keep the limit
+    if (m_by_path.size() >= m_max_size) {
+        m_timeline.front()
+            .with_inner([&](Data& oldest) {
+                const net::Path oldest_path = oldest.path;
+                m_by_path.erase(oldest_path);
+            });
+    }
+    return m_by_path.emplace(path, Data{path, expires}).first->second;
+}
+
+void ClientUDPRtoCalculator::History::clear_outdated(Timepoint now) {
     while (
         m_timeline.front()
         .fmap([&](auto&& front) {
-            if (now - front.get().last_update > m_settings.history_duration) {
+            if (now.is_after(front.get().expires)) {
                 m_by_path.erase(front.get().path);
                 return true;
             }
@@ -99,31 +403,20 @@ void ClientUDPRtoCalculator::clear_outdated(Timepoint now) {
     }
 }
 
-ClientUDPRtoCalculator::Data::Data(const net::Path& p, Timepoint now)
+ClientUDPRtoCalculator::Data::Data(const net::Path& p, Timepoint exp)
     : path(p)
-    , last_update(now)
+    , expires(exp)
     , smooth(none())
     , backoff(none())
     , link(*this)
 {}
 
-ClientUDPRtoCalculator::Data::Data(const net::Path& p, Timepoint now, Duration backoff_)
-    : path(p)
-    , last_update(now)
-    , smooth(none())
-    , backoff(backoff_)
-    , link(*this)
-{}
-
 ClientUDPRtoCalculator::Data::Data(Data&& other)
     : path(std::move(other.path))
-    , last_update(other.last_update)
+    , expires(other.expires)
     , smooth(other.smooth)
     , backoff(other.backoff)
     , link(*this, std::move(other.link))
 {}
 
 }
-
-
-
@@ -17,9 +17,12 @@
 
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
 #include "clock/clock_timepoint.hpp"
 #include "util/util_intrusive_list.hpp"
+#include "util/util_binary_view.hpp"
+#include "util/util_result.hpp"
 #include "net/net_path.hpp"
 #include "net/net_path_hash.hpp"
 #include "stun/stun_client_udp_settings.hpp"
@@ -40,16 +43,28 @@ public:
     // Update RTO to backoff timeout if sent with retransmits.
     void backoff(Timepoint now, const net::Path&, Duration backoff);
 
+    // Number of network paths / prefixes in history
+    size_t paths_count() const noexcept;
+    size_t prefixes_count() const noexcept;
+
+    // Compact binary snapshot of the history to warm up
+    // calculator after restart.
+    util::ByteVec snapshot(Timepoint now) const;
+    // Load snapshot that was taken elapsed time ago. Data that is
+    // older than history duration is dropped. Data of the paths
+    // that are already known is not changed. Nothing is changed
+    // if snapshot is invalid.
+    MaybeError restore(Timepoint now, const util::ConstBinaryView&, Duration elapsed = Duration{0});
+
 private:
-    void clear_outdated(Timepoint now);
     struct Data;
     using Timeline = util::IntrusiveList<Data>;
     struct Data {
         Data(const net::Path&, Timepoint);
-        Data(const net::Path&, Timepoint, Duration);
         Data(Data&&);
         net::Path path;
-        Timepoint last_update;
+        // Time when data is dropped if it is not updated
+        Timepoint expires;
         struct SmoothVals {
             Duration srtt;
             Duration rttvar;
@@ -58,13 +73,46 @@ private:
         Maybe<Duration> backoff;
         Timeline::Link link;
     };
-    using ByPath = std::unordered_map<net::Path, Data, net::PathHash>;
+    using DataRef = std::reference_wrapper<const Data>;
+    using MutDataRef = std::reference_wrapper<Data>;
+    // Entry of the snapshot
+    struct Restored {
+        net::Path path;
+        Duration age;
+        Maybe<Data::SmoothVals> smooth;
+        Maybe<Duration> backoff;
+    };
+    // Data by path with limited size and lifetime. Timeline is
+    // ordered by last update so the oldest data is dropped first.
+    class History {
+    public:
+        History(size_t max_size, Duration duration);
+        Maybe<DataRef> find(const net::Path&) const noexcept;
+        // Find or create data and mark it as updated
+        Data& update(Timepoint now, const net::Path&);
+        // Add data of unknown paths that were updated age ago.
+        // Data that is older than history duration is not added.
+        void restore(Timepoint now, const std::vector<Restored>&);
+        size_t size() const noexcept;
+        // Data in order of update (oldest first)
+        std::vector<DataRef> ordered() const;
+        Duration age(Timepoint now, const Data&) const noexcept;
+    private:
+        Data& emplace(const net::Path&, Timepoint expires);
+        void clear_outdated(Timepoint now);
+        using ByPath = std::unordered_map<net::Path, Data, net::PathHash>;
+        const size_t m_max_size;
+        const Duration m_duration;
+        ByPath   m_by_path;
+        Timeline m_timeline;
+    };
+    static void update_smooth(Data&, Duration rtt);
+    Maybe<Duration> smooth_rto(const Data&) const noexcept;
+    net::Path prefix_path(const net::Path&, const Settings::PrefixAggregation&) const;
 
     const Settings m_settings;
-    ByPath   m_by_path;
-    Timeline m_timeline;
+    History m_paths;
+    History m_prefixes;
 };
 
 }
-
-
@@ -19,4 +19,19 @@ uint32_t crc32(const std::vector<util::ConstBinaryView>& vv);
 
 static constexpr uint32_t FINGERPRINT_XOR = 0x5354554e;
 
+// CRC-32 implementations. Functions above use the best
+// implementation supported by CPU (selected once at runtime).
+enum class CRC32Impl {
+    bytewise,       // One byte per step (reference)
+    slice_by_8,     // Eight bytes per step using 8 tables
+    pclmul,         // x86-64 PCLMULQDQ folding
+    armv8_crc       // ARMv8 CRC32 instructions
+};
+
+bool crc32_is_supported(CRC32Impl);
+CRC32Impl crc32_best_impl();
+// Calculate CRC-32 using specific implementation.
+// Implementation must be supported by CPU.
+uint32_t crc32(const util::ConstBinaryView& vv, CRC32Impl);
+
 }
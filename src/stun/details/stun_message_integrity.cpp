@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN MESSAGE-INTEGRITY calculation
+//
+
+#include "stun/details/stun_message_integrity.hpp"
+#include "stun/details/stun_constants.hpp"
+#include "stun/stun_error.hpp"
+
+namespace freewebrtc::stun::details {
+
+namespace {
+
+IntegrityHeader integrity_header(uint8_t type_hi, uint8_t type_lo, size_t integrity_offset) {
+    // RFC8489: 14.5.  MESSAGE-INTEGRITY
+    // The length MUST then
+    // be set to point to the length of the message up to, and including,
+    // the MESSAGE-INTEGRITY attribute itself, but excluding any attributes
+    // after it.
+    const size_t integrity_message_len = integrity_offset + STUN_ATTR_HEADER_SIZE + crypto::SHA1Hash::size - STUN_HEADER_SIZE;
+    return {
+        type_hi,
+        type_lo,
+        uint8_t((integrity_message_len >> 8) & 0xFF),
+        uint8_t(integrity_message_len & 0xFF)
+    };
+}
+
+Result<MessageIntegityAttribute::Digest> hmac_digest(const crypto::SHA1Hash::Input& data, const Password& p, crypto::SHA1Hash::Func hash) {
+    return p.precomputed()
+        .fmap([&](const auto& key) {
+            return key.digest(data);
+        })
+        .value_or_call([&] {
+            return crypto::hmac::digest(data, p.opad(), p.ipad(), hash);
+        });
+}
+
+Result<MessageIntegityAttribute::Digest> hmac_digest(const crypto::SHA1Hash::Input& data, const IntegrityData& idata) {
+    return hmac_digest(data, idata.password, idata.hash);
+}
+
+}
+
+Result<IntegrityHeader> integrity_header(const util::ConstBinaryView& data, size_t integrity_offset) {
+    if (integrity_offset < STUN_HEADER_SIZE || integrity_offset > data.size()) {
+        return make_error_code(ParseError::invalid_message_size);
+    }
+    return integrity_header(data.data()[0], data.data()[1], integrity_offset);
+}
+
+Result<MessageIntegityAttribute::Digest> integrity_digest(const util::ConstBinaryView& data,
+                                                          size_t integrity_offset,
+                                                          const IntegrityData& idata) {
+    return integrity_digest(data, integrity_offset, idata.password, idata.hash);
+}
+
+Result<MessageIntegityAttribute::Digest> integrity_digest(const util::ConstBinaryView& data,
+                                                          size_t integrity_offset,
+                                                          const Password& password,
+                                                          crypto::SHA1Hash::Func hash) {
+    using View = util::ConstBinaryView;
+    return integrity_header(data, integrity_offset)
+        .bind([&](const IntegrityHeader& header) {
+            return hmac_digest({View(header), data.assured_subview(4, integrity_offset - 4)}, password, hash);
+        });
+}
+
+Result<MessageIntegityAttribute::Digest> integrity_digest(const std::vector<util::ConstBinaryView>& views,
+                                                          const IntegrityData& idata) {
+    using View = util::ConstBinaryView;
+    size_t integrity_offset = 0;
+    for (const auto& v: views) {
+        integrity_offset += v.size();
+    }
+    if (integrity_offset < STUN_HEADER_SIZE || views.front().size() < 4) {
+        return make_error_code(ParseError::invalid_message_size);
+    }
+    const auto& first = views.front();
+    const auto header = integrity_header(first.data()[0], first.data()[1], integrity_offset);
+    const View header_view(header);
+    const auto first_rest = first.assured_subview(4);
+    const crypto::SHA1Hash::Input rest{std::span<const View>(views).subspan(1)};
+    const crypto::SHA1Hash::Input tail(first_rest, rest);
+    return hmac_digest(crypto::SHA1Hash::Input(header_view, tail), idata);
+}
+
+}
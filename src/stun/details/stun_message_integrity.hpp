@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN MESSAGE-INTEGRITY calculation
+//
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "util/util_binary_view.hpp"
+#include "util/util_result.hpp"
+#include "stun/stun_attribute.hpp"
+#include "stun/stun_integrity.hpp"
+
+namespace freewebrtc::stun::details {
+
+// Calculate MESSAGE-INTEGRITY of the message in data where
+// MESSAGE-INTEGRITY attribute starts at integrity_offset.
+// Length in the STUN header is substituted as if MESSAGE-INTEGRITY
+// were the last attribute of the message.
+Result<MessageIntegityAttribute::Digest> integrity_digest(const util::ConstBinaryView& data,
+                                                          size_t integrity_offset,
+                                                          const IntegrityData&);
+// Same as above without copy of the password to IntegrityData
+Result<MessageIntegityAttribute::Digest> integrity_digest(const util::ConstBinaryView& data,
+                                                          size_t integrity_offset,
+                                                          const Password&,
+                                                          crypto::SHA1Hash::Func);
+// STUN header prefix (message type and length) that replaces
+// the original one in MESSAGE-INTEGRITY calculation.
+using IntegrityHeader = std::array<uint8_t, 4>;
+Result<IntegrityHeader> integrity_header(const util::ConstBinaryView& data, size_t integrity_offset);
+// Same as above but message up to MESSAGE-INTEGRITY attribute
+// is represented as list of views.
+Result<MessageIntegityAttribute::Digest> integrity_digest(const std::vector<util::ConstBinaryView>& views,
+                                                          const IntegrityData&);
+
+}
@@ -6,6 +6,8 @@
 // STUN Attribute
 //
 
+#include <cstring>
+
 #include "stun/stun_attribute.hpp"
 #include "stun/stun_error.hpp"
 #include "stun/stun_parse_stat.hpp"
@@ -111,6 +113,23 @@ Result<MappedAddressAttribute> MappedAddressAttribute::parse(const util::ConstBi
 }
 
 util::ByteVec MappedAddressAttribute::build() const {
+    util::ByteVec result(value_size());
+    build_into(result);
+    return result;
+}
+
+size_t MappedAddressAttribute::value_size() const noexcept {
+    return sizeof(uint32_t) + addr.view().size();
+}
+
+void MappedAddressAttribute::build_into(std::span<uint8_t> out) const noexcept {
+    //  0                   1                   2                   3
+    //  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    // |0 0 0 0 0 0 0 0|    Family     |           Port                |
+    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    // |                 Address (32 bits or 128 bits)                 |
+    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     auto [family, view]
         = std::visit(
             util::overloaded {
@@ -121,11 +140,9 @@ util::ByteVec MappedAddressAttribute::build() const {
                     return std::make_pair(attr_registry::FAMILY_IPV6, a.view());
                 }
             }, addr.value());
-    const uint32_t first_word = util::host_to_network_u32(port.value() | (family >> 16));
-    return util::ConstBinaryView::concat({
-            util::ConstBinaryView(&first_word, sizeof(first_word)),
-            view
-        });
+    const uint32_t first_word = util::host_to_network_u32(port.value() | (family << 16));
+    memcpy(out.data(), &first_word, sizeof(first_word));
+    std::copy(view.begin(), view.end(), out.begin() + sizeof(first_word));
 }
 
 Result<XorMappedAddressAttribute> XorMappedAddressAttribute::parse(const util::ConstBinaryView& vv, ParseStat& stat) {
@@ -169,13 +186,22 @@ Result<XorMappedAddressAttribute> XorMappedAddressAttribute::parse(const util::C
 }
 
 util::ByteVec XorMappedAddressAttribute::build() const {
+    util::ByteVec result(value_size());
+    build_into(result);
+    return result;
+}
+
+size_t XorMappedAddressAttribute::value_size() const noexcept {
+    return sizeof(uint32_t) + addr.view().size();
+}
+
+void XorMappedAddressAttribute::build_into(std::span<uint8_t> out) const noexcept {
     const uint16_t xport = port.value() ^ (details::MAGIC_COOKIE >> 16);
     const uint8_t family = addr.family().to_uint8();
     const uint32_t first_word = util::host_to_network_u32(xport | (family << 16));
-    return util::ConstBinaryView::concat({
-            util::ConstBinaryView(&first_word, sizeof(first_word)),
-            addr.view()
-        });
+    const auto view = addr.view();
+    memcpy(out.data(), &first_word, sizeof(first_word));
+    std::copy(view.begin(), view.end(), out.begin() + sizeof(first_word));
 }
 
 Result<SoftwareAttribute> SoftwareAttribute::parse(const util::ConstBinaryView& vv, ParseStat&) {
@@ -279,6 +305,16 @@ Result<UnknownAttributesAttribute> UnknownAttributesAttribute::parse(const util:
 }
 
 util::ByteVec UnknownAttributesAttribute::build() const {
+    util::ByteVec result(value_size());
+    build_into(result);
+    return result;
+}
+
+size_t UnknownAttributesAttribute::value_size() const noexcept {
+    return types.size() * sizeof(uint16_t);
+}
+
+void UnknownAttributesAttribute::build_into(std::span<uint8_t> out) const noexcept {
     //  0                   1                   2                   3
     //  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
     // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -287,18 +323,26 @@ util::ByteVec UnknownAttributesAttribute::build() const {
     // |      Attribute 3 Type           |     Attribute 4 Type    ...
     // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     using AttrRawType = uint16_t;
-    std::vector<uint8_t> result(types.size() * sizeof(AttrRawType));
-    auto pos = result.begin();
+    auto pos = out.begin();
     for (auto t: types) {
         AttrRawType tv = util::host_to_network_u16(t.value());
         memcpy(&*pos, &tv, sizeof(AttrRawType));
         pos += sizeof(tv);
     }
-    return result;
 }
 
 
 util::ByteVec ErrorCodeAttribute::build() const {
+    util::ByteVec result(value_size());
+    build_into(result);
+    return result;
+}
+
+size_t ErrorCodeAttribute::value_size() const noexcept {
+    return sizeof(uint32_t) + reason_phrase.fmap([](const auto& r) { return r.size(); }).value_or(0);
+}
+
+void ErrorCodeAttribute::build_into(std::span<uint8_t> out) const noexcept {
     //  0                   1                   2                   3
     //  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
     // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -306,17 +350,12 @@ util::ByteVec ErrorCodeAttribute::build() const {
     // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     // |      Reason Phrase (variable)                                ..
     // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    uint32_t first_word = util::host_to_network_u32(((code / 100) << 8) | (code % 100));
-    return util::ConstBinaryView::concat({
-        util::ConstBinaryView(&first_word, sizeof(first_word)),
-        reason_phrase
-            .fmap([](const auto& reason_phrase) {
-                return util::ConstBinaryView(
-                    reason_phrase.data(),
-                    reason_phrase.size());
-            })
-            .value_or(util::ConstBinaryView(&first_word, 0)) // 0 is by intention!
-    });
+    const uint32_t first_word = util::host_to_network_u32(((code / 100) << 8) | (code % 100));
+    memcpy(out.data(), &first_word, sizeof(first_word));
+    if (reason_phrase.is_some()) {
+        const auto& r = reason_phrase.unwrap();
+        std::copy(r.begin(), r.end(), out.begin() + sizeof(first_word));
+    }
 }
 
 Result<ErrorCodeAttribute> ErrorCodeAttribute::parse(const util::ConstBinaryView& v, ParseStat& stat) {
@@ -362,6 +401,15 @@ util::ByteVec AlternateServerAttribute::build() const {
     return mapped.build();
 }
 
+size_t AlternateServerAttribute::value_size() const noexcept {
+    return sizeof(uint32_t) + addr.view().size();
+}
+
+void AlternateServerAttribute::build_into(std::span<uint8_t> out) const noexcept {
+    MappedAddressAttribute mapped{addr, port};
+    mapped.build_into(out);
+}
+
 
 }
 
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <variant>
 
 #include "util/util_binary_view.hpp"
@@ -41,6 +42,10 @@ struct MappedAddressAttribute {
     net::Port port;
     static Result<MappedAddressAttribute> parse(const util::ConstBinaryView&, ParseStat&);
     util::ByteVec build() const;
+    // Size of the encoded value and serialization into the buffer
+    // of exactly this size (no memory allocation).
+    size_t value_size() const noexcept;
+    void build_into(std::span<uint8_t>) const noexcept;
 };
 
 struct XorMappedAddressAttribute {
@@ -49,6 +54,10 @@ struct XorMappedAddressAttribute {
     bool operator==(const XorMappedAddressAttribute&) const noexcept = default;
     static Result<XorMappedAddressAttribute> parse(const util::ConstBinaryView&, ParseStat&);
     util::ByteVec build() const;
+    // Size of the encoded value and serialization into the buffer
+    // of exactly this size (no memory allocation).
+    size_t value_size() const noexcept;
+    void build_into(std::span<uint8_t>) const noexcept;
 };
 
 struct UsernameAttribute {
@@ -97,6 +106,10 @@ struct UnknownAttributesAttribute {
     std::vector<AttributeType> types;
     static Result<UnknownAttributesAttribute> parse(const util::ConstBinaryView&, ParseStat&);
     util::ByteVec build() const;
+    // Size of the encoded value and serialization into the buffer
+    // of exactly this size (no memory allocation).
+    size_t value_size() const noexcept;
+    void build_into(std::span<uint8_t>) const noexcept;
 };
 
 struct ErrorCodeAttribute {
@@ -115,6 +128,10 @@ struct ErrorCodeAttribute {
     bool operator==(const ErrorCodeAttribute&) const noexcept;
     static Result<ErrorCodeAttribute> parse(const util::ConstBinaryView&, ParseStat&);
     util::ByteVec build() const;
+    // Size of the encoded value and serialization into the buffer
+    // of exactly this size (no memory allocation).
+    size_t value_size() const noexcept;
+    void build_into(std::span<uint8_t>) const noexcept;
 };
 
 struct AlternateServerAttribute {
@@ -122,6 +139,10 @@ struct AlternateServerAttribute {
     net::Port port;
     static Result<AlternateServerAttribute> parse(const util::ConstBinaryView&, ParseStat&);
     util::ByteVec build() const;
+    // Size of the encoded value and serialization into the buffer
+    // of exactly this size (no memory allocation).
+    size_t value_size() const noexcept;
+    void build_into(std::span<uint8_t>) const noexcept;
 };
 
 class Attribute {
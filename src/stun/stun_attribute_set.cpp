@@ -8,11 +8,14 @@
 
 #include "stun/stun_attribute_set.hpp"
 #include "stun/stun_header.hpp"
+#include "stun/stun_error.hpp"
 #include "stun/details/stun_fingerprint.hpp"
+#include "stun/details/stun_constants.hpp"
+#include "stun/details/stun_message_integrity.hpp"
 #include "util/util_variant_overloaded.hpp"
-#include "util/util_unit.hpp"
 #include "util/util_endian.hpp"
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
 namespace freewebrtc::stun {
 
@@ -22,84 +25,84 @@ Maybe<std::reference_wrapper<const T>> some_ref(const T& v) {
 }
 
 AttributeSet::MaybeAttr<MessageIntegityAttribute::Digest> AttributeSet::integrity() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::MESSAGE_INTEGRITY)); it != m_map.end()) {
-        return some_ref(it->second.as<MessageIntegityAttribute>()->digest);
+    if (const auto *a = get<MessageIntegityAttribute>(); a != nullptr) {
+        return some_ref(a->digest);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<precis::OpaqueString> AttributeSet::username() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::USERNAME)); it != m_map.end()) {
-        return some_ref(it->second.as<UsernameAttribute>()->name);
+    if (const auto *a = get<UsernameAttribute>(); a != nullptr) {
+        return some_ref(a->name);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<std::string> AttributeSet::software() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::SOFTWARE)); it != m_map.end()) {
-        return some_ref(it->second.as<SoftwareAttribute>()->name);
+    if (const auto *a = get<SoftwareAttribute>(); a != nullptr) {
+        return some_ref(a->name);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<XorMappedAddressAttribute> AttributeSet::xor_mapped() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::XOR_MAPPED_ADDRESS)); it != m_map.end()) {
-        return some_ref(*it->second.as<XorMappedAddressAttribute>());
+    if (const auto *a = get<XorMappedAddressAttribute>(); a != nullptr) {
+        return some_ref(*a);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<MappedAddressAttribute> AttributeSet::mapped() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::MAPPED_ADDRESS)); it != m_map.end()) {
-        return some_ref(*it->second.as<MappedAddressAttribute>());
+    if (const auto *a = get<MappedAddressAttribute>(); a != nullptr) {
+        return some_ref(*a);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<uint32_t> AttributeSet::priority() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::PRIORITY)); it != m_map.end()) {
-        return some_ref(it->second.as<PriorityAttribute>()->priority);
+    if (const auto *a = get<PriorityAttribute>(); a != nullptr) {
+        return some_ref(a->priority);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<uint64_t> AttributeSet::ice_controlling() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::ICE_CONTROLLING)); it != m_map.end()) {
-        return some_ref(it->second.as<IceControllingAttribute>()->tiebreaker);
+    if (const auto *a = get<IceControllingAttribute>(); a != nullptr) {
+        return some_ref(a->tiebreaker);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<uint64_t> AttributeSet::ice_controlled() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::ICE_CONTROLLED)); it != m_map.end()) {
-        return some_ref(it->second.as<IceControlledAttribute>()->tiebreaker);
+    if (const auto *a = get<IceControlledAttribute>(); a != nullptr) {
+        return some_ref(a->tiebreaker);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<ErrorCodeAttribute> AttributeSet::error_code() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::ERROR_CODE)); it != m_map.end()) {
-        return some_ref(*it->second.as<ErrorCodeAttribute>());
+    if (const auto *a = get<ErrorCodeAttribute>(); a != nullptr) {
+        return some_ref(*a);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<UnknownAttributesAttribute> AttributeSet::unknown_attributes() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::UNKNOWN_ATTRIBUTES)); it != m_map.end()) {
-        return some_ref(*it->second.as<UnknownAttributesAttribute>());
+    if (const auto *a = get<UnknownAttributesAttribute>(); a != nullptr) {
+        return some_ref(*a);
     }
     return none();
 }
 
 AttributeSet::MaybeAttr<AlternateServerAttribute> AttributeSet::alternate_server() const noexcept {
-    if (auto it = m_map.find(AttributeType::from_uint16(attr_registry::ALTERNATE_SERVER)); it != m_map.end()) {
-        return some_ref(*it->second.as<AlternateServerAttribute>());
+    if (const auto *a = get<AlternateServerAttribute>(); a != nullptr) {
+        return some_ref(*a);
     }
     return none();
 }
 
 bool AttributeSet::has_use_candidate() const noexcept {
-    return m_map.find(AttributeType::from_uint16(attr_registry::USE_CANDIDATE)) != m_map.end();
+    return get<UseCandidateAttribute>() != nullptr;
 }
 
 std::vector<AttributeType> AttributeSet::unknown_comprehension_required() const noexcept {
@@ -113,7 +116,7 @@ std::vector<AttributeType> AttributeSet::unknown_comprehension_required() const
 }
 
 bool AttributeSet::has_fingerprint() const noexcept {
-    return m_map.find(AttributeType::from_uint16(attr_registry::FINGERPRINT)) != m_map.end();
+    return get<FingerprintAttribute>() != nullptr;
 }
 
 AttributeSet AttributeSet::create(std::vector<Attribute::Value>&& ka, std::vector<UnknownAttribute>&& ua) {
@@ -127,167 +130,235 @@ AttributeSet AttributeSet::create(std::vector<Attribute::Value>&& ka, std::vecto
     return newset;
 }
 
-Result<util::ByteVec> AttributeSet::build(const Header& header, const MaybeIntegrity& maybe_integrity) const {
-    std::vector<util::ConstBinaryView> result;
-    const size_t num_attrs = m_map.size() + m_unknown.size() + (maybe_integrity.is_some() ? 1 : 0);
-    result.reserve(num_attrs * 3 + 1); // We can have up to three views per attribute
-    int dummy_hdr;
-    result.emplace_back(&dummy_hdr, 0);
-
-    std::vector<uint32_t> attr_headers(num_attrs);
-    auto attr_headers_it = attr_headers.begin();
-    const uint32_t padding = 0;
-    uint32_t total_size = 0;
-
-    auto add_attr = [&](auto type, const auto& view) {
-        *attr_headers_it = util::host_to_network_u32((type << 16) | view.size());
-        result.emplace_back(util::ConstBinaryView(&*attr_headers_it, sizeof(uint32_t)));
-        total_size += sizeof(uint32_t);
-        attr_headers_it++;
-        if (view.size()) {
-            result.emplace_back(view);
-            total_size += view.size();
-            if ((view.size() & 0x3) != 0) {
-                const size_t padding_size = 4 - (view.size() % 4);
-                result.emplace_back(util::ConstBinaryView(&padding, padding_size));
-                total_size += padding_size;
-            }
+namespace {
+
+// Since STUN aligns attributes on 32-bit boundaries, attributes whose content
+// is not a multiple of 4 bytes are padded with 1, 2, or 3 bytes of
+// padding so that its value contains a multiple of 4 bytes.
+size_t padded_size(size_t size) {
+    return (size + 3) & ~size_t{3};
+}
+
+void write_attr_header(std::span<uint8_t> out, uint16_t type, size_t length) {
+    const uint32_t hdr = util::host_to_network_u32((uint32_t(type) << 16) | length);
+    memcpy(out.data(), &hdr, sizeof(hdr));
+}
+
+// Attribute which value is encoded by encode(std::span<uint8_t>)
+template<typename Writer, typename Encode>
+void write_attr(Writer& w, uint16_t type, size_t length, Encode&& encode) {
+    auto out = w.reserve(details::STUN_ATTR_HEADER_SIZE + padded_size(length));
+    write_attr_header(out, type, length);
+    auto value = out.subspan(details::STUN_ATTR_HEADER_SIZE);
+    encode(value.first(length));
+    std::fill(value.begin() + length, value.end(), 0);
+}
+
+// Attribute which value is referenced without copy
+template<typename Writer>
+void write_attr(Writer& w, uint16_t type, const util::ConstBinaryView& vv) {
+    write_attr_header(w.reserve(details::STUN_ATTR_HEADER_SIZE), type, vv.size());
+    w.borrow(vv);
+    auto padding = w.reserve(padded_size(vv.size()) - vv.size());
+    std::fill(padding.begin(), padding.end(), 0);
+}
+
+template<typename T>
+void write_be(std::span<uint8_t> out, T v) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = uint8_t(v >> (8 * (sizeof(T) - 1 - i)));
+    }
+}
+
+// Writer of the message to continuous buffer
+class SpanWriter {
+public:
+    explicit SpanWriter(std::span<uint8_t> out)
+        : m_out(out)
+    {}
+    std::span<uint8_t> reserve(size_t sz) {
+        auto result = m_out.subspan(m_pos, sz);
+        m_pos += sz;
+        return result;
+    }
+    void borrow(const util::ConstBinaryView& vv) {
+        std::copy(vv.begin(), vv.end(), reserve(vv.size()).begin());
+    }
+    Result<MessageIntegityAttribute::Digest> integrity_digest(const IntegrityData& idata) const {
+        return details::integrity_digest(written(), m_pos, idata);
+    }
+    uint32_t crc32() const {
+        return stun::crc32(written());
+    }
+private:
+    util::ConstBinaryView written() const {
+        return util::ConstBinaryView(m_out.data(), m_pos);
+    }
+    std::span<uint8_t> m_out;
+    size_t m_pos = 0;
+};
+
+// Writer of the message to scatter/gather list
+class GatherWriter {
+public:
+    explicit GatherWriter(MessageGather& g)
+        : m_gather(g)
+    {}
+    std::span<uint8_t> reserve(size_t sz) {
+        return m_gather.reserve(sz);
+    }
+    void borrow(const util::ConstBinaryView& vv) {
+        m_gather.borrow(vv);
+    }
+    Result<MessageIntegityAttribute::Digest> integrity_digest(const IntegrityData& idata) const {
+        return details::integrity_digest(m_gather.views(), idata);
+    }
+    uint32_t crc32() const {
+        return stun::crc32(m_gather.views());
+    }
+private:
+    MessageGather& m_gather;
+};
+
+}
+
+size_t AttributeSet::build_size(const MaybeIntegrity& maybe_integrity) const noexcept {
+    size_t size = details::STUN_HEADER_SIZE;
+    for (const auto& slot: m_slots) {
+        if (slot.is_none()) {
+            continue;
+        }
+        const auto& value = slot.unwrap().value();
+        if (std::holds_alternative<MessageIntegityAttribute>(value) || std::holds_alternative<FingerprintAttribute>(value)) {
+            // Added later
+            continue;
+        }
+        const size_t value_size =
+            std::visit(
+                util::overloaded {
+                    [](const UsernameAttribute& a) -> size_t { return a.name.value.size(); },
+                    [](const SoftwareAttribute& a) -> size_t { return a.name.size(); },
+                    [](const PriorityAttribute&) -> size_t { return sizeof(uint32_t); },
+                    [](const IceControllingAttribute&) -> size_t { return sizeof(uint64_t); },
+                    [](const IceControlledAttribute&) -> size_t { return sizeof(uint64_t); },
+                    [](const UseCandidateAttribute&) -> size_t { return 0; },
+                    [](const MessageIntegityAttribute&) -> size_t { return 0; },
+                    [](const FingerprintAttribute&) -> size_t { return 0; },
+                    [](const auto& a) -> size_t { return a.value_size(); }
+                },
+                value);
+        size += details::STUN_ATTR_HEADER_SIZE + padded_size(value_size);
+    }
+    for (const auto& unknown: m_unknown) {
+        size += details::STUN_ATTR_HEADER_SIZE + padded_size(unknown.data.size());
+    }
+    if (maybe_integrity.is_some()) {
+        size += details::STUN_ATTR_HEADER_SIZE + crypto::SHA1Hash::size;
+    }
+    if (has_fingerprint()) {
+        size += details::STUN_ATTR_HEADER_SIZE + details::FINGERPRINT_CRC_SIZE;
+    }
+    return size;
+}
+
+template<typename Writer>
+MaybeError AttributeSet::write(const Header& header, const MaybeIntegrity& maybe_integrity, size_t size, Writer& w) const {
+    header.build_into(w.reserve(details::STUN_HEADER_SIZE), size - details::STUN_HEADER_SIZE);
+
+    for (const auto& slot: m_slots) {
+        if (slot.is_none()) {
+            continue;
         }
-    };
-
-    Maybe<util::ByteVec> xor_mapped_data = none();
-    Maybe<util::ByteVec> mapped_data = none();
-    uint32_t prio = 0;
-    uint64_t ice_controlling = 0;
-    uint64_t ice_controlled = 0;
-    Maybe<util::ByteVec> error_code_data = none();
-    Maybe<util::ByteVec> unknown_attributes_data = none();
-    Maybe<util::ByteVec> altenate_server_data = none();
-
-    using ByteVecRef = std::reference_wrapper<Maybe<util::ByteVec>>;
-
-    for (const auto& p: m_map) {
-        const auto type = p.first.value();
-        using VisitorResult = Maybe<ByteVecRef>;
+        const auto& attr = slot.unwrap();
+        const auto type = attr.type().value();
         std::visit(
             util::overloaded {
                 [&](const UsernameAttribute& a) {
                     const auto& username = a.name.value;
-                    add_attr(type, util::ConstBinaryView(username.data(), username.size()));
-                    return VisitorResult::none();
+                    write_attr(w, type, util::ConstBinaryView(username.data(), username.size()));
                 },
                 [&](const SoftwareAttribute& a) {
-                    add_attr(type, util::ConstBinaryView(a.name.data(), a.name.size()));
-                    return VisitorResult::none();
+                    write_attr(w, type, util::ConstBinaryView(a.name.data(), a.name.size()));
                 },
-                [&](const XorMappedAddressAttribute& a) {
-                    xor_mapped_data = a.build();
-                    return VisitorResult::move_from(std::ref(xor_mapped_data));
-                },
-                [&](const MappedAddressAttribute& a) {
-                    mapped_data = a.build();
-                    return VisitorResult::move_from(std::ref(mapped_data));
-                },
-                [&](const PriorityAttribute& a) -> VisitorResult {
-                    prio = util::host_to_network_u32(a.priority);
-                    add_attr(type, util::ConstBinaryView(&prio, sizeof(prio)));
-                    return VisitorResult::none();
+                [&](const PriorityAttribute& a) {
+                    write_attr(w, type, sizeof(uint32_t), [&](auto out) { write_be(out, a.priority); });
                 },
                 [&](const IceControllingAttribute& a) {
-                    ice_controlling = util::host_to_network_u64(a.tiebreaker);
-                    add_attr(type, util::ConstBinaryView(&ice_controlling, sizeof(ice_controlling)));
-                    return VisitorResult::none();
+                    write_attr(w, type, sizeof(uint64_t), [&](auto out) { write_be(out, a.tiebreaker); });
                 },
                 [&](const IceControlledAttribute& a) {
-                    ice_controlled = util::host_to_network_u64(a.tiebreaker);
-                    add_attr(type, util::ConstBinaryView(&ice_controlled, sizeof(ice_controlled)));
-                    return VisitorResult::none();
+                    write_attr(w, type, sizeof(uint64_t), [&](auto out) { write_be(out, a.tiebreaker); });
                 },
                 [&](const UseCandidateAttribute&) {
-                    add_attr(type, util::ConstBinaryView(&padding, 0));
-                    return VisitorResult::none();
-                },
-                [&](const ErrorCodeAttribute& ec) {
-                    error_code_data = ec.build();
-                    return VisitorResult::move_from(std::ref(error_code_data));
-                },
-                [&](const UnknownAttributesAttribute& a) {
-                    unknown_attributes_data = a.build();
-                    return VisitorResult::move_from(std::ref(unknown_attributes_data));
-                },
-                [&](const AlternateServerAttribute& a) {
-                    altenate_server_data = a.build();
-                    return VisitorResult::move_from(std::ref(altenate_server_data));
+                    write_attr(w, type, 0, [](auto) {});
                 },
                 [&](const MessageIntegityAttribute&) {
                     // Do not add integrity here
-                    return VisitorResult::none();
                 },
                 [&](const FingerprintAttribute&) {
                     // Do not add fingerprint here
-                    return VisitorResult::none();
+                },
+                [&](const auto& a) {
+                    // Address attributes, ERROR-CODE, UNKNOWN-ATTRIBUTES
+                    write_attr(w, type, a.value_size(), [&](auto out) { a.build_into(out); });
                 }
             },
-            p.second.value())
-            .fmap([&](const ByteVecRef& bvref) {
-                return bvref.get()
-                    .fmap([&](const util::ByteVec& vec) {
-                        add_attr(type, util::ConstBinaryView(vec));
-                        return Unit::create();
-                    })
-                    .value_or(Unit::create());
-            });
+            attr.value());
     }
 
     for (const auto& unknown: m_unknown) {
-        add_attr(unknown.type.value(), util::ConstBinaryView(unknown.data));
-    }
-
-
-    Maybe<Result<MessageIntegityAttribute::Digest>> maybe_integrity_digest_rv = none();
-    auto add_integrity = [&](auto&& integrity) -> MaybeError {
-        const auto& h = integrity.hash;
-        const auto& p = integrity.password;
-        auto fake_header = header.build(total_size + details::STUN_ATTR_HEADER_SIZE + crypto::SHA1Hash::size);
-        result[0] = util::ConstBinaryView(fake_header);
-        maybe_integrity_digest_rv = crypto::hmac::digest(result, p.opad(), p.ipad(), h);
-        return maybe_integrity_digest_rv
-            .fmap([&](auto&& integrity_digest_rv) -> MaybeError {
-                return integrity_digest_rv.
-                    fmap([&](auto&& integrity_digest) {
-                        add_attr(attr_registry::MESSAGE_INTEGRITY, util::ConstBinaryView(integrity_digest.value.value()));
-                        return Unit::create();
-                    });
-            })
-            .value_or(success());
-    };
-
-    util::ByteVec real_header;
-    uint32_t fingerprint_data = 0;
-    auto add_fingerprint = [&]() {
-        static_assert(sizeof(fingerprint_data) == details::FINGERPRINT_CRC_SIZE);
-        real_header = header.build(total_size + details::FINGERPRINT_CRC_SIZE + details::STUN_ATTR_HEADER_SIZE);
-        result[0] = util::ConstBinaryView(real_header);
-        const auto fp = crc32(result) ^ FINGERPRINT_XOR;
-        fingerprint_data = util::host_to_network_u32(fp);
-        add_attr(attr_registry::FINGERPRINT, util::ConstBinaryView(&fingerprint_data, sizeof(fingerprint_data)));
-    };
-    auto no_fingerprint = [&]() {
-        real_header = header.build(total_size);
-        result[0] = util::ConstBinaryView(real_header);
-    };
-
-    return maybe_integrity
-        .fmap(add_integrity)
-        .value_or(success())
-        .bind([&](auto&&) -> Result<util::ByteVec> {
-            if (m_map.find(AttributeType::from_uint16(attr_registry::FINGERPRINT)) != m_map.end()) {
-                add_fingerprint();
-            } else {
-                no_fingerprint();
-            }
-            return util::ConstBinaryView::concat(result);
+        write_attr(w, unknown.type.value(), util::ConstBinaryView(unknown.data));
+    }
+
+    if (maybe_integrity.is_some()) {
+        auto digest_rv = w.integrity_digest(maybe_integrity.unwrap());
+        if (digest_rv.is_err()) {
+            return digest_rv.unwrap_err();
+        }
+        const auto& digest = digest_rv.unwrap().value.value();
+        write_attr(w, attr_registry::MESSAGE_INTEGRITY, digest.size(), [&](auto out) {
+            std::copy(digest.begin(), digest.end(), out.begin());
         });
+    }
+
+    if (has_fingerprint()) {
+        const uint32_t fp = w.crc32() ^ FINGERPRINT_XOR;
+        write_attr(w, attr_registry::FINGERPRINT, details::FINGERPRINT_CRC_SIZE, [&](auto out) { write_be(out, fp); });
+    }
+    return success();
+}
+
+Result<util::ByteVec> AttributeSet::build(const Header& header, const MaybeIntegrity& maybe_integrity) const {
+    const size_t size = build_size(maybe_integrity);
+    util::ByteVec result(size);
+    SpanWriter w(result);
+    return write(header, maybe_integrity, size, w)
+        .fmap([&](auto&&) {
+            return std::move(result);
+        });
+}
+
+Result<size_t> AttributeSet::build_into(const Header& header, const MaybeIntegrity& maybe_integrity, std::span<uint8_t> out) const {
+    const size_t size = build_size(maybe_integrity);
+    if (out.size() < size) {
+        return make_error_code(BuildError::buffer_too_small);
+    }
+    SpanWriter w(out.first(size));
+    return write(header, maybe_integrity, size, w)
+        .fmap([&](auto&&) {
+            return size;
+        });
+}
+
+MaybeError AttributeSet::build_gather(const Header& header, const MaybeIntegrity& maybe_integrity, MessageGather& g) const {
+    const size_t size = build_size(maybe_integrity);
+    // Each attribute takes at most two views: encoded part
+    // (with header and padding of previous attribute) and
+    // referenced value.
+    const size_t max_views = 2 * (m_slots.size() + m_unknown.size()) + 1;
+    g.reset(size, max_views);
+    GatherWriter w(g);
+    return write(header, maybe_integrity, size, w);
 }
 
 }
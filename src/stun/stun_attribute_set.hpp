@@ -8,11 +8,16 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <array>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 #include "util/util_maybe.hpp"
 #include "stun/stun_attribute.hpp"
 #include "stun/stun_integrity.hpp"
+#include "stun/stun_message_gather.hpp"
 #include "stun/details/stun_attr_registry.hpp"
 
 namespace freewebrtc::stun {
@@ -21,6 +26,7 @@ struct Header;
 
 class AttributeSet {
 public:
+    AttributeSet();
     void emplace(Attribute&&);
     void emplace(UnknownAttribute&&);
     template<typename Attr>
@@ -45,20 +51,66 @@ public:
     using UnknownAttrVec = std::vector<UnknownAttribute>;
     static AttributeSet create(AttrVec&&, UnknownAttrVec&& = {});
 
+    // Size of the message built with these attributes
+    size_t build_size(const MaybeIntegrity&) const noexcept;
     Result<util::ByteVec> build(const Header&, const MaybeIntegrity&) const;
+    // Build message into buffer without memory allocation.
+    // Returns size of the message.
+    Result<size_t> build_into(const Header&, const MaybeIntegrity&, std::span<uint8_t>) const;
+    // Build message in scatter/gather form.
+    MaybeError build_gather(const Header&, const MaybeIntegrity&, MessageGather&) const;
 private:
-    std::unordered_map<AttributeType, Attribute> m_map;
+    template<typename Writer>
+    MaybeError write(const Header&, const MaybeIntegrity&, size_t size, Writer&) const;
+    // Known attributes are stored inline in the slot table that
+    // is indexed by alternative index of Attribute::Value.
+    static constexpr size_t NUM_SLOTS = std::variant_size_v<Attribute::Value>;
+    using Slots = std::array<Maybe<Attribute>, NUM_SLOTS>;
+    template<size_t... Is>
+    static Slots empty_slots(std::index_sequence<Is...>) noexcept;
+    template<typename Attr>
+    static constexpr size_t slot_of() noexcept;
+    template<typename Attr>
+    const Attr *get() const noexcept;
+
+    Slots m_slots;
     std::vector<UnknownAttribute> m_unknown;
 };
 
 //
 // inlines
 //
+inline AttributeSet::AttributeSet()
+    : m_slots(empty_slots(std::make_index_sequence<NUM_SLOTS>{}))
+{}
+
+template<size_t... Is>
+inline AttributeSet::Slots AttributeSet::empty_slots(std::index_sequence<Is...>) noexcept {
+    return Slots{((void)Is, Maybe<Attribute>{None{}})...};
+}
+
+template<typename Attr>
+constexpr size_t AttributeSet::slot_of() noexcept {
+    return []<typename... Ts>(std::variant<Ts...>*) {
+        size_t i = 0;
+        ((std::is_same_v<Attr, Ts> ? false : (++i, true)) && ...);
+        return i;
+    }(static_cast<Attribute::Value *>(nullptr));
+}
+
+template<typename Attr>
+inline const Attr *AttributeSet::get() const noexcept {
+    const auto& slot = m_slots[slot_of<Attr>()];
+    return slot.is_some() ? slot.unwrap().template as<Attr>() : nullptr;
+}
+
 inline void AttributeSet::emplace(Attribute&& attr)  {
-    if (m_map.find(attr.type()) != m_map.end()) {
+    // First occurrence of the attribute wins.
+    auto& slot = m_slots[attr.value().index()];
+    if (slot.is_some()) {
         return;
     }
-    m_map.emplace(attr.type(), std::move(attr));
+    slot = Maybe<Attribute>::move_from(std::move(attr));
 }
 
 inline void AttributeSet::emplace(UnknownAttribute&& attr) {
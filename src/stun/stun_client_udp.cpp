@@ -11,30 +11,11 @@
 #include "stun/stun_error.hpp"
 #include "stun/stun_transaction_id_hash.hpp"
 #include "stun/details/stun_client_udp_rto.hpp"
+#include "stun/details/stun_client_udp_pacer.hpp"
+#include "stun/details/stun_constants.hpp"
 
 namespace freewebrtc::stun {
 
-class ClientUDP::RetransmitAlgo {
-public:
-    explicit RetransmitAlgo(Duration initial_rto, const Settings::RetransmitDefault& settings, Timepoint now);
-    MaybeTimepoint init(Timepoint now);
-    MaybeTimepoint next(Timepoint now);
-    enum class Process5xxResult {
-        TransactionFailed,
-        RetransmitScheduled
-    };
-    Process5xxResult process_5xx(Timepoint, int code);
-    Duration last_timeout() const;
-private:
-    std::pair<MaybeTimepoint, Duration> calc_next(Timepoint now) const noexcept;
-    const Duration m_initial_rto;
-    const Settings::RetransmitDefault m_settings;
-    MaybeTimepoint m_maybe_next;
-    Duration m_last_timeout;
-    unsigned m_rtx_count = 0;
-    unsigned m_5xx_count = 0;
-};
-
 ClientUDP::ClientUDP(const Settings& settings)
     : m_settings(settings)
     , m_tid_to_handle(0,
@@ -42,23 +23,45 @@ ClientUDP::ClientUDP(const Settings& settings)
           .maybe_tid_hash
           .value_or(MurmurTransactionIdHash<>::create()))
     , m_rto_calc(std::make_unique<RtoCalculator>(m_settings.rto_settings))
+    , m_pacer(
+        std::visit(
+            util::overloaded {
+                [](const Settings::RetransmitDefault&) -> PacerPtr {
+                    return nullptr;
+                },
+                [](const Settings::RetransmitPaced& paced) -> PacerPtr {
+                    return std::make_unique<Pacer>(paced.pacing_interval, paced.burst_size);
+                }
+            },
+            m_settings.retransmit))
 {}
 
 ClientUDP::~ClientUDP()
 {}
 
 MaybeError ClientUDP::response(Timepoint now, util::ConstBinaryView view, Maybe<stun::Message>&& maybe_msg) {
-    auto msg_rv = maybe_msg.require()
-        .bind_err([&](auto&&) {
-            return stun::Message::parse(view, m_stat.parse);
-        });
-
     // Find transaction handle first not to spend time on
     // message validation if we don't know anything about
-    // transaction
-    auto trans_ref_rv = msg_rv
-        .bind([&](const Message& msg) {
+    // transaction. If message is not parsed yet then only
+    // STUN header is checked before lookup so stray and
+    // late responses are dropped without parsing attributes.
+    auto trans_ref_rv = maybe_msg
+        .fmap([&](const Message& msg) {
             return find_transaction(msg.header.transaction_id);
+        })
+        .value_or_call([&] {
+            return Message::peek(view, m_stat.parse)
+                .bind([&](const Message::Peek& peek) {
+                    return find_transaction(TransactionId(peek.transaction_id));
+                });
+        });
+
+    auto msg_rv = trans_ref_rv
+        .bind([&](auto&&) {
+            return std::move(maybe_msg).require()
+                .bind_err([&](auto&&) {
+                    return stun::Message::parse(view, m_stat.parse);
+                });
         });
 
     auto auth_err =
@@ -78,23 +81,11 @@ MaybeError ClientUDP::response(Timepoint now, util::ConstBinaryView view, Maybe<
 }
 
 ClientUDP::Effect ClientUDP::next(Timepoint now) {
+    release_finished();
     // Progress with pending transactions
-    while (!m_tid_timeline.empty() && !m_tid_timeline.top().first.is_after(now)) {
-        Handle hnd = m_tid_timeline.top().second;
-        m_tid_timeline.pop();
-        if (auto it = m_tmap.find(hnd); it != m_tmap.end()) {
-            auto& t = it->second;
-            auto se = t.rtx_algo->next(now)
-                .fmap([&](auto&& next) -> Effect {
-                    m_stat.retransmits.inc();
-                    t.rtx_count++;
-                    m_tid_timeline.emplace(std::make_pair(next, hnd));
-                    return SendData{hnd, util::ConstBinaryView(t.msg_data)};
-                })
-                .value_or(TransactionFailed{hnd, TransactionFailed::Timeout{}});
-            m_effects.emplace(std::move(se));
-        } // When not found transaction were cleaned before.
-    }
+    process_timers(now, [&](Effect&& effect) {
+        m_effects.emplace(std::move(effect));
+    });
     if (!m_effects.empty()) {
         auto next = std::move(m_effects.front());
         m_effects.pop();
@@ -106,10 +97,112 @@ ClientUDP::Effect ClientUDP::next(Timepoint now) {
         }
         return next;
     }
-    if (m_tid_timeline.empty()) {
-        return Idle{};
+    return next_wakeup()
+        .fmap([&](const Timepoint& next) -> Effect {
+            return Sleep{next - now};
+        })
+        .value_or(Idle{});
+}
+
+ClientUDP::MaybeTimepoint ClientUDP::drain(Timepoint now, EffectSink& sink) {
+    release_finished();
+    auto dispatch = [&](Effect&& effect) {
+        std::visit(
+            util::overloaded {
+                [&](SendData&& send) {
+                    sink.send_data(send);
+                },
+                [&](TransactionOk&& ok) {
+                    forget(ok.handle);
+                    m_finished.push_back(ok.handle);
+                    sink.transaction_ok(std::move(ok));
+                },
+                [&](TransactionFailed&& failed) {
+                    forget(failed.handle);
+                    m_finished.push_back(failed.handle);
+                    sink.transaction_failed(std::move(failed));
+                },
+                [](Sleep&&) {},
+                [](Idle&&) {}
+            },
+            std::move(effect));
+    };
+    // Effects that are queued before (by create / response) go first.
+    while (!m_effects.empty()) {
+        dispatch(std::move(m_effects.front()));
+        m_effects.pop();
+    }
+    process_timers(now, dispatch);
+    return next_wakeup();
+}
+
+util::ByteVec ClientUDP::rto_snapshot(Timepoint now) const {
+    return m_rto_calc->snapshot(now);
+}
+
+MaybeError ClientUDP::restore_rto(Timepoint now, const util::ConstBinaryView& vv, clock::NativeDuration elapsed) {
+    return m_rto_calc->restore(now, vv, elapsed);
+}
+
+template<typename F>
+void ClientUDP::release_paced(Timepoint now, F&& on_effect) {
+    for (auto maybe_hnd = m_pacer->ready(now); maybe_hnd.is_some(); maybe_hnd = m_pacer->ready(now)) {
+        const Handle hnd = maybe_hnd.unwrap();
+        auto maybe_trans = m_transactions.find(hnd);
+        if (maybe_trans.is_none() || maybe_trans.unwrap().get().finished) {
+            // Token is not spent for the finished transactions
+            m_pacer->drop();
+            continue;
+        }
+        m_pacer->release(now);
+        Transaction& t = maybe_trans.unwrap();
+        if (t.rtx_count == 0) {
+            t.send_time = now;
+        }
+        t.maybe_timer = m_timers.schedule(t.rtx_algo.sent(now), hnd);
+        on_effect(SendData{hnd, util::ConstBinaryView(t.msg_data)});
+    }
+}
+
+template<typename F>
+void ClientUDP::process_timers(Timepoint now, F&& on_effect) {
+    for (auto maybe_hnd = m_timers.pop_expired(now); maybe_hnd.is_some(); maybe_hnd = m_timers.pop_expired(now)) {
+        const Handle hnd = maybe_hnd.unwrap();
+        m_transactions.find(hnd).with_inner([&](Transaction& t) {
+            t.maybe_timer = none();
+            auto maybe_se = t.rtx_algo.next(now)
+                .fmap([&](auto&& next) -> Maybe<Effect> {
+                    m_stat.retransmits.inc();
+                    t.rtx_count++;
+                    if (m_pacer) {
+                        // Retransmit timer is started when
+                        // request is sent.
+                        m_pacer->push(hnd);
+                        return none();
+                    }
+                    t.maybe_timer = m_timers.schedule(next, hnd);
+                    return Effect{SendData{hnd, util::ConstBinaryView(t.msg_data)}};
+                })
+                .value_or(Effect{TransactionFailed{hnd, TransactionFailed::Timeout{}}});
+            maybe_se.with_inner([&](Effect& se) {
+                on_effect(std::move(se));
+            });
+        });
+    }
+    if (m_pacer) {
+        release_paced(now, on_effect);
+    }
+}
+
+ClientUDP::MaybeTimepoint ClientUDP::next_wakeup() const noexcept {
+    auto maybe_timer = m_timers.next_expiration();
+    auto maybe_release = m_pacer ? m_pacer->next_release() : MaybeTimepoint{none()};
+    if (maybe_timer.is_none() || maybe_release.is_none()) {
+        return maybe_timer.is_some() ? maybe_timer : maybe_release;
     }
-    return Sleep{m_tid_timeline.top().first - now};
+    const auto& timer = maybe_timer.unwrap();
+    const auto& release = maybe_release.unwrap();
+    return timer.is_before(release) ? timer : release;
 }
 
 Result<ClientUDP::TransactionRef> ClientUDP::find_transaction(const TransactionId& tid) noexcept {
@@ -118,22 +211,21 @@ Result<ClientUDP::TransactionRef> ClientUDP::find_transaction(const TransactionI
         m_stat.transaction_not_found.inc();
         return make_error_code(ClientError::transaction_not_found);
     }
-    auto hnd = i->second;
-    auto j = m_tmap.find(hnd);
-    if (j == m_tmap.end()) {
+    auto maybe_trans = m_transactions.find(i->second);
+    if (maybe_trans.is_none()) {
         m_stat.transaction_not_found.inc();
         return make_error_code(ClientError::transaction_not_found);
     }
-    return std::ref(j->second);
+    return maybe_trans.unwrap();
 }
 
 MaybeError ClientUDP::check_response_auth(const Transaction& trans, const Message& msg, util::ConstBinaryView view) noexcept {
-    return trans.maybe_auth
-        .fmap([&](auto&& auth) {
+    return find_auth(trans.maybe_credentials)
+        .fmap([&](const AuthRef& auth) {
             // We don't check username because per:
             // RFC5389: 10.1.2.  Receiving a Request or Indication:
             // The response MUST NOT contain the USERNAME attribute.
-            return msg.is_valid(view, auth.integrity)
+            return msg.is_valid(view, auth.get().integrity)
                 .bind([&](auto&& maybe_is_valid) -> MaybeError {
                     return maybe_is_valid
                         .fmap([&](auto is_valid) -> MaybeError {
@@ -157,7 +249,7 @@ MaybeError ClientUDP::check_response_auth(const Transaction& trans, const Messag
         .value_or(success());
 }
 
-Result<ClientUDP::Handle> ClientUDP::do_create(Timepoint now, TransactionId&& tid, Request&& rq) {
+Message ClientUDP::make_request(TransactionId&& tid, Request& rq, const Maybe<AuthRef>& maybe_auth) const {
     stun::Message request {
         stun::Header {
             stun::Class::request(),
@@ -169,41 +261,147 @@ Result<ClientUDP::Handle> ClientUDP::do_create(Timepoint now, TransactionId&& ti
         none()
     };
 
-    MaybeIntegrity maybe_integrity = rq.maybe_auth
-        .fmap([&](auto&& auth) {
-            request.attribute_set.emplace(Attribute::create(UsernameAttribute{auth.username}));
-            return auth.integrity;
+    maybe_auth
+        .with_inner([&](const AuthRef& auth) {
+            request.attribute_set.emplace(Attribute::create(UsernameAttribute{auth.get().username}));
         });
 
     if (m_settings.use_fingerprint) {
         request.attribute_set.emplace(Attribute::create(FingerprintAttribute{0}));
     }
+    return request;
+}
 
-    return request
-        .build(maybe_integrity)
-        .fmap([&](util::ByteVec&& data) {
-            Handle handle = allocate_handle();
-            m_tid_to_handle.emplace(request.header.transaction_id, handle);
-
-            auto rtx_algo = allocate_rtx_algo(rq.path, now);
-            Transaction transaction(now,
-                                    std::move(request.header.transaction_id),
-                                    handle,
-                                    std::move(data),
-                                    std::move(rtx_algo),
-                                    std::move(rq.path),
-                                    std::move(rq.maybe_auth));
-            auto [it, _] = m_tmap.emplace(handle, std::move(transaction));
-            auto& t = it->second;
-            m_effects.emplace(SendData{handle, util::ConstBinaryView(t.msg_data)});
-            t.rtx_algo->init(now)
-                .with_inner([&](Timepoint&& timepoint) {
-                    m_tid_timeline.emplace(timepoint, handle);
+Result<ClientUDP::Handle> ClientUDP::do_create(Timepoint now, TransactionId&& tid, Request&& rq) {
+    return acquire_credentials(rq.maybe_credentials, std::move(rq.maybe_auth))
+        .bind([&](MaybeCredentialHandle&& maybe_credentials) {
+            const auto maybe_auth = find_auth(maybe_credentials);
+            auto request = make_request(std::move(tid), rq, maybe_auth);
+            const MaybeIntegrity maybe_integrity = maybe_auth
+                .fmap([](const AuthRef& auth) { return auth.get().integrity; });
+            return request
+                .build(maybe_integrity)
+                .fmap([&](util::ByteVec&& data) {
+                    return store(now, std::move(request.header.transaction_id), std::move(data),
+                                 std::move(rq.path), maybe_credentials);
+                })
+                .bind_err([&](auto&& err) -> Result<Handle> {
+                    unref_credentials(maybe_credentials);
+                    return std::move(err);
                 });
-            m_stat.started.inc();
-            return handle;
         });
+}
 
+Result<ClientUDP::Handle> ClientUDP::do_create(Timepoint now, TransactionId&& tid, const RequestTemplate& tmpl,
+                                               net::Path&& path, std::span<const RequestTemplate::Patch> patches,
+                                               const MaybeCredentialHandle& maybe_credentials) {
+    return tmpl
+        .build(tid, patches)
+        .bind([&](util::ByteVec&& data) -> Result<Handle> {
+            MaybeAuth maybe_auth = tmpl.integrity()
+                .fmap([](const IntegrityData& integrity) {
+                    // Username is used only to build request
+                    return Auth{precis::OpaqueString{""}, integrity};
+                });
+            return acquire_credentials(maybe_credentials, std::move(maybe_auth))
+                .fmap([&](MaybeCredentialHandle&& request_credentials) {
+                    return store(now, std::move(tid), std::move(data), std::move(path), request_credentials);
+                });
+        });
+}
+
+Result<RequestTemplate> ClientUDP::create_template(Request&& rq, const std::vector<AttributeType>& patchable) const {
+    const auto maybe_auth = rq.maybe_credentials
+        .fmap([&](const CredentialHandle&) { return find_auth(rq.maybe_credentials); })
+        .value_or_call([&] {
+            return rq.maybe_auth.fmap([](const Auth& auth) { return AuthRef(auth); });
+        });
+    if (rq.maybe_credentials.is_some() && maybe_auth.is_none()) {
+        return make_error_code(ClientError::credentials_not_found);
+    }
+    // Transaction id is replaced for each transaction
+    const std::array<uint8_t, details::TRANSACTION_ID_SIZE> zero_tid = {};
+    const auto request = make_request(TransactionId(util::ConstBinaryView(zero_tid)), rq, maybe_auth);
+    const MaybeIntegrity maybe_integrity = maybe_auth
+        .fmap([](const AuthRef& auth) { return auth.get().integrity; });
+    return RequestTemplate::create(request, maybe_integrity, patchable);
+}
+
+ClientUDP::CredentialHandle ClientUDP::add_credentials(Auth&& auth) {
+    return m_credentials.emplace(Credentials{std::move(auth)});
+}
+
+void ClientUDP::remove_credentials(const CredentialHandle& hnd) {
+    m_credentials.find(hnd)
+        .with_inner([&](Credentials& c) {
+            c.removed = true;
+            if (c.refs == 0) {
+                m_credentials.erase(hnd);
+            }
+        });
+}
+
+Result<ClientUDP::MaybeCredentialHandle>
+ClientUDP::acquire_credentials(const MaybeCredentialHandle& maybe_hnd, MaybeAuth&& maybe_auth) {
+    if (maybe_hnd.is_some()) {
+        const auto& hnd = maybe_hnd.value();
+        auto maybe_credentials = m_credentials.find(hnd);
+        if (maybe_credentials.is_none() || maybe_credentials.value().get().removed) {
+            return make_error_code(ClientError::credentials_not_found);
+        }
+        ++maybe_credentials.value().get().refs;
+        return maybe_hnd;
+    }
+    return std::move(maybe_auth)
+        .fmap([&](Auth&& auth) {
+            // Credentials of the transaction only
+            return m_credentials.emplace(Credentials{std::move(auth), 1, true});
+        });
+}
+
+Maybe<ClientUDP::AuthRef> ClientUDP::find_auth(const MaybeCredentialHandle& maybe_hnd) const noexcept {
+    return maybe_hnd
+        .bind([&](const CredentialHandle& hnd) {
+            return m_credentials.find(hnd)
+                .fmap([](const auto& c) { return AuthRef(c.get().auth); });
+        });
+}
+
+void ClientUDP::unref_credentials(const MaybeCredentialHandle& maybe_hnd) {
+    maybe_hnd
+        .with_inner([&](const CredentialHandle& hnd) {
+            m_credentials.find(hnd)
+                .with_inner([&](Credentials& c) {
+                    if (--c.refs == 0 && c.removed) {
+                        m_credentials.erase(hnd);
+                    }
+                });
+        });
+}
+
+ClientUDP::Handle ClientUDP::store(Timepoint now, TransactionId&& tid, util::ByteVec&& data,
+                                   net::Path&& path, const MaybeCredentialHandle& maybe_credentials) {
+    const Handle handle = m_transactions.emplace(now,
+                                                 TransactionId(tid),
+                                                 std::move(data),
+                                                 create_rtx_algo(tid, path, now),
+                                                 std::move(path),
+                                                 maybe_credentials);
+    m_tid_to_handle.emplace(std::move(tid), handle);
+    Transaction& t = m_transactions.find(handle).unwrap();
+    t.hnd = handle;
+    if (m_pacer) {
+        // Send and retransmit timer are started by pacer
+        m_pacer->push(handle);
+    } else {
+        m_effects.emplace(SendData{handle, util::ConstBinaryView(t.msg_data)});
+        t.rtx_algo.init(now)
+            .with_inner([&](Timepoint&& timepoint) {
+                t.maybe_timer = m_timers.schedule(timepoint, handle);
+            });
+    }
+    m_stat.started.inc();
+    return handle;
 }
 
 MaybeError ClientUDP::handle_success_response(Timepoint now, Transaction& t, Message&& msg) {
@@ -227,11 +425,11 @@ MaybeError ClientUDP::handle_success_response(Timepoint now, Transaction& t, Mes
         // TLDR; Two ideas:
         //   1. Don't use RTT calculated based on retransmit
         //   2. Maintain back-off RTO when send next packet
-        auto rtt = now - t.create_time;
+        auto rtt = now - t.send_time;
         maybe_rtt = rtt;
         m_rto_calc->new_rtt(now, t.path, rtt);
     } else {
-        m_rto_calc->backoff(now, t.path, t.rtx_algo->last_timeout());
+        m_rto_calc->backoff(now, t.path, t.rtx_algo.last_timeout());
     }
 
     auto effect = msg.attribute_set.xor_mapped()
@@ -335,7 +533,7 @@ MaybeError ClientUDP::handle_error_response(Timepoint now, Transaction& t, Messa
         // request; clients that do so MUST limit the number of times they do
         // this.
         m_stat.response_5xx.inc();
-        switch (t.rtx_algo->process_5xx(now, msg_error_code.code)) {
+        switch (t.rtx_algo.process_5xx(now, msg_error_code.code)) {
         case RetransmitAlgo::Process5xxResult::RetransmitScheduled:
             return success();
         case RetransmitAlgo::Process5xxResult::TransactionFailed: {
@@ -351,72 +549,89 @@ MaybeError ClientUDP::handle_error_response(Timepoint now, Transaction& t, Messa
     return success();
 }
 
-ClientUDP::Handle ClientUDP::allocate_handle() noexcept {
-    while (true) {
-        if (auto hnd = Handle{m_next_handle_value++}; !m_tmap.contains(hnd)) {
-            return hnd;
-        }
-    }
-}
-
-ClientUDP::RetransmitAlgoPtr ClientUDP::allocate_rtx_algo(const net::Path& path, Timepoint now) {
+ClientUDP::RetransmitAlgo ClientUDP::create_rtx_algo(const TransactionId& tid, const net::Path& path, Timepoint now) {
     auto rto = m_rto_calc->rto(path);
     return
         std::visit(
             util::overloaded {
                 [&](const Settings::RetransmitDefault& settings) {
-                    return std::make_unique<RetransmitAlgo>(rto, settings, now);
+                    return RetransmitAlgo(rto, settings, now);
+                },
+                [&](const Settings::RetransmitPaced& settings) {
+                    // Transaction id is random so it is used as
+                    // seed of the jitter. First byte may be
+                    // prefix of the client.
+                    const uint32_t seed = tid.view().assured_read_u32be(details::TRANSACTION_ID_SIZE - sizeof(uint32_t));
+                    return RetransmitAlgo(rto, settings, seed | 1, now);
                 }
             },
             m_settings.retransmit);
 }
 
 void ClientUDP::cleanup(const Handle& hnd) {
-    if (auto it = m_tmap.find(hnd); it != m_tmap.end()) {
-        const auto& tid = it->second.tid;
-        m_tid_to_handle.erase(tid);
-        m_tmap.erase(it);
-        // We intentionally do not remove transaction from timeline if
-        // it is there it will be just ignored on next.
+    forget(hnd);
+    m_transactions.erase(hnd);
+}
+
+void ClientUDP::forget(const Handle& hnd) {
+    m_transactions.find(hnd)
+        .with_inner([&](Transaction& t) {
+            t.maybe_timer
+                .with_inner([&](const Timers::Id& timer) {
+                    m_timers.cancel(timer);
+                });
+            m_tid_to_handle.erase(t.tid);
+            t.finished = true;
+            unref_credentials(t.maybe_credentials);
+            t.maybe_credentials = none();
+        });
+}
+
+void ClientUDP::release_finished() {
+    for (const auto& hnd: m_finished) {
+        m_transactions.erase(hnd);
     }
+    m_finished.clear();
 }
 
-ClientUDP::Transaction::Transaction(Timepoint now, TransactionId&& t, Handle h, util::ByteVec&& data,
-                                    RetransmitAlgoPtr&& algo, net::Path&& p, MaybeAuth&& a)
+ClientUDP::Transaction::Transaction(Timepoint now, TransactionId&& t, util::ByteVec&& data,
+                                    RetransmitAlgo&& algo, net::Path&& p, const MaybeCredentialHandle& mc)
     : tid(std::move(t))
-    , hnd(h)
     , msg_data(std::move(data))
     , rtx_algo(std::move(algo))
     , path(std::move(p))
-    , create_time(now)
-    , maybe_auth(std::move(a))
+    , send_time(now)
+    , maybe_credentials(mc)
 {}
 
-ClientUDP::Transaction::~Transaction()
-{}
-
-bool ClientUDP::TimelineGreater::operator()(const TimelineItem& lhs, const TimelineItem& rhs) const noexcept {
-    if (lhs.first.is_after(rhs.first)) {
-        return true;
-    }
-    if (rhs.first.is_after(lhs.first)) {
-        return false;
-    }
-    return lhs.second.value > rhs.second.value;
-}
-
 ClientUDP::RetransmitAlgo::RetransmitAlgo(Duration initial_rto, const Settings::RetransmitDefault& settings, Timepoint now)
     : m_initial_rto(initial_rto)
     , m_settings(settings)
     , m_maybe_next(now.advance(initial_rto))
     , m_last_timeout(initial_rto)
+    , m_timeout(initial_rto)
 {}
 
+ClientUDP::RetransmitAlgo::RetransmitAlgo(Duration initial_rto, const Settings::RetransmitPaced& settings, uint32_t jitter_seed, Timepoint now)
+    : RetransmitAlgo(initial_rto, settings.backoff, now)
+{
+    m_jitter_percent = std::min(settings.jitter_percent, 100u);
+    m_jitter_state = jitter_seed;
+    m_timeout = jitter(initial_rto);
+    m_maybe_next = now.advance(m_timeout);
+}
+
 ClientUDP::MaybeTimepoint ClientUDP::RetransmitAlgo::init(Timepoint now) {
-    m_maybe_next = now.advance(m_last_timeout);
+    m_maybe_next = now.advance(m_timeout);
     return m_maybe_next;
 }
 
+ClientUDP::Timepoint ClientUDP::RetransmitAlgo::sent(Timepoint now) {
+    const auto next = now.advance(m_timeout);
+    m_maybe_next = next;
+    return next;
+}
+
 ClientUDP::MaybeTimepoint ClientUDP::RetransmitAlgo::next(Timepoint now) {
     bool time_for_next = m_maybe_next
         .fmap([&](auto&& next) {
@@ -429,6 +644,8 @@ ClientUDP::MaybeTimepoint ClientUDP::RetransmitAlgo::next(Timepoint now) {
         if (maybe_next.is_some()) {
             ++m_rtx_count;
             m_last_timeout = timeout;
+            m_timeout = jitter(timeout);
+            m_maybe_next = now.advance(m_timeout);
         }
     }
     return m_maybe_next;
@@ -470,5 +687,16 @@ std::pair<ClientUDP::MaybeTimepoint, client_udp::Duration> ClientUDP::Retransmit
     return std::make_pair(now.advance(timeout), timeout);
 }
 
+ClientUDP::Duration ClientUDP::RetransmitAlgo::jitter(Duration timeout) {
+    if (m_jitter_percent == 0) {
+        return timeout;
+    }
+    // xorshift32
+    m_jitter_state ^= m_jitter_state << 13;
+    m_jitter_state ^= m_jitter_state >> 17;
+    m_jitter_state ^= m_jitter_state << 5;
+    const auto percent = int64_t(100 - m_jitter_percent + m_jitter_state % (2 * m_jitter_percent + 1));
+    return timeout * percent / 100;
 }
 
+}
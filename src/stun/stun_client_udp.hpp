@@ -8,26 +8,35 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <random>
 #include <functional>
 #include <queue>
 #include <memory>
+#include <span>
 
 #include "clock/clock_timepoint.hpp"
+#include "clock/clock_timer_wheel.hpp"
 #include "precis/precis_opaque_string.hpp"
 #include "util/util_result.hpp"
 #include "util/util_maybe.hpp"
 #include "util/util_hash_dynamic.hpp"
+#include "util/util_slot_map.hpp"
 #include "stun/stun_message.hpp"
 #include "stun/stun_attribute_set.hpp"
 #include "stun/stun_parse_stat.hpp"
 #include "stun/stun_client_udp_settings.hpp"
 #include "stun/stun_client_udp_handle.hpp"
 #include "stun/stun_client_udp_effects.hpp"
+#include "stun/stun_request_template.hpp"
 #include "net/net_path.hpp"
 
-namespace freewebrtc::stun::details { class ClientUDPRtoCalculator; }
+namespace freewebrtc::stun::details {
+class ClientUDPRtoCalculator;
+class ClientUDPPacer;
+}
 
 namespace freewebrtc::stun {
 
@@ -40,6 +49,7 @@ public:
     using Settings   = client_udp::Settings;
     using Handle     = client_udp::Handle;
     using HandleHash = client_udp::HandleHash;
+    using CredentialHandle = client_udp::CredentialHandle;
 
     // Effects:
     using Effect            = client_udp::Effect;
@@ -48,6 +58,8 @@ public:
     using TransactionFailed = client_udp::TransactionFailed;
     using Sleep             = client_udp::Sleep;
     using Idle              = client_udp::Idle;
+    using EffectSink        = client_udp::EffectSink;
+    using EffectBatch       = client_udp::EffectBatch;
 
     struct Statistics {
         ParseStat parse;
@@ -81,17 +93,42 @@ public:
         IntegrityData integrity;
     };
     using MaybeAuth = Maybe<Auth>;
+    using MaybeCredentialHandle = Maybe<CredentialHandle>;
+    // Register credentials that are shared by transactions
+    // (e.g. all checks to the same peer) instead of copy of
+    // Auth in each transaction.
+    CredentialHandle add_credentials(Auth&&);
+    // Credentials cannot be used for new transactions after
+    // remove. They are released when last transaction that
+    // uses them is finished.
+    void remove_credentials(const CredentialHandle&);
+
     struct Request {
         net::Path path;
         AttributeSet::AttrVec attrs;
         AttributeSet::UnknownAttrVec unknown_attrs;
         MaybeAuth maybe_auth = None{};
+        // Registered credentials. Takes precedence over maybe_auth.
+        MaybeCredentialHandle maybe_credentials = None{};
     };
     // Create transaction with unique identifier. Random device
     // may be override with cryptographic random if needed.
     template<typename RandomDevice = std::random_device>
     Result<Handle> create(RandomDevice&, Timepoint now, Request&&);
 
+    // Serialize request once for many transactions (see
+    // RequestTemplate). Path of the request is not used. Values of
+    // the attributes of patchable types may be changed by each
+    // transaction.
+    Result<RequestTemplate> create_template(Request&&, const std::vector<AttributeType>& patchable = {}) const;
+    // Create transaction from the template. Credentials must be
+    // the same as used for the template. If they are not specified
+    // then integrity data of the template is copied to the transaction.
+    template<typename RandomDevice = std::random_device>
+    Result<Handle> create(RandomDevice&, Timepoint now, const RequestTemplate&, net::Path&&,
+                          std::span<const RequestTemplate::Patch> = {},
+                          const MaybeCredentialHandle& = None{});
+
     // Process response. If stun message was already parsed before
     // then caller may provide parsed message. It optimizes performance by
     // prventing another parse. However if auth is defined integrity will be checked
@@ -100,57 +137,143 @@ public:
 
     // Do next step of the client processing
     Effect next(Timepoint);
+    // Pass all effects that are due at now to the sink at once.
+    // Returns time of the next timer (none if client is idle).
+    MaybeTimepoint drain(Timepoint now, EffectSink&);
+
+    // Snapshot of RTT history of the network paths. It may be
+    // restored after restart of the client to use RTO that is
+    // based on RTT measurements from the beginning.
+    util::ByteVec rto_snapshot(Timepoint now) const;
+    // Restore snapshot that was taken elapsed time ago
+    MaybeError restore_rto(Timepoint now, const util::ConstBinaryView&,
+                           clock::NativeDuration elapsed = clock::NativeDuration{0});
 
 private:
     using Duration = clock::NativeDuration;
     using TransactionIdHash = util::hash::dynamic::Hash<TransactionId>;
-    class RetransmitAlgo;
-    using RetransmitAlgoPtr = std::unique_ptr<RetransmitAlgo>;
+    class RetransmitAlgo {
+    public:
+        explicit RetransmitAlgo(Duration initial_rto, const Settings::RetransmitDefault& settings, Timepoint now);
+        // Timeouts are changed randomly up to jitter percent.
+        // Seed must not be zero.
+        RetransmitAlgo(Duration initial_rto, const Settings::RetransmitPaced& settings, uint32_t jitter_seed, Timepoint now);
+        MaybeTimepoint init(Timepoint now);
+        MaybeTimepoint next(Timepoint now);
+        // Request is sent later than it was scheduled by
+        // init / next (paced). Timeout starts from now.
+        Timepoint sent(Timepoint now);
+        enum class Process5xxResult {
+            TransactionFailed,
+            RetransmitScheduled
+        };
+        Process5xxResult process_5xx(Timepoint, int code);
+        Duration last_timeout() const;
+    private:
+        std::pair<MaybeTimepoint, Duration> calc_next(Timepoint now) const noexcept;
+        Duration jitter(Duration);
+        Duration m_initial_rto;
+        Settings::RetransmitDefault m_settings;
+        MaybeTimepoint m_maybe_next;
+        Duration m_last_timeout;
+        // Last timeout with jitter
+        Duration m_timeout;
+        unsigned m_rtx_count = 0;
+        unsigned m_5xx_count = 0;
+        unsigned m_jitter_percent = 0;
+        uint32_t m_jitter_state = 0;
+    };
+    using Timers = clock::TimerWheel<Handle>;
     struct Transaction {
-        ~Transaction();
-        Transaction(Timepoint now, TransactionId&&, Handle, util::ByteVec&& msg_data, RetransmitAlgoPtr&& rtx_algo, net::Path&&, MaybeAuth&&);
+        Transaction(Timepoint now, TransactionId&&, util::ByteVec&& msg_data, RetransmitAlgo&& rtx_algo, net::Path&&, const MaybeCredentialHandle&);
         Transaction(const Transaction&) = delete;
         Transaction(Transaction&&) = default;
 
         TransactionId tid;
-        Handle hnd;
+        // Handle of the transaction (set when transaction is stored)
+        Handle hnd = {0, 0};
         util::ByteVec msg_data;
-        RetransmitAlgoPtr rtx_algo;
+        // Retransmit state is stored inline
+        RetransmitAlgo rtx_algo;
         net::Path path;
-        Timepoint create_time;
-        MaybeAuth maybe_auth;
+        // Time of initial send of the request (RTT is
+        // measured from it)
+        Timepoint send_time;
+        // Reference to shared credentials
+        MaybeCredentialHandle maybe_credentials;
         unsigned rtx_count = 0;
+        // Transaction is finished but data is kept
+        bool finished = false;
+        // Next retransmit / timeout timer
+        Maybe<Timers::Id> maybe_timer = None{};
     };
     using TransactionRef = std::reference_wrapper<Transaction>;
-    using TimelineItem = std::pair<Timepoint, Handle>;
-    struct TimelineGreater {
-        bool operator()(const TimelineItem&, const TimelineItem&) const noexcept;
+    struct Credentials {
+        Auth auth;
+        // Number of transactions that use credentials
+        unsigned refs = 0;
+        // Credentials are released when they are not used
+        // by transactions anymore.
+        bool removed = false;
     };
+    using AuthRef = std::reference_wrapper<const Auth>;
     using RtoCalculator = details::ClientUDPRtoCalculator;
     using RtoCalculatorPtr = std::unique_ptr<RtoCalculator>;
+    using Pacer = details::ClientUDPPacer;
+    using PacerPtr = std::unique_ptr<Pacer>;
 
+    template<typename RandomDevice>
+    TransactionId generate_tid(RandomDevice&) const;
     Result<TransactionRef> find_transaction(const TransactionId&) noexcept;
     MaybeError check_response_auth(const Transaction&, const Message&, util::ConstBinaryView view) noexcept;
+    Message make_request(TransactionId&&, Request&, const Maybe<AuthRef>&) const;
     Result<Handle> do_create(Timepoint, TransactionId&&, Request&&);
+    Result<Handle> do_create(Timepoint, TransactionId&&, const RequestTemplate&, net::Path&&,
+                             std::span<const RequestTemplate::Patch>, const MaybeCredentialHandle&);
+    Handle store(Timepoint, TransactionId&&, util::ByteVec&&, net::Path&&, const MaybeCredentialHandle&);
+    // Credentials of the request: registered or added for the
+    // transaction only. Reference of the transaction is counted.
+    Result<MaybeCredentialHandle> acquire_credentials(const MaybeCredentialHandle&, MaybeAuth&&);
+    Maybe<AuthRef> find_auth(const MaybeCredentialHandle&) const noexcept;
+    // Release credentials if they are removed and not used anymore
+    void unref_credentials(const MaybeCredentialHandle&);
     MaybeError handle_success_response(Timepoint now, Transaction& trans, Message&& msg);
     MaybeError handle_error_response(Timepoint now, Transaction& trans, Message&& msg);
-    Handle allocate_handle() noexcept;
-    RetransmitAlgoPtr allocate_rtx_algo(const net::Path& path, Timepoint now);
+    RetransmitAlgo create_rtx_algo(const TransactionId&, const net::Path& path, Timepoint now);
+    // Fire due timers of the transactions and release paced
+    // sends. Effects are passed to the function.
+    template<typename F>
+    void process_timers(Timepoint now, F&& on_effect);
+    template<typename F>
+    void release_paced(Timepoint now, F&& on_effect);
+    // Time of next timer or paced send
+    MaybeTimepoint next_wakeup() const noexcept;
     void cleanup(const Handle&);
+    // Stop timers of the transaction and forget its transaction id
+    // but keep data of the transaction.
+    void forget(const Handle&);
+    // Cleanup transactions that are finished by drain.
+    void release_finished();
 
     const Settings m_settings;
     Statistics m_stat;
-    decltype(Handle::value) m_next_handle_value = 0;
     // Way to find Handle by Transaction Id
     std::unordered_map<TransactionId, Handle, TransactionIdHash> m_tid_to_handle;
     // Primary storage of the transaction states.
-    std::unordered_map<Handle, Transaction, HandleHash> m_tmap;
-    // Next timeline across all existing transacitons.
-    std::priority_queue<TimelineItem, std::vector<TimelineItem>,  TimelineGreater> m_tid_timeline;
+    util::SlotMap<Transaction, Handle> m_transactions;
+    // Timers of all existing transacitons.
+    Timers m_timers;
     // Pending effects that returned to user from next() function.
     std::queue<Effect> m_effects;
+    // Transactions finished by drain. Data of the transactions is
+    // kept until next drain / next call.
+    std::vector<Handle> m_finished;
+    // Credentials shared by transactions
+    util::SlotMap<Credentials, CredentialHandle> m_credentials;
     // Initial RTO calculator
     RtoCalculatorPtr m_rto_calc;
+    // Pacing of the sends (if retransmits are paced)
+    PacerPtr m_pacer;
 };
 
 //
@@ -160,7 +283,7 @@ template<typename RandomDevice>
 inline Result<ClientUDP::Handle>
 ClientUDP::create(RandomDevice& rand, Timepoint now, Request&& req) {
     while (true) {
-        TransactionId id = TransactionId::generate(rand);
+        TransactionId id = generate_tid(rand);
         if (m_tid_to_handle.contains(id)) {
             continue;
         }
@@ -168,5 +291,31 @@ ClientUDP::create(RandomDevice& rand, Timepoint now, Request&& req) {
     }
 }
 
+template<typename RandomDevice>
+inline Result<ClientUDP::Handle>
+ClientUDP::create(RandomDevice& rand, Timepoint now, const RequestTemplate& tmpl, net::Path&& path,
+                  std::span<const RequestTemplate::Patch> patches, const MaybeCredentialHandle& maybe_credentials) {
+    while (true) {
+        TransactionId id = generate_tid(rand);
+        if (m_tid_to_handle.contains(id)) {
+            continue;
+        }
+        return do_create(now, std::move(id), tmpl, std::move(path), patches, maybe_credentials);
+    }
 }
 
+template<typename RandomDevice>
+inline TransactionId ClientUDP::generate_tid(RandomDevice& rand) const {
+    TransactionId id = TransactionId::generate(rand);
+    return m_settings.maybe_tid_prefix
+        .fmap([&](uint8_t prefix) {
+            std::array<uint8_t, details::TRANSACTION_ID_SIZE> value;
+            const auto vv = id.view();
+            std::copy(vv.begin(), vv.end(), value.begin());
+            value[0] = prefix;
+            return TransactionId(util::ConstBinaryView(value));
+        })
+        .value_or(id);
+}
+
+}
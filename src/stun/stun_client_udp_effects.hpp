@@ -90,4 +90,51 @@ struct Idle {};
 
 using Effect = std::variant<SendData, TransactionOk, TransactionFailed, Sleep, Idle>;
 
+// Receiver of the effects from ClientUDP::drain. Data referenced
+// by SendData is valid until next call of drain / next even if
+// transaction is finished by the same drain.
+class EffectSink {
+public:
+    virtual ~EffectSink() = default;
+    virtual void send_data(const SendData&) = 0;
+    virtual void transaction_ok(TransactionOk&&) = 0;
+    virtual void transaction_failed(TransactionFailed&&) = 0;
+};
+
+// Sink that collects effects in vectors (e.g. to pass all
+// SendData to one sendmmsg). Memory of the vectors is reused
+// after clear.
+class EffectBatch : public EffectSink {
+public:
+    std::vector<SendData> send;
+    std::vector<TransactionOk> ok;
+    std::vector<TransactionFailed> failed;
+
+    void send_data(const SendData&) override;
+    void transaction_ok(TransactionOk&&) override;
+    void transaction_failed(TransactionFailed&&) override;
+    void clear() noexcept;
+};
+
+//
+// inlines
+//
+inline void EffectBatch::send_data(const SendData& s) {
+    send.push_back(s);
+}
+
+inline void EffectBatch::transaction_ok(TransactionOk&& v) {
+    ok.emplace_back(std::move(v));
+}
+
+inline void EffectBatch::transaction_failed(TransactionFailed&& v) {
+    failed.emplace_back(std::move(v));
+}
+
+inline void EffectBatch::clear() noexcept {
+    send.clear();
+    ok.clear();
+    failed.clear();
+}
+
 }
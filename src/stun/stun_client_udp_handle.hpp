@@ -3,19 +3,31 @@
 // All rights reserved.
 // Distributed under the terms of the MIT License. See the LICENSE file.
 //
-// STUN client transaction handle
+// STUN client transaction and credentials handles
 //
 
 #pragma once
 
 #include <stddef.h>
+#include <cstdint>
 #include <functional>
 
 namespace freewebrtc::stun::client_udp {
 
+// Handle of the transaction. Handle of the finished transaction
+// is never valid again (generation of the storage slot is changed).
 struct Handle {
-    unsigned value;
-    bool operator<=>(const Handle&) const noexcept = default;
+    uint32_t index;
+    uint32_t generation;
+    bool operator==(const Handle&) const noexcept = default;
+};
+
+// Handle of the credentials registered in the client. Credentials
+// are shared by all transactions that are created with the handle.
+struct CredentialHandle {
+    uint32_t index;
+    uint32_t generation;
+    bool operator==(const CredentialHandle&) const noexcept = default;
 };
 
 struct HandleHash {
@@ -26,8 +38,8 @@ struct HandleHash {
 // inlines
 //
 inline size_t HandleHash::operator()(Handle hnd) const noexcept {
-    std::hash<decltype(hnd.value)> h;
-    return h(hnd.value);
+    std::hash<uint64_t> h;
+    return h((uint64_t(hnd.generation) << 32) | hnd.index);
 }
 
 }
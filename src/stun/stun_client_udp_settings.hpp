@@ -50,7 +50,24 @@ struct Settings {
         // the number of retransmissions SHOULD be limited to 4.
         unsigned server_error_max_retransmits = 4;
     };
-    using Retransmit = std::variant<RetransmitDefault>;
+    // Retransmits of RetransmitDefault with global pacing of
+    // sends of all transactions (RFC8445 6.1.4.2: Ta). Initial
+    // sends and retransmits are queued and released one per
+    // pacing interval so many transactions started at once do
+    // not overflow socket buffers and NAT queues.
+    struct RetransmitPaced {
+        RetransmitDefault backoff = {};
+        // Minimum interval between sends (Ta)
+        Duration pacing_interval = 50ms;
+        // Number of sends that may be released back-to-back
+        // after idle period (size of token bucket).
+        unsigned burst_size = 1;
+        // Retransmit timeouts are randomly changed up to
+        // percent of timeout so retransmits of transactions
+        // started at the same time are spread.
+        unsigned jitter_percent = 10;
+    };
+    using Retransmit = std::variant<RetransmitDefault, RetransmitPaced>;
     Retransmit retransmit = RetransmitDefault{};
 
     struct RtoCalculatorSettings {
@@ -59,6 +76,19 @@ struct Settings {
         // How long do we keep history for each individual
         // network path
         Duration history_duration = 1h;
+        // Maximum number of network paths in history. Least
+        // recently updated path is dropped if limit is reached.
+        size_t max_paths = 65536;
+        // Share smoothed RTT between paths to targets in the same
+        // network prefix. It is used as initial RTO for the paths
+        // that have no own history.
+        struct PrefixAggregation {
+            unsigned ipv4_prefix_len = 24;
+            unsigned ipv6_prefix_len = 48;
+            // Maximum number of prefixes in history
+            size_t max_prefixes = 16384;
+        };
+        Maybe<PrefixAggregation> maybe_prefix_aggregation = None{};
     };
 
     RtoCalculatorSettings rto_settings = {};
@@ -71,6 +101,10 @@ struct Settings {
     // Hash of transaction ID. By default murmur hash without
     // seed randomization.
     Maybe<TransactionIdHash> maybe_tid_hash = None{};
+
+    // First byte of all transaction IDs generated by the client.
+    // Used to find the client by response (see ShardedClientUDP).
+    Maybe<uint8_t> maybe_tid_prefix = None{};
 };
 
 }
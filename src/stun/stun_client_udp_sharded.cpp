@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Sharded STUN client over UDP
+//
+
+#include <algorithm>
+
+#include "stun/stun_client_udp_sharded.hpp"
+#include "stun/stun_error.hpp"
+
+namespace freewebrtc::stun {
+
+ShardedClientUDP::ShardedClientUDP(size_t shards_count, const Settings& settings) {
+    shards_count = std::clamp<size_t>(shards_count, 1, MAX_SHARDS);
+    m_shards.reserve(shards_count);
+    for (size_t i = 0; i < shards_count; ++i) {
+        Settings shard_settings = settings;
+        shard_settings.maybe_tid_prefix = uint8_t(i);
+        m_shards.emplace_back(std::make_unique<ClientUDP>(shard_settings));
+    }
+}
+
+Maybe<size_t> ShardedClientUDP::shard_of(const util::ConstBinaryView& view) const noexcept {
+    auto index_rv = route(view);
+    if (index_rv.is_err()) {
+        return none();
+    }
+    return index_rv.unwrap();
+}
+
+MaybeError ShardedClientUDP::response(Timepoint now, const util::ConstBinaryView& view) {
+    return route(view)
+        .bind([&](size_t index) {
+            return shard(index).response(now, view);
+        });
+}
+
+Result<size_t> ShardedClientUDP::route(const util::ConstBinaryView& view) const noexcept {
+    // Parse statistics is collected by the shard that
+    // processes the response.
+    ParseStat stat;
+    return Message::peek(view, stat)
+        .bind([&](const Message::Peek& peek) -> Result<size_t> {
+            const size_t index = peek.transaction_id.assured_read_u8(0);
+            if (peek.is_rfc3489 || index >= m_shards.size()) {
+                return make_error_code(ClientError::transaction_not_found);
+            }
+            return index;
+        });
+}
+
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Sharded STUN client over UDP
+//
+// Set of independent ClientUDP instances (shards). First byte
+// of transaction id of each transaction is index of the shard so
+// response is routed to the shard that owns the transaction
+// without any shared state. Each shard may be used by its own
+// thread without locking.
+//
+
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "stun/stun_client_udp.hpp"
+#include "stun/stun_error.hpp"
+
+namespace freewebrtc::stun {
+
+class ShardedClientUDP {
+public:
+    using Timepoint = ClientUDP::Timepoint;
+    using Settings = ClientUDP::Settings;
+    using Request = ClientUDP::Request;
+    static constexpr size_t MAX_SHARDS = 256;
+
+    struct Handle {
+        size_t shard;
+        ClientUDP::Handle handle;
+        bool operator==(const Handle&) const noexcept = default;
+    };
+
+    // Number of shards is limited by MAX_SHARDS. Transaction id
+    // prefix of the settings is overridden by index of the shard.
+    ShardedClientUDP(size_t shards_count, const Settings&);
+
+    size_t shards_count() const noexcept;
+    // Shard must not be used by multiple threads at once but
+    // different shards may be used in parallel. Index must be
+    // less than shards_count().
+    ClientUDP& shard(size_t index) noexcept;
+    const ClientUDP& shard(size_t index) const noexcept;
+
+    // Create transaction in the shard. Error if there is no
+    // shard with the index.
+    template<typename RandomDevice = std::random_device>
+    Result<Handle> create(RandomDevice&, size_t shard, Timepoint now, Request&&);
+
+    // Index of the shard that owns transaction of the response.
+    // Only STUN header is checked. Returns none if data is not
+    // STUN response of one of the shards.
+    Maybe<size_t> shard_of(const util::ConstBinaryView&) const noexcept;
+    // Process response in the owning shard
+    MaybeError response(Timepoint now, const util::ConstBinaryView&);
+
+private:
+    Result<size_t> route(const util::ConstBinaryView&) const noexcept;
+
+    std::vector<std::unique_ptr<ClientUDP>> m_shards;
+};
+
+//
+// implementation
+//
+inline size_t ShardedClientUDP::shards_count() const noexcept {
+    return m_shards.size();
+}
+
+inline ClientUDP& ShardedClientUDP::shard(size_t index) noexcept {
+    assert(index < m_shards.size());
+    return *m_shards[index];
+}
+
+inline const ClientUDP& ShardedClientUDP::shard(size_t index) const noexcept {
+    assert(index < m_shards.size());
+    return *m_shards[index];
+}
+
+template<typename RandomDevice>
+inline Result<ShardedClientUDP::Handle>
+ShardedClientUDP::create(RandomDevice& rand, size_t index, Timepoint now, Request&& req) {
+    if (index >= m_shards.size()) {
+        return make_error_code(ClientError::invalid_shard_index);
+    }
+    return shard(index)
+        .create(rand, now, std::move(req))
+        .fmap([&](ClientUDP::Handle&& hnd) {
+            return Handle{index, hnd};
+        });
+}
+
+}
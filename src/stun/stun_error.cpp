@@ -57,11 +57,31 @@ public:
         case ClientError::no_address_in_response:             return "bad response: no address in response";
         case ClientError::no_error_code_in_response:          return "bad response: no error code attribute in response";
         case ClientError::no_alternate_server_in_response:    return "bad response: no alternate server in 300 response";
+        case ClientError::credentials_not_found:              return "credentials are not found";
+        case ClientError::invalid_rto_snapshot:               return "invalid RTO history snapshot";
+        case ClientError::invalid_shard_index:                return "invalid index of client shard";
         }
         return "unknown stun client error";
     }
 };
 
+class BuildErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override {
+        return "stun build error";
+    }
+    std::string message(int code) const override {
+        switch ((BuildError)code) {
+        case BuildError::ok:               return "success";
+        case BuildError::buffer_too_small: return "buffer is too small for message";
+        case BuildError::transaction_id_size_mismatch: return "transaction id size does not match template";
+        case BuildError::attribute_is_not_patchable:   return "attribute is not patchable in template";
+        case BuildError::patch_value_size_mismatch:    return "patch value size does not match template";
+        }
+        return "unknown stun build error";
+    }
+};
+
 const std::error_category& stun_parse_error_category() {
     static const ParseErrorCategory cat;
     return cat;
@@ -73,4 +93,9 @@ const std::error_category& stun_client_error_category() {
     return cat;
 }
 
+const std::error_category& stun_build_error_category() {
+    static const BuildErrorCategory cat;
+    return cat;
+}
+
 }
@@ -43,14 +43,27 @@ enum class ClientError {
     transaction_not_found,
     no_address_in_response,
     no_error_code_in_response,
-    no_alternate_server_in_response
+    no_alternate_server_in_response,
+    credentials_not_found,
+    invalid_rto_snapshot,
+    invalid_shard_index
+};
+
+enum class BuildError {
+    ok = 0,
+    buffer_too_small,
+    transaction_id_size_mismatch,
+    attribute_is_not_patchable,
+    patch_value_size_mismatch
 };
 
 std::error_code make_error_code(ParseError);
 std::error_code make_error_code(ClientError);
+std::error_code make_error_code(BuildError);
 
 const std::error_category& stun_parse_error_category();
 const std::error_category& stun_client_error_category();
+const std::error_category& stun_build_error_category();
 
 //
 // inline
@@ -63,5 +76,9 @@ inline std::error_code make_error_code(ClientError ec) {
     return std::error_code((int)ec, stun_client_error_category());
 }
 
+inline std::error_code make_error_code(BuildError ec) {
+    return std::error_code((int)ec, stun_build_error_category());
+}
+
 
 }
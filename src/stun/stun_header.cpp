@@ -6,6 +6,8 @@
 // STUN Header
 //
 
+#include <cstring>
+
 #include "stun/stun_header.hpp"
 #include "stun/details/stun_constants.hpp"
 #include "util/util_endian.hpp"
@@ -13,25 +15,26 @@
 namespace freewebrtc::stun {
 
 util::ByteVec Header::build(size_t len) const {
+    util::ByteVec result(details::STUN_HEADER_SIZE);
+    build_into(result, len);
+    return result;
+}
+
+void Header::build_into(std::span<uint8_t> out, size_t len) const noexcept {
     const uint16_t msg_type = util::host_to_network_u16(cls.to_msg_type() | method.to_msg_type());
     const uint16_t msg_size = util::host_to_network_u16(len);
-    if (transaction_id.view().size() == details::TRANSACTION_ID_SIZE) {
+    const auto tid = transaction_id.view();
+    memcpy(out.data(), &msg_type, sizeof(msg_type));
+    memcpy(out.data() + 2, &msg_size, sizeof(msg_size));
+    size_t offset = 4;
+    if (tid.size() == details::TRANSACTION_ID_SIZE) {
         // With magic cookie
         const uint32_t magic_cookie = util::host_to_network_u32(details::MAGIC_COOKIE);
-        return util::ConstBinaryView::concat({
-                util::ConstBinaryView(&msg_type, sizeof(msg_type)),
-                util::ConstBinaryView(&msg_size, sizeof(msg_size)),
-                util::ConstBinaryView(&magic_cookie, sizeof(magic_cookie)),
-                transaction_id.view()
-            });
-    } else {
-        // No magic cookie (backward compatibility to RFC3489)
-        return util::ConstBinaryView::concat({
-                util::ConstBinaryView(&msg_type, sizeof(msg_type)),
-                util::ConstBinaryView(&msg_size, sizeof(msg_size)),
-                transaction_id.view()
-            });
+        memcpy(out.data() + offset, &magic_cookie, sizeof(magic_cookie));
+        offset += sizeof(magic_cookie);
     }
+    // No magic cookie otherwise (backward compatibility to RFC3489)
+    std::copy(tid.begin(), tid.end(), out.begin() + offset);
 }
 
 }
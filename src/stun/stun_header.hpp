@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "stun/stun_method.hpp"
@@ -22,6 +23,8 @@ struct Header {
     TransactionId transaction_id;
 
     util::ByteVec build(size_t msg_len) const;
+    // Write header into the buffer of STUN_HEADER_SIZE bytes.
+    void build_into(std::span<uint8_t>, size_t msg_len) const noexcept;
 };
 
 }
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Batch check of STUN MESSAGE-INTEGRITY
+//
+
+#include "stun/stun_integrity_batch.hpp"
+#include "stun/details/stun_message_integrity.hpp"
+#include "crypto/builtin/builtin_hmac_multi.hpp"
+
+namespace freewebrtc::stun {
+
+std::vector<Result<Maybe<bool>>> is_valid_batch(std::span<const IntegrityCheck> checks, const crypto::SHA1Hash::Func& hash) {
+    using MaybeBool = Maybe<bool>;
+    using View = util::ConstBinaryView;
+    std::vector<Result<MaybeBool>> result;
+    result.reserve(checks.size());
+    // Jobs refer to headers and views so they must not be
+    // reallocated.
+    std::vector<details::IntegrityHeader> headers;
+    headers.reserve(checks.size());
+    std::vector<std::array<View, 2>> job_views;
+    job_views.reserve(checks.size());
+    std::vector<crypto::builtin::HMACSHA1Job> jobs;
+    jobs.reserve(checks.size());
+    std::vector<size_t> job_check;
+    job_check.reserve(checks.size());
+
+    for (const auto& check: checks) {
+        const auto& msg = check.message.get();
+        const auto& precomputed = check.password.get().precomputed();
+        const auto maybe_interval = msg.integrity_interval();
+        if (maybe_interval.is_none()) {
+            result.emplace_back(MaybeBool{none()});
+            continue;
+        }
+        if (precomputed.is_none()) {
+            result.emplace_back(msg.is_valid(check.password.get(), hash));
+            continue;
+        }
+        const auto& data = msg.data();
+        const size_t integrity_offset = maybe_interval.value().count;
+        auto add_job = details::integrity_header(data, integrity_offset)
+            .fmap([&](const details::IntegrityHeader& header) {
+                headers.emplace_back(header);
+                job_views.emplace_back(std::array<View, 2>{
+                        View(headers.back()),
+                        data.assured_subview(4, integrity_offset - 4)
+                    });
+                jobs.emplace_back(crypto::builtin::HMACSHA1Job{precomputed.value(), job_views.back()});
+                job_check.emplace_back(result.size());
+                // Replaced by the result of the check below
+                return MaybeBool{false};
+            });
+        result.emplace_back(std::move(add_job));
+    }
+
+    const auto digests_rv = crypto::builtin::hmac_sha1_multi(jobs);
+    if (digests_rv.is_err()) {
+        for (size_t i: job_check) {
+            result[i] = digests_rv.unwrap_err();
+        }
+        return result;
+    }
+    const auto& digests = digests_rv.unwrap();
+    for (size_t i = 0; i < digests.size(); ++i) {
+        const auto& msg = checks[job_check[i]].message.get();
+        const bool valid = msg.integrity()
+            .fmap([&](const MessageIntegityAttribute::Digest& expected) {
+                return digests[i].value == expected.value;
+            })
+            .value_or(false);
+        result[job_check[i]] = MaybeBool{valid};
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Batch check of STUN MESSAGE-INTEGRITY
+//
+
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "stun/stun_message_view.hpp"
+
+namespace freewebrtc::stun {
+
+struct IntegrityCheck {
+    std::reference_wrapper<const MessageView> message;
+    std::reference_wrapper<const Password> password;
+};
+
+// Check MESSAGE-INTEGRITY of many messages at once. Result
+// for each check is the same as MessageView::is_valid. Messages
+// with passwords that have precomputed HMAC keys are processed
+// by multi-buffer HMAC-SHA1 (see crypto::builtin::hmac_sha1_multi),
+// others are processed one by one using hash function.
+std::vector<Result<Maybe<bool>>> is_valid_batch(std::span<const IntegrityCheck>, const crypto::SHA1Hash::Func&);
+
+}
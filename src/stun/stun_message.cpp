@@ -11,10 +11,9 @@
 #include "stun/details/stun_attr_registry.hpp"
 #include "stun/details/stun_fingerprint.hpp"
 #include "stun/details/stun_constants.hpp"
+#include "stun/details/stun_message_integrity.hpp"
 #include "util/util_variant_overloaded.hpp"
 #include "util/util_result.hpp"
-#include "util/util_reduce.hpp"
-#include <iostream>
 
 namespace freewebrtc::stun {
 
@@ -33,14 +32,15 @@ private:
 };
 
 struct ParseAttrsResult {
-    std::vector<Attribute::ParseResult> attrs;
+    AttributeSet attrs;
     Maybe<util::ConstBinaryView::Interval> maybe_integrity_interval;
     Maybe<util::ConstBinaryView::Interval> maybe_fingerprint_interval;
+    Maybe<uint32_t> maybe_fingerprint;
 };
 
 Result<ParseAttrsResult> parse_attrs(util::ConstBinaryView vv, size_t attr_offset, ParseStat& stat);
 
-Result<Message> Message::parse(const util::ConstBinaryView& vv, ParseStat& stat) {
+Result<Message::Peek> Message::peek(const util::ConstBinaryView& vv, ParseStat& stat) {
     using namespace details;
     if (vv.size() < STUN_HEADER_SIZE) {
         stat.error.inc();
@@ -90,36 +90,27 @@ Result<Message> Message::parse(const util::ConstBinaryView& vv, ParseStat& stat)
         !is_rfc3489 ? vv.assured_subview(8, TRANSACTION_ID_SIZE)
                     : vv.assured_subview(4, TRANSACTION_ID_SIZE_RFC3489);
 
-    AttributeSet attrs;
-    Maybe<util::ConstBinaryView::Interval> maybe_integrity_interval = none();
-    Maybe<util::ConstBinaryView::Interval> maybe_fingerprint_interval = none();
-    Maybe<uint32_t> fingerprint_value = none();
+    return Peek{
+        cls,
+        Method::from_msg_type(msg_type),
+        transaction_id,
+        is_rfc3489
+    };
+}
+
+Result<Message> Message::parse(const util::ConstBinaryView& vv, ParseStat& stat) {
+    using namespace details;
+    auto peek_rv = peek(vv, stat);
+    if (peek_rv.is_err()) {
+        return peek_rv.unwrap_err();
+    }
+    const auto& hdr = peek_rv.unwrap();
     return parse_attrs(vv, STUN_HEADER_SIZE, stat)
-        .bind([&](ParseAttrsResult&& r) {
-            maybe_integrity_interval = r.maybe_integrity_interval;
-            maybe_fingerprint_interval = r.maybe_fingerprint_interval;
-            return util::reduce(r.attrs.begin(), r.attrs.end(), [&](auto&& pr) {
-                return std::visit(
-                    util::overloaded {
-                        [&](UnknownAttribute&& attr) {
-                            attrs.emplace(std::move(attr));
-                            return success();
-                        },
-                        [&](Attribute&& attr) -> MaybeError {
-                            if (const auto *fingerprint = attr.as<FingerprintAttribute>(); fingerprint != nullptr) {
-                                fingerprint_value = fingerprint->crc32;
-                            }
-                            attrs.emplace(std::move(attr));
-                            return success();
-                        }
-                 }, std::move(pr));
-            });
-        })
-        .bind([&](auto&&) -> MaybeError {
+        .bind([&](ParseAttrsResult&& r) -> Result<Message> {
             // check fingerprint if among attributes
-            auto fingerprint_is_valid = fingerprint_value
+            auto fingerprint_is_valid = r.maybe_fingerprint
                 .fmap([&](auto fp) {
-                    return maybe_fingerprint_interval
+                    return r.maybe_fingerprint_interval
                         .bind([&](auto interval) {
                             return vv.subview(interval);
                         })
@@ -141,65 +132,32 @@ Result<Message> Message::parse(const util::ConstBinaryView& vv, ParseStat& stat)
                 stat.invalid_fingerprint.inc();
                 return make_error_code(ParseError::fingerprint_not_valid);
             }
-            return success();
-        })
-        .fmap([&](auto&&) {
             stat.success.inc();
             return Message {
                 Header {
-                    cls,
-                    Method::from_msg_type(msg_type),
-                    TransactionId(transaction_id)
+                    hdr.cls,
+                    hdr.method,
+                    TransactionId(hdr.transaction_id)
                 },
-                std::move(attrs),
-                is_rfc3489,
-                maybe_integrity_interval
+                std::move(r.attrs),
+                hdr.is_rfc3489,
+                r.maybe_integrity_interval
             };
         });
 }
 
 Result<Maybe<bool>> Message::is_valid(const util::ConstBinaryView& data, const IntegrityData& idata) const noexcept {
-    using namespace details;
     using MaybeBool = Maybe<bool>;
-    using View = util::ConstBinaryView;
     using DigestRef = std::reference_wrapper<const MessageIntegityAttribute::Digest>;
-    struct Data {
-        DigestRef digest;
-        View without_4byte_header;
-        size_t integrity_message_len;
-    };
-    size_t integrity_message_len = 0;
     return integrity_interval
         .bind([&](auto&& ii) {
-            return data.subview(ii);
-        })
-        .bind([&](util::ConstBinaryView&& c) {
-            integrity_message_len = c.size() + STUN_ATTR_HEADER_SIZE + crypto::SHA1Hash::size - STUN_HEADER_SIZE;
-            return c.subview(4);
-        })
-        .bind([&](auto&& h) {
-            return attribute_set.integrity().fmap([&](const DigestRef& digest) {
-                return Data{
-                    .digest = digest,
-                    .without_4byte_header = h,
-                    .integrity_message_len = integrity_message_len
-                };
+            return attribute_set.integrity().fmap([&](const DigestRef& expected) -> Result<MaybeBool> {
+                return details::integrity_digest(data, ii.count, idata)
+                    .fmap([&](auto&& digest) {
+                        return MaybeBool{digest.value == expected.get().value};
+                    });
             });
         })
-        .fmap([&](const Data& d) -> Result<MaybeBool> {
-            // Fake header for integrity checking:
-            std::array<uint8_t, 4> header = {
-                data.data()[0],
-                data.data()[1],
-                uint8_t((d.integrity_message_len >> 8) & 0xFF),
-                uint8_t(d.integrity_message_len & 0xFF)
-            };
-            const auto& p = idata.password;
-            return crypto::hmac::digest({View(header), d.without_4byte_header}, p.opad(), p.ipad(), idata.hash)
-                .fmap([&](auto&& digest) {
-                    return MaybeBool{digest.value == d.digest.get().value};
-                });
-        })
         .value_or(Result<MaybeBool>{none()});
 }
 
@@ -208,6 +166,18 @@ Result<util::ByteVec> Message::build(const MaybeIntegrity& maybeintegrity) const
     return attribute_set.build(header, maybeintegrity);
 }
 
+size_t Message::build_size(const MaybeIntegrity& maybeintegrity) const noexcept {
+    return attribute_set.build_size(maybeintegrity);
+}
+
+Result<size_t> Message::build_into(std::span<uint8_t> out, const MaybeIntegrity& maybeintegrity) const noexcept {
+    return attribute_set.build_into(header, maybeintegrity, out);
+}
+
+MaybeError Message::build_gather(MessageGather& g, const MaybeIntegrity& maybeintegrity) const noexcept {
+    return attribute_set.build_gather(header, maybeintegrity, g);
+}
+
 RawAttr::RawAttr(uint16_t type, uint16_t length, util::ConstBinaryView value)
     : m_type(type)
     , m_length(length)
@@ -256,9 +226,12 @@ size_t RawAttr::aligned_length() const noexcept {
 }
 
 Result<ParseAttrsResult> parse_attrs(util::ConstBinaryView vv, size_t attr_offset, ParseStat& stat) {
-    std::vector<RawAttr> raw_attrs;
-    Maybe<util::ConstBinaryView::Interval> maybe_integrity_interval = none();
-    Maybe<util::ConstBinaryView::Interval> maybe_fingerprint_interval = none();
+    ParseAttrsResult result{
+        .attrs = AttributeSet{},
+        .maybe_integrity_interval = none(),
+        .maybe_fingerprint_interval = none(),
+        .maybe_fingerprint = none()
+    };
     while (attr_offset < vv.size()) {
         auto rawattr_rv = RawAttr::parse(vv, attr_offset);
         if (rawattr_rv.is_err()) {
@@ -267,10 +240,10 @@ Result<ParseAttrsResult> parse_attrs(util::ConstBinaryView vv, size_t attr_offse
             return make_error_code(ParseError::invalid_attr_size);
         }
         const auto raw_attr = rawattr_rv.unwrap();
+        bool need_parse = true;
         switch (raw_attr.type()) {
         case attr_registry::FINGERPRINT:
-            raw_attrs.emplace_back(raw_attr);
-            maybe_fingerprint_interval = util::ConstBinaryView::Interval{0, attr_offset};
+            result.maybe_fingerprint_interval = util::ConstBinaryView::Interval{0, attr_offset};
             // 15.5.  FINGERPRINT
             // When present, the FINGERPRINT attribute MUST be the last attribute in
             // the message, and thus will appear after MESSAGE-INTEGRITY.
@@ -285,41 +258,40 @@ Result<ParseAttrsResult> parse_attrs(util::ConstBinaryView vv, size_t attr_offse
             // The text used as input to HMAC is the STUN message,
             // including the header, up to and including the attribute
             // preceding the MESSAGE-INTEGRITY attribute.
-            raw_attrs.emplace_back(raw_attr);
-            maybe_integrity_interval = util::ConstBinaryView::Interval{0, attr_offset};
+            result.maybe_integrity_interval = util::ConstBinaryView::Interval{0, attr_offset};
             break;
         default:
-            if (!maybe_integrity_interval.is_some()) {
-                // RFC5389:
-                // 15.4.  MESSAGE-INTEGRITY
-                // With the exception of the FINGERPRINT attribute,
-                // which appears after MESSAGE-INTEGRITY, agents MUST
-                // ignore all other attributes that follow
-                // MESSAGE-INTEGRITY.
-                raw_attrs.emplace_back(raw_attr);
-            }
+            // RFC5389:
+            // 15.4.  MESSAGE-INTEGRITY
+            // With the exception of the FINGERPRINT attribute,
+            // which appears after MESSAGE-INTEGRITY, agents MUST
+            // ignore all other attributes that follow
+            // MESSAGE-INTEGRITY.
+            need_parse = !result.maybe_integrity_interval.is_some();
             break;
         }
+        if (need_parse) {
+            const auto attr_type = AttributeType::from_uint16(raw_attr.type());
+            auto attr_rv = Attribute::parse(raw_attr.value(), attr_type, stat);
+            if (attr_rv.is_err()) {
+                return attr_rv.unwrap_err();
+            }
+            std::visit(
+                util::overloaded {
+                    [&](UnknownAttribute&& attr) {
+                        result.attrs.emplace(std::move(attr));
+                    },
+                    [&](Attribute&& attr) {
+                        if (const auto *fingerprint = attr.as<FingerprintAttribute>(); fingerprint != nullptr) {
+                            result.maybe_fingerprint = fingerprint->crc32;
+                        }
+                        result.attrs.emplace(std::move(attr));
+                    }
+                }, std::move(attr_rv.unwrap()));
+        }
         attr_offset += raw_attr.aligned_length();
     }
-    using Result = std::vector<Attribute::ParseResult>;
-    Result result;
-    result.reserve(raw_attrs.size());
-    return util::reduce(raw_attrs.begin(), raw_attrs.end(), result, [&](Result&& result, const RawAttr& raw_attr) {
-        const auto attr_view = raw_attr.value();
-        const auto attr_type = AttributeType::from_uint16(raw_attr.type());
-        return Attribute::parse(attr_view, attr_type, stat)
-            .fmap([&](Attribute::ParseResult&& attr) {
-                result.emplace_back(std::move(attr));
-                return result;
-            });
-    }).fmap([&](Result&& attrs) {
-        return ParseAttrsResult {
-            .attrs = std::move(attrs),
-            .maybe_integrity_interval = maybe_integrity_interval,
-            .maybe_fingerprint_interval = maybe_fingerprint_interval,
-        };
-    });
+    return result;
 }
 
 }
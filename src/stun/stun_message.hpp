@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <span>
 #include <vector>
 #include <system_error>
 
@@ -19,6 +20,7 @@
 #include "stun/stun_attribute_set.hpp"
 #include "stun/stun_parse_stat.hpp"
 #include "stun/stun_integrity.hpp"
+#include "stun/stun_message_gather.hpp"
 
 #include "crypto/crypto_hash.hpp"
 
@@ -36,6 +38,18 @@ struct Message {
     IsRFC3489 is_rfc3489;
     // Data interval that is covered by MESSAGE-INTEGRITY attribute (if any).
     Maybe<util::ConstBinaryView::Interval> integrity_interval;
+    // Result of STUN header check (see peek).
+    struct Peek {
+        Class cls;
+        Method method;
+        // Refers to the data passed to peek.
+        util::ConstBinaryView transaction_id;
+        IsRFC3489 is_rfc3489;
+    };
+    // Check only 20-byte STUN header: size of the message, padding,
+    // magic cookie. Attributes are not parsed and FINGERPRINT is
+    // not checked. Cheap way to find transaction before parsing.
+    static Result<Peek> peek(const util::ConstBinaryView&, ParseStat&);
     // Parse message from binary view
     static Result<Message> parse(const util::ConstBinaryView&, ParseStat&);
     // Check that MESSAGE-INTEGRITY is valid (if present).
@@ -46,6 +60,14 @@ struct Message {
 
     // Build message as bytes
     Result<util::ByteVec> build(const MaybeIntegrity& maybe_integrity = None{}) const noexcept;
+    // Size of the message produced by build
+    size_t build_size(const MaybeIntegrity& maybe_integrity = None{}) const noexcept;
+    // Build message into preallocated buffer (e.g. send buffer).
+    // Returns number of bytes written or BuildError::buffer_too_small.
+    Result<size_t> build_into(std::span<uint8_t>, const MaybeIntegrity& maybe_integrity = None{}) const noexcept;
+    // Build message as list of views that can be sent without
+    // final copy (see MessageGather).
+    MaybeError build_gather(MessageGather&, const MaybeIntegrity& maybe_integrity = None{}) const noexcept;
 
     // Check if message is alternate server response
     bool is_alternate_server() const noexcept;
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN message in scatter/gather form
+//
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "util/util_binary_view.hpp"
+
+namespace freewebrtc::stun {
+
+// Built STUN message as list of views (e.g. to be sent by sendmsg
+// with iovec per view). Encoded parts (header, attribute headers,
+// addresses, ...) are stored inside the object and long attribute
+// values (USERNAME, SOFTWARE, unknown attributes) refer to the
+// message that was built. So that message must outlive views.
+//
+// Object may be reused for subsequent messages. In that case
+// it does not allocate memory when new message is not bigger than
+// previous.
+class MessageGather {
+public:
+    const std::vector<util::ConstBinaryView>& views() const noexcept;
+    // Total size of the message
+    size_t size() const noexcept;
+    // Concatenate views to one buffer.
+    util::ByteVec concat() const;
+
+    // Builder interface (see AttributeSet::build_gather)
+    void reset(size_t max_encoded_size, size_t max_views);
+    // Allocate data for encoded part of the message
+    std::span<uint8_t> reserve(size_t);
+    // Add data that is referenced by the view
+    void borrow(const util::ConstBinaryView&);
+
+private:
+    util::ByteVec m_encoded;
+    size_t m_encoded_size = 0;
+    std::vector<util::ConstBinaryView> m_views;
+    bool m_last_is_encoded = false;
+    size_t m_size = 0;
+};
+
+//
+// inlines
+//
+inline const std::vector<util::ConstBinaryView>& MessageGather::views() const noexcept {
+    return m_views;
+}
+
+inline size_t MessageGather::size() const noexcept {
+    return m_size;
+}
+
+inline util::ByteVec MessageGather::concat() const {
+    return util::ConstBinaryView::concat(m_views);
+}
+
+inline void MessageGather::reset(size_t max_encoded_size, size_t max_views) {
+    // Views refer to m_encoded so it must not be reallocated
+    // after reset.
+    if (m_encoded.size() < max_encoded_size) {
+        m_encoded.resize(max_encoded_size);
+    }
+    m_views.clear();
+    m_views.reserve(max_views);
+    m_encoded_size = 0;
+    m_last_is_encoded = false;
+    m_size = 0;
+}
+
+inline std::span<uint8_t> MessageGather::reserve(size_t sz) {
+    uint8_t *start = m_encoded.data() + m_encoded_size;
+    if (m_last_is_encoded) {
+        // Extend last view instead of adding new one.
+        auto& last = m_views.back();
+        last = util::ConstBinaryView(last.data(), last.size() + sz);
+    } else {
+        m_views.emplace_back(start, sz);
+        m_last_is_encoded = true;
+    }
+    m_encoded_size += sz;
+    m_size += sz;
+    return std::span<uint8_t>(start, sz);
+}
+
+inline void MessageGather::borrow(const util::ConstBinaryView& vv) {
+    if (vv.size() == 0) {
+        return;
+    }
+    m_views.emplace_back(vv);
+    m_last_is_encoded = false;
+    m_size += vv.size();
+}
+
+}
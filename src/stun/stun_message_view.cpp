@@ -0,0 +1,330 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN Message view (lazy non-owning message)
+//
+
+#include "stun/stun_message_view.hpp"
+#include "stun/stun_error.hpp"
+#include "stun/details/stun_attr_registry.hpp"
+#include "stun/details/stun_constants.hpp"
+#include "stun/details/stun_fingerprint.hpp"
+#include "stun/details/stun_message_integrity.hpp"
+
+namespace freewebrtc::stun {
+
+namespace {
+
+// Check attribute value size (and address family) without decoding
+// the value. Conditions and statistics are the same as in parse
+// functions of the attributes.
+MaybeError check_attr_value(uint16_t type, const util::ConstBinaryView& v, ParseStat& stat) {
+    auto fail = [&](stat::Counter& counter, ParseError err) -> MaybeError {
+        stat.error.inc();
+        counter.inc();
+        return make_error_code(err);
+    };
+    auto address_size_valid = [&](uint8_t family) {
+        switch (family) {
+        case attr_registry::FAMILY_IPV4: return v.size() == 4 + net::ip::AddressV4::size();
+        case attr_registry::FAMILY_IPV6: return v.size() == 4 + net::ip::AddressV6::size();
+        }
+        return false;
+    };
+    switch (type) {
+    case attr_registry::MAPPED_ADDRESS:
+    case attr_registry::ALTERNATE_SERVER:
+        if (v.size() < 4) {
+            return fail(stat.invalid_mapped_address, ParseError::invalid_mapped_addr);
+        }
+        if (!address_size_valid(v.assured_read_u8(1))) {
+            return fail(stat.invalid_ip_address, ParseError::unknown_addr_family);
+        }
+        break;
+    case attr_registry::XOR_MAPPED_ADDRESS:
+        if (v.size() < 4) {
+            return fail(stat.invalid_xor_mapped_address, ParseError::invalid_xor_mapped_addr);
+        }
+        if (!address_size_valid(v.assured_read_u8(1))) {
+            return fail(stat.invalid_ip_address, ParseError::unknown_addr_family);
+        }
+        break;
+    case attr_registry::MESSAGE_INTEGRITY:
+        if (v.size() != crypto::SHA1Hash::size) {
+            return fail(stat.invalid_message_integrity, ParseError::integrity_digest_size);
+        }
+        break;
+    case attr_registry::FINGERPRINT:
+        if (v.size() < details::FINGERPRINT_CRC_SIZE) {
+            return fail(stat.invalid_fingerprint_size, ParseError::fingerprint_crc_size);
+        }
+        break;
+    case attr_registry::PRIORITY:
+        if (v.size() < sizeof(uint32_t)) {
+            return fail(stat.invalid_priority_size, ParseError::priority_attribute_size);
+        }
+        break;
+    case attr_registry::ICE_CONTROLLING:
+        if (v.size() < sizeof(uint64_t)) {
+            return fail(stat.invalid_ice_controlling_size, ParseError::ice_controlling_size);
+        }
+        break;
+    case attr_registry::ICE_CONTROLLED:
+        if (v.size() < sizeof(uint64_t)) {
+            return fail(stat.invalid_ice_controlled_size, ParseError::ice_controlled_size);
+        }
+        break;
+    case attr_registry::USE_CANDIDATE:
+        if (v.size() != 0) {
+            return fail(stat.invalid_use_candidate_size, ParseError::use_candidate_size);
+        }
+        break;
+    case attr_registry::ERROR_CODE:
+        if (v.size() < sizeof(uint32_t)) {
+            return fail(stat.invalid_error_code_size, ParseError::error_code_attribute_size);
+        }
+        break;
+    case attr_registry::UNKNOWN_ATTRIBUTES:
+        if (v.size() % 2 != 0) {
+            return fail(stat.invalid_unknown_attributes_attr_size, ParseError::unknown_attributes_attribute_size);
+        }
+        break;
+    }
+    return success();
+}
+
+size_t aligned_attr_length(uint16_t length) {
+    // Since STUN aligns attributes on 32-bit boundaries, attributes whose content
+    // is not a multiple of 4 bytes are padded with 1, 2, or 3 bytes of
+    // padding so that its value contains a multiple of 4 bytes.
+    return details::STUN_ATTR_HEADER_SIZE + ((length + 3) & ~size_t{3});
+}
+
+}
+
+MessageView::MessageView(const util::ConstBinaryView& data, uint16_t msg_type, IsRFC3489 is_rfc3489)
+    : m_data(data)
+    , m_msg_type(msg_type)
+    , m_is_rfc3489(is_rfc3489)
+{}
+
+Result<MessageView> MessageView::parse(const util::ConstBinaryView& vv, ParseStat& stat) {
+    using namespace details;
+    auto peek_rv = Message::peek(vv, stat);
+    if (peek_rv.is_err()) {
+        return peek_rv.unwrap_err();
+    }
+    const uint16_t msg_type = vv.assured_read_u16be(0);
+    const IsRFC3489 is_rfc3489 = peek_rv.unwrap().is_rfc3489;
+
+    MessageView view(vv, msg_type, is_rfc3489);
+    bool integrity_found = false;
+    size_t offset = STUN_HEADER_SIZE;
+    while (offset < vv.size()) {
+        if (vv.size() - offset < STUN_ATTR_HEADER_SIZE) {
+            stat.error.inc();
+            stat.invalid_attr_size.inc();
+            return make_error_code(ParseError::invalid_attr_size);
+        }
+        const uint16_t type = vv.assured_read_u16be(offset);
+        const uint16_t length = vv.assured_read_u16be(offset + 2);
+        if (vv.size() - offset - STUN_ATTR_HEADER_SIZE < length) {
+            stat.error.inc();
+            stat.invalid_attr_size.inc();
+            return make_error_code(ParseError::invalid_attr_size);
+        }
+        const auto aligned_length = aligned_attr_length(length);
+        if (type == attr_registry::FINGERPRINT && offset + aligned_length < vv.size()) {
+            // 15.5.  FINGERPRINT
+            // When present, the FINGERPRINT attribute MUST be the last attribute in
+            // the message, and thus will appear after MESSAGE-INTEGRITY.
+            stat.error.inc();
+            stat.fingerprint_not_last.inc();
+            return make_error_code(ParseError::fingerprint_is_not_last);
+        }
+        // With the exception of the FINGERPRINT attribute, which
+        // appears after MESSAGE-INTEGRITY, agents MUST ignore all
+        // other attributes that follow MESSAGE-INTEGRITY.
+        if (!integrity_found || type == attr_registry::FINGERPRINT) {
+            const auto value = vv.assured_subview(offset + STUN_ATTR_HEADER_SIZE, length);
+            if (auto check_rv = check_attr_value(type, value, stat); check_rv.is_err()) {
+                return check_rv.unwrap_err();
+            }
+            const auto maybe_slot = slot_of(type);
+            if (maybe_slot.is_some()) {
+                auto& slot_offset = view.m_offsets[maybe_slot.unwrap()];
+                if (slot_offset == 0) {
+                    slot_offset = offset;
+                }
+            } else if (AttributeType::from_uint16(type).is_comprehension_required()) {
+                view.m_has_unknown_comprehension_required = true;
+            }
+            integrity_found = integrity_found || type == attr_registry::MESSAGE_INTEGRITY;
+        }
+        offset += aligned_length;
+    }
+
+    if (const auto fp_offset = view.m_offsets[SLOT_FINGERPRINT]; fp_offset != 0) {
+        // The value of the attribute is computed as the CRC-32 of the STUN message
+        // up to (but excluding) the FINGERPRINT attribute itself, XOR'ed with
+        // the 32-bit value 0x5354554e.
+        const auto expected = vv.assured_read_u32be(fp_offset + STUN_ATTR_HEADER_SIZE) ^ FINGERPRINT_XOR;
+        if (crc32(vv.assured_subview(0, fp_offset)) != expected) {
+            stat.error.inc();
+            stat.invalid_fingerprint.inc();
+            return make_error_code(ParseError::fingerprint_not_valid);
+        }
+    }
+    stat.success.inc();
+    return view;
+}
+
+util::ConstBinaryView MessageView::transaction_id() const noexcept {
+    using namespace details;
+    return !m_is_rfc3489
+        ? m_data.assured_subview(8, TRANSACTION_ID_SIZE)
+        : m_data.assured_subview(4, TRANSACTION_ID_SIZE_RFC3489);
+}
+
+Maybe<util::ConstBinaryView::Interval> MessageView::integrity_interval() const noexcept {
+    if (const auto offset = m_offsets[SLOT_MESSAGE_INTEGRITY]; offset != 0) {
+        return util::ConstBinaryView::Interval{0, offset};
+    }
+    return none();
+}
+
+Result<Maybe<bool>> MessageView::is_valid(const IntegrityData& idata) const noexcept {
+    return is_valid(idata.password, idata.hash);
+}
+
+Result<Maybe<bool>> MessageView::is_valid(const Password& password, crypto::SHA1Hash::Func hash) const noexcept {
+    using MaybeBool = Maybe<bool>;
+    const auto offset = m_offsets[SLOT_MESSAGE_INTEGRITY];
+    if (offset == 0) {
+        return MaybeBool{none()};
+    }
+    const auto expected = m_data.assured_subview(offset + details::STUN_ATTR_HEADER_SIZE, crypto::SHA1Hash::size);
+    return details::integrity_digest(m_data, offset, password, hash)
+        .fmap([&](auto&& digest) {
+            return MaybeBool{util::ConstBinaryView(digest.value.value()) == expected};
+        });
+}
+
+Maybe<MessageIntegityAttribute::Digest> MessageView::integrity() const noexcept {
+    return decode<MessageIntegityAttribute>(SLOT_MESSAGE_INTEGRITY)
+        .fmap([](MessageIntegityAttribute&& attr) { return std::move(attr.digest); });
+}
+
+Maybe<std::string_view> MessageView::username() const noexcept {
+    return attr_value(SLOT_USERNAME)
+        .fmap([](const util::ConstBinaryView& v) {
+            return std::string_view(reinterpret_cast<const char *>(v.data()), v.size());
+        });
+}
+
+Maybe<std::string_view> MessageView::software() const noexcept {
+    return attr_value(SLOT_SOFTWARE)
+        .fmap([](const util::ConstBinaryView& v) {
+            return std::string_view(reinterpret_cast<const char *>(v.data()), v.size());
+        });
+}
+
+Maybe<XorMappedAddressAttribute> MessageView::xor_mapped() const noexcept {
+    return decode<XorMappedAddressAttribute>(SLOT_XOR_MAPPED_ADDRESS);
+}
+
+Maybe<MappedAddressAttribute> MessageView::mapped() const noexcept {
+    return decode<MappedAddressAttribute>(SLOT_MAPPED_ADDRESS);
+}
+
+Maybe<uint32_t> MessageView::priority() const noexcept {
+    return attr_value(SLOT_PRIORITY)
+        .fmap([](const util::ConstBinaryView& v) { return v.assured_read_u32be(0); });
+}
+
+Maybe<uint64_t> MessageView::ice_controlling() const noexcept {
+    return attr_value(SLOT_ICE_CONTROLLING)
+        .fmap([](const util::ConstBinaryView& v) { return v.assured_read_u64be(0); });
+}
+
+Maybe<uint64_t> MessageView::ice_controlled() const noexcept {
+    return attr_value(SLOT_ICE_CONTROLLED)
+        .fmap([](const util::ConstBinaryView& v) { return v.assured_read_u64be(0); });
+}
+
+Maybe<ErrorCodeAttribute> MessageView::error_code() const noexcept {
+    return decode<ErrorCodeAttribute>(SLOT_ERROR_CODE);
+}
+
+Maybe<UnknownAttributesAttribute> MessageView::unknown_attributes() const noexcept {
+    return decode<UnknownAttributesAttribute>(SLOT_UNKNOWN_ATTRIBUTES);
+}
+
+Maybe<AlternateServerAttribute> MessageView::alternate_server() const noexcept {
+    return decode<AlternateServerAttribute>(SLOT_ALTERNATE_SERVER);
+}
+
+std::vector<AttributeType> MessageView::unknown_comprehension_required() const noexcept {
+    using namespace details;
+    std::vector<AttributeType> result;
+    if (!m_has_unknown_comprehension_required) {
+        return result;
+    }
+    // Rare case: rescan attributes up to MESSAGE-INTEGRITY.
+    const auto integrity_offset = m_offsets[SLOT_MESSAGE_INTEGRITY];
+    const size_t end = integrity_offset != 0 ? integrity_offset : m_data.size();
+    for (size_t offset = STUN_HEADER_SIZE; offset < end; ) {
+        const auto type = AttributeType::from_uint16(m_data.assured_read_u16be(offset));
+        if (slot_of(type.value()).is_none() && type.is_comprehension_required()) {
+            result.emplace_back(type);
+        }
+        offset += aligned_attr_length(m_data.assured_read_u16be(offset + 2));
+    }
+    return result;
+}
+
+Maybe<MessageView::Slot> MessageView::slot_of(uint16_t attr_type) noexcept {
+    switch (attr_type) {
+    case attr_registry::MAPPED_ADDRESS:     return SLOT_MAPPED_ADDRESS;
+    case attr_registry::XOR_MAPPED_ADDRESS: return SLOT_XOR_MAPPED_ADDRESS;
+    case attr_registry::USERNAME:           return SLOT_USERNAME;
+    case attr_registry::SOFTWARE:           return SLOT_SOFTWARE;
+    case attr_registry::MESSAGE_INTEGRITY:  return SLOT_MESSAGE_INTEGRITY;
+    case attr_registry::FINGERPRINT:        return SLOT_FINGERPRINT;
+    case attr_registry::PRIORITY:           return SLOT_PRIORITY;
+    case attr_registry::ICE_CONTROLLING:    return SLOT_ICE_CONTROLLING;
+    case attr_registry::ICE_CONTROLLED:     return SLOT_ICE_CONTROLLED;
+    case attr_registry::USE_CANDIDATE:      return SLOT_USE_CANDIDATE;
+    case attr_registry::UNKNOWN_ATTRIBUTES: return SLOT_UNKNOWN_ATTRIBUTES;
+    case attr_registry::ERROR_CODE:         return SLOT_ERROR_CODE;
+    case attr_registry::ALTERNATE_SERVER:   return SLOT_ALTERNATE_SERVER;
+    }
+    return none();
+}
+
+Maybe<util::ConstBinaryView> MessageView::attr_value(Slot slot) const noexcept {
+    const auto offset = m_offsets[slot];
+    if (offset == 0) {
+        return none();
+    }
+    const auto length = m_data.assured_read_u16be(offset + 2);
+    return m_data.assured_subview(offset + details::STUN_ATTR_HEADER_SIZE, length);
+}
+
+template<typename Attr>
+Maybe<Attr> MessageView::decode(Slot slot) const noexcept {
+    return attr_value(slot)
+        .bind([](const util::ConstBinaryView& v) -> Maybe<Attr> {
+            // Sizes are checked in parse so statistics is not interesting here.
+            ParseStat stat;
+            auto attr_rv = Attr::parse(v, stat);
+            if (attr_rv.is_err()) {
+                return none();
+            }
+            return std::move(attr_rv.unwrap());
+        });
+}
+
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN Message view (lazy non-owning message)
+//
+
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include "util/util_binary_view.hpp"
+#include "util/util_result.hpp"
+#include "util/util_maybe.hpp"
+
+#include "stun/stun_message.hpp"
+#include "stun/stun_attribute.hpp"
+#include "stun/stun_parse_stat.hpp"
+#include "stun/stun_integrity.hpp"
+
+namespace freewebrtc::stun {
+
+// Non-owning view of STUN message over the datagram buffer.
+// Parsing checks the header, framing of the attributes and
+// FINGERPRINT and remembers offsets of known attributes.
+// Attributes are decoded only when accessor is called.
+//
+// MessageView does not allocate memory. It refers to the parsed
+// data so the data must outlive the view.
+class MessageView {
+public:
+    static Result<MessageView> parse(const util::ConstBinaryView&, ParseStat&);
+
+    Class cls() const noexcept;
+    Method method() const noexcept;
+    util::ConstBinaryView transaction_id() const noexcept;
+    IsRFC3489 is_rfc3489() const noexcept;
+    // Whole message data.
+    const util::ConstBinaryView& data() const noexcept;
+    // Data interval that is covered by MESSAGE-INTEGRITY attribute (if any).
+    Maybe<util::ConstBinaryView::Interval> integrity_interval() const noexcept;
+
+    // Same as Message::is_valid.
+    Result<Maybe<bool>> is_valid(const IntegrityData&) const noexcept;
+    Result<Maybe<bool>> is_valid(const Password&, crypto::SHA1Hash::Func) const noexcept;
+
+    // Accessors are the same as in AttributeSet but return
+    // decoded values instead of references. String attributes
+    // refer to the message data.
+    Maybe<MessageIntegityAttribute::Digest> integrity() const noexcept;
+    Maybe<std::string_view> username() const noexcept;
+    Maybe<std::string_view> software() const noexcept;
+    Maybe<XorMappedAddressAttribute> xor_mapped() const noexcept;
+    Maybe<MappedAddressAttribute> mapped() const noexcept;
+    Maybe<uint32_t> priority() const noexcept;
+    Maybe<uint64_t> ice_controlling() const noexcept;
+    Maybe<uint64_t> ice_controlled() const noexcept;
+    bool has_use_candidate() const noexcept;
+    Maybe<ErrorCodeAttribute> error_code() const noexcept;
+    Maybe<UnknownAttributesAttribute> unknown_attributes() const noexcept;
+    Maybe<AlternateServerAttribute> alternate_server() const noexcept;
+    // Return list of uknown comprehension-required attributes
+    std::vector<AttributeType> unknown_comprehension_required() const noexcept;
+    bool has_fingerprint() const noexcept;
+
+private:
+    // Slots of known attributes.
+    enum Slot : uint8_t {
+        SLOT_MAPPED_ADDRESS,
+        SLOT_XOR_MAPPED_ADDRESS,
+        SLOT_USERNAME,
+        SLOT_SOFTWARE,
+        SLOT_MESSAGE_INTEGRITY,
+        SLOT_FINGERPRINT,
+        SLOT_PRIORITY,
+        SLOT_ICE_CONTROLLING,
+        SLOT_ICE_CONTROLLED,
+        SLOT_USE_CANDIDATE,
+        SLOT_UNKNOWN_ATTRIBUTES,
+        SLOT_ERROR_CODE,
+        SLOT_ALTERNATE_SERVER,
+        NUM_SLOTS
+    };
+    static Maybe<Slot> slot_of(uint16_t attr_type) noexcept;
+
+    MessageView(const util::ConstBinaryView&, uint16_t msg_type, IsRFC3489);
+
+    Maybe<util::ConstBinaryView> attr_value(Slot) const noexcept;
+    template<typename Attr>
+    Maybe<Attr> decode(Slot) const noexcept;
+
+    util::ConstBinaryView m_data;
+    uint16_t m_msg_type;
+    IsRFC3489 m_is_rfc3489;
+    bool m_has_unknown_comprehension_required = false;
+    // Offset of attribute header in m_data. Zero means that
+    // attribute is not present (zero offset is message header).
+    std::array<uint32_t, NUM_SLOTS> m_offsets = {};
+};
+
+//
+// inlines
+//
+inline Class MessageView::cls() const noexcept {
+    return Class::from_msg_type(m_msg_type);
+}
+
+inline Method MessageView::method() const noexcept {
+    return Method::from_msg_type(m_msg_type);
+}
+
+inline IsRFC3489 MessageView::is_rfc3489() const noexcept {
+    return m_is_rfc3489;
+}
+
+inline const util::ConstBinaryView& MessageView::data() const noexcept {
+    return m_data;
+}
+
+inline bool MessageView::has_use_candidate() const noexcept {
+    return m_offsets[SLOT_USE_CANDIDATE] != 0;
+}
+
+inline bool MessageView::has_fingerprint() const noexcept {
+    return m_offsets[SLOT_FINGERPRINT] != 0;
+}
+
+}
@@ -34,6 +34,36 @@ struct ParseStat {
     stat::Counter invalid_error_code_size;
     stat::Counter invalid_unknown_attributes_attr_size;
     stat::Counter unknown_comprehension_required_attr;
+
+    // Add counters of other statistics (e.g. sum of shards)
+    void add(const ParseStat&) noexcept;
 };
 
+//
+// inlines
+//
+inline void ParseStat::add(const ParseStat& other) noexcept {
+    success.add(other.success.count());
+    error.add(other.error.count());
+    invalid_size.add(other.invalid_size.count());
+    not_padded.add(other.not_padded.count());
+    message_length_error.add(other.message_length_error.count());
+    magic_cookie_error.add(other.magic_cookie_error.count());
+    invalid_attr_size.add(other.invalid_attr_size.count());
+    fingerprint_not_last.add(other.fingerprint_not_last.count());
+    invalid_fingerprint.add(other.invalid_fingerprint.count());
+    invalid_fingerprint_size.add(other.invalid_fingerprint_size.count());
+    invalid_message_integrity.add(other.invalid_message_integrity.count());
+    invalid_mapped_address.add(other.invalid_mapped_address.count());
+    invalid_xor_mapped_address.add(other.invalid_xor_mapped_address.count());
+    invalid_ip_address.add(other.invalid_ip_address.count());
+    invalid_priority_size.add(other.invalid_priority_size.count());
+    invalid_ice_controlling_size.add(other.invalid_ice_controlling_size.count());
+    invalid_ice_controlled_size.add(other.invalid_ice_controlled_size.count());
+    invalid_use_candidate_size.add(other.invalid_use_candidate_size.count());
+    invalid_error_code_size.add(other.invalid_error_code_size.count());
+    invalid_unknown_attributes_attr_size.add(other.invalid_unknown_attributes_attr_size.count());
+    unknown_comprehension_required_attr.add(other.unknown_comprehension_required_attr.count());
+}
+
 }
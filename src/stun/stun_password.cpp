@@ -15,13 +15,25 @@ Result<Password> Password::short_term(const OpaqueString& password, crypto::SHA1
     auto ipad = crypto::hmac::IPadKey::from_key(util::ConstBinaryView(data), h);
     auto opad = crypto::hmac::OPadKey::from_key(util::ConstBinaryView(data), h);
     return combine([](crypto::hmac::IPadKey&& ipad, crypto::hmac::OPadKey&& opad) -> Result<Password> {
-        return Password(std::move(ipad), std::move(opad));
+        return Password(std::move(ipad), std::move(opad), none());
     }, std::move(ipad), std::move(opad));
 }
 
-Password::Password(crypto::hmac::IPadKey&& ipad, crypto::hmac::OPadKey&& opad)
+Result<Password> Password::short_term(const OpaqueString& password, crypto::SHA1Hash::Func h, const crypto::SHA1Resumable& sha1) {
+    return short_term(password, h)
+        .bind([&](Password&& p) {
+            return crypto::hmac::SHA1PrecomputedKey::from_pads(p.m_ipad, p.m_opad, sha1)
+                .fmap([&](crypto::hmac::SHA1PrecomputedKey&& key) {
+                    p.m_precomputed = std::move(key);
+                    return std::move(p);
+                });
+        });
+}
+
+Password::Password(crypto::hmac::IPadKey&& ipad, crypto::hmac::OPadKey&& opad, MaybePrecomputed&& precomputed)
     : m_ipad(std::move(ipad))
     , m_opad(std::move(opad))
+    , m_precomputed(std::move(precomputed))
 {}
 
 }
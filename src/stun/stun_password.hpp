@@ -16,8 +16,10 @@
 #include <vector>
 
 #include "util/util_result.hpp"
+#include "util/util_maybe.hpp"
 #include "crypto/crypto_hash.hpp"
 #include "crypto/crypto_hmac.hpp"
+#include "crypto/crypto_sha1_state.hpp"
 #include "precis/precis_opaque_string.hpp"
 
 namespace freewebrtc::stun {
@@ -27,22 +29,31 @@ public:
     Password(const Password&) = default;
     Password(Password&&) = default;
     Password& operator=(const Password&) = default;
-    bool operator==(const Password&) const noexcept = default;
+    bool operator==(const Password&) const noexcept;
 
     const crypto::hmac::IPadKey& ipad() const noexcept;
     const crypto::hmac::OPadKey& opad() const noexcept;
+    // SHA-1 states after ipad / opad if password is created
+    // with resumable SHA-1.
+    using MaybePrecomputed = Maybe<crypto::hmac::SHA1PrecomputedKey>;
+    const MaybePrecomputed& precomputed() const noexcept;
 
     using OpaqueString = precis::OpaqueString;
 
     static Result<Password> short_term(const OpaqueString& password, crypto::SHA1Hash::Func);
+    // Same as above but also caches SHA-1 states after ipad / opad
+    // blocks so each MESSAGE-INTEGRITY calculation hashes two
+    // blocks less.
+    static Result<Password> short_term(const OpaqueString& password, crypto::SHA1Hash::Func, const crypto::SHA1Resumable&);
     // TODO: Not implemented yet:
     // static Password long_term_md5(const OpaqueString& username, const OpaqueString& realm, const OpaqueString& password, crypto::MD5Hash::Func);
     // static Password long_term_sha256(const OpaqueString& username, const OpaqueString& realm, const OpaqueString& password, crypto::SHA256Hash::Func);
 
 private:
-    Password(crypto::hmac::IPadKey&&, crypto::hmac::OPadKey&&);
+    Password(crypto::hmac::IPadKey&&, crypto::hmac::OPadKey&&, MaybePrecomputed&&);
     crypto::hmac::IPadKey m_ipad;
     crypto::hmac::OPadKey m_opad;
+    MaybePrecomputed m_precomputed;
 };
 
 
@@ -57,4 +68,13 @@ inline const crypto::hmac::OPadKey& Password::opad() const noexcept {
     return m_opad;
 }
 
+inline const Password::MaybePrecomputed& Password::precomputed() const noexcept {
+    return m_precomputed;
+}
+
+inline bool Password::operator==(const Password& other) const noexcept {
+    // Precomputed states are derived from ipad / opad
+    return m_ipad == other.m_ipad && m_opad == other.m_opad;
+}
+
 }
@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN request template
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "stun/stun_request_template.hpp"
+#include "stun/stun_error.hpp"
+#include "stun/details/stun_attr_registry.hpp"
+#include "stun/details/stun_constants.hpp"
+#include "stun/details/stun_fingerprint.hpp"
+#include "stun/details/stun_message_integrity.hpp"
+
+namespace freewebrtc::stun {
+
+namespace {
+
+bool is_type(const Maybe<AttributeType>& maybe_type, const AttributeType& type) {
+    return maybe_type
+        .fmap([&](const AttributeType& t) { return t == type; })
+        .value_or(false);
+}
+
+}
+
+RequestTemplate::RequestTemplate(util::ByteVec&& data, const MaybeIntegrity& maybe_integrity)
+    : m_data(std::move(data))
+    , m_maybe_integrity(maybe_integrity)
+{}
+
+Result<RequestTemplate> RequestTemplate::create(const Message& msg,
+                                                const MaybeIntegrity& maybe_integrity,
+                                                const std::vector<AttributeType>& patchable) {
+    return msg.build(maybe_integrity)
+        .fmap([&](util::ByteVec&& data) {
+            RequestTemplate result(std::move(data), maybe_integrity);
+            auto& regions = result.m_regions;
+            const size_t tid_size = msg.header.transaction_id.view().size();
+            regions.push_back(Region{details::HEADER_SIZE - tid_size, tid_size, none()});
+            // Attributes of the built message are well-formed
+            // so they are walked without checks.
+            const util::ConstBinaryView view(result.m_data);
+            size_t offset = details::HEADER_SIZE;
+            while (offset + details::STUN_ATTR_HEADER_SIZE <= view.size()) {
+                const uint16_t type = view.assured_read_u16be(offset);
+                const uint16_t length = view.assured_read_u16be(offset + 2);
+                const size_t value_offset = offset + details::STUN_ATTR_HEADER_SIZE;
+                if (type == attr_registry::MESSAGE_INTEGRITY && maybe_integrity.is_some()) {
+                    result.m_maybe_integrity_offset = offset;
+                } else if (type == attr_registry::FINGERPRINT) {
+                    result.m_maybe_fingerprint_offset = offset;
+                } else {
+                    const auto attr_type = AttributeType::from_uint16(type);
+                    const bool is_patchable = std::find(patchable.begin(), patchable.end(), attr_type) != patchable.end();
+                    const bool is_first = std::none_of(regions.begin(), regions.end(),
+                                                       [&](const Region& r) { return is_type(r.maybe_type, attr_type); });
+                    if (is_patchable && is_first) {
+                        regions.push_back(Region{value_offset, length, attr_type});
+                    }
+                }
+                offset = value_offset + ((length + 3) & ~size_t{3});
+            }
+            return result;
+        });
+}
+
+Result<size_t> RequestTemplate::build_into(std::span<uint8_t> out,
+                                           const TransactionId& tid,
+                                           std::span<const Patch> patches) const noexcept {
+    if (out.size() < m_data.size()) {
+        return make_error_code(BuildError::buffer_too_small);
+    }
+    const auto tid_view = tid.view();
+    const Region& tid_region = m_regions.front();
+    if (tid_view.size() != tid_region.size) {
+        return make_error_code(BuildError::transaction_id_size_mismatch);
+    }
+    std::memcpy(out.data(), m_data.data(), m_data.size());
+    std::memcpy(out.data() + tid_region.offset, tid_view.data(), tid_view.size());
+    for (const auto& p: patches) {
+        const auto it = std::find_if(m_regions.begin(), m_regions.end(),
+                                     [&](const Region& r) { return is_type(r.maybe_type, p.type); });
+        if (it == m_regions.end()) {
+            return make_error_code(BuildError::attribute_is_not_patchable);
+        }
+        if (it->size != p.value.size()) {
+            return make_error_code(BuildError::patch_value_size_mismatch);
+        }
+        std::memcpy(out.data() + it->offset, p.value.data(), p.value.size());
+    }
+    const util::ConstBinaryView view(out.data(), m_data.size());
+    if (m_maybe_integrity_offset.is_some()) {
+        const size_t mi_offset = m_maybe_integrity_offset.unwrap();
+        auto maybe_digest = details::integrity_digest(view, mi_offset, m_maybe_integrity.unwrap());
+        if (maybe_digest.is_err()) {
+            return maybe_digest.unwrap_err();
+        }
+        const auto& digest = maybe_digest.unwrap().value.value();
+        std::copy(digest.begin(), digest.end(), out.begin() + mi_offset + details::STUN_ATTR_HEADER_SIZE);
+    }
+    m_maybe_fingerprint_offset
+        .with_inner([&](size_t fp_offset) {
+            // Incremental update of CRC by changed bytes only is
+            // slower than hardware accelerated CRC of the whole
+            // request of usual size.
+            const uint32_t fp = crc32(view.assured_subview(0, fp_offset)) ^ FINGERPRINT_XOR;
+            uint8_t *fp_value = out.data() + fp_offset + details::STUN_ATTR_HEADER_SIZE;
+            for (size_t i = 0; i < sizeof(fp); ++i) {
+                fp_value[i] = uint8_t(fp >> (8 * (sizeof(fp) - 1 - i)));
+            }
+        });
+    return m_data.size();
+}
+
+Result<util::ByteVec> RequestTemplate::build(const TransactionId& tid, std::span<const Patch> patches) const {
+    util::ByteVec result(m_data.size());
+    return build_into(result, tid, patches)
+        .fmap([&](size_t) {
+            return std::move(result);
+        });
+}
+
+}
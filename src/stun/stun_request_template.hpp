@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN request template
+//
+// Request that is serialized once and then is used to build many
+// requests that differ only by transaction id and values of some
+// attributes (e.g. PRIORITY or ICE-CONTROLLING of ICE connectivity
+// checks). Build copies the template, patches the changed bytes
+// and calculates MESSAGE-INTEGRITY (with precomputed key if password
+// has it) and FINGERPRINT without encoding of the attributes.
+//
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "util/util_binary_view.hpp"
+#include "util/util_result.hpp"
+#include "stun/stun_message.hpp"
+#include "stun/stun_attribute_type.hpp"
+#include "stun/stun_transaction_id.hpp"
+
+namespace freewebrtc::stun {
+
+class RequestTemplate {
+public:
+    // New value of the attribute. Size of the value must be the
+    // same as size of the value in the template.
+    struct Patch {
+        AttributeType type;
+        util::ConstBinaryView value;
+    };
+    // Serialize the message. Transaction id of the message defines
+    // size of transaction id of the requests only. Values of the
+    // attributes of patchable types may be changed on build.
+    static Result<RequestTemplate> create(const Message&,
+                                          const MaybeIntegrity&,
+                                          const std::vector<AttributeType>& patchable = {});
+
+    // Size of the built request
+    size_t size() const noexcept;
+    const MaybeIntegrity& integrity() const noexcept;
+
+    // Build request into the buffer. Returns number of bytes written
+    // or BuildError::buffer_too_small.
+    Result<size_t> build_into(std::span<uint8_t>,
+                              const TransactionId&,
+                              std::span<const Patch> = {}) const noexcept;
+    Result<util::ByteVec> build(const TransactionId&, std::span<const Patch> = {}) const;
+
+private:
+    // Bytes of the template that are changed on build
+    struct Region {
+        size_t offset;
+        size_t size;
+        // Attribute type of patchable attribute value
+        Maybe<AttributeType> maybe_type;
+    };
+    RequestTemplate(util::ByteVec&&, const MaybeIntegrity&);
+
+    util::ByteVec m_data;
+    // Transaction id followed by values of patchable attributes
+    std::vector<Region> m_regions;
+    MaybeIntegrity m_maybe_integrity;
+    Maybe<size_t> m_maybe_integrity_offset = None{};
+    Maybe<size_t> m_maybe_fingerprint_offset = None{};
+};
+
+//
+// inlines
+//
+inline size_t RequestTemplate::size() const noexcept {
+    return m_data.size();
+}
+
+inline const MaybeIntegrity& RequestTemplate::integrity() const noexcept {
+    return m_maybe_integrity;
+}
+
+}
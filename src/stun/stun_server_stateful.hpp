@@ -0,0 +1,266 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN Stateful server implementation
+//
+// Server on top of Stateless that remembers built responses
+// for the transaction lifetime (RFC 8489 recommends 40 seconds
+// for UDP). Retransmitted requests are answered from the cache
+// without parse, MESSAGE-INTEGRITY check and build.
+//
+
+#pragma once
+
+#include <unordered_map>
+
+#include "util/util_intrusive_list.hpp"
+#include "stun/stun_server_stateless.hpp"
+#include "stun/stun_transaction_id_hash.hpp"
+#include "crypto/builtin/builtin_hash.hpp"
+#include "stat/stat_counter.hpp"
+
+namespace freewebrtc::stun::server {
+
+template<typename Clock>
+class Stateful {
+public:
+    using TimePoint = typename Clock::time_point;
+    using Duration = typename Clock::duration;
+    struct Settings {
+        // How long response is kept for retransmissions
+        Duration transaction_lifetime;
+        TransactionIdHash tid_hash;
+        // Hard limit of memory used by cached responses. If the
+        // limit is reached then the oldest responses are dropped.
+        size_t max_cache_size = 4 * 1024 * 1024;
+    };
+    explicit Stateful(const Settings&,
+                      crypto::SHA1Hash::Func = crypto::builtin::sha1,
+                      const Maybe<Stateless::Settings>& = None{});
+    // Intrusive links cannot be moved
+    Stateful(const Stateful&) = delete;
+    Stateful(Stateful&&) = delete;
+
+    struct Respond {
+        // Built response. Refers to the data inside of the server
+        // and valid until next call of process / expire.
+        util::ConstBinaryView response;
+        // Response is sent for retransmitted request.
+        bool retransmit;
+    };
+    using Ignore = Stateless::Ignore;
+    using Error = Stateless::Error;
+    using ProcessResult = std::variant<Respond, Ignore, Error>;
+
+    ProcessResult process(TimePoint now, const net::Endpoint&, const util::ConstBinaryView&);
+    // Drop responses that are expired. It is done by process as
+    // well so it is only needed to release memory when there is no
+    // incoming requests.
+    void expire(TimePoint now);
+
+    void add_user(const precis::OpaqueString& name, const stun::Password&);
+    // Responses of the user that are already cached are not dropped
+    void remove_user(const precis::OpaqueString& name);
+    void update_users(Stateless::Users&& adds, std::span<const precis::OpaqueString> removes);
+    void replace_users(Stateless::Users&&);
+
+    struct Statistics {
+        stat::Counter cache_hit;
+        stat::Counter cache_miss;
+        // Transaction id is in the cache but request is received
+        // from another endpoint.
+        stat::Counter endpoint_mismatch;
+        stat::Counter expired;
+        stat::Counter evicted;
+        stat::Counter not_cached;
+    };
+    const Statistics& stat() const noexcept;
+    // Number of cached responses and memory used by them
+    size_t cache_count() const noexcept;
+    size_t cache_size() const noexcept;
+
+private:
+    struct Entry {
+        Entry(const TransactionId&, const net::Endpoint&, util::ByteVec&&, TimePoint expires);
+        TransactionId tid;
+        net::Endpoint endpoint;
+        util::ByteVec response;
+        TimePoint expires;
+        typename util::IntrusiveList<Entry>::Link link;
+    };
+    using Cache = std::unordered_map<TransactionId, Entry, TransactionIdHash>;
+    static size_t entry_size(const util::ByteVec& response) noexcept;
+    Respond store(TimePoint now, const net::Endpoint&, Maybe<TransactionId>&&, util::ByteVec&&);
+    void evict_oldest();
+
+    const Settings m_settings;
+    Stateless m_stateless;
+    Statistics m_stat;
+    Cache m_cache;
+    // Entries in order of insertion. All entries have the same
+    // lifetime so it is also order of expiration.
+    util::IntrusiveList<Entry> m_expiration;
+    size_t m_cache_size = 0;
+    // Response that is not stored in the cache
+    util::ByteVec m_uncached;
+};
+
+//
+// implementation
+//
+template<typename Clock>
+Stateful<Clock>::Entry::Entry(const TransactionId& id, const net::Endpoint& ep, util::ByteVec&& rsp, TimePoint exp)
+    : tid(id)
+    , endpoint(ep)
+    , response(std::move(rsp))
+    , expires(exp)
+    , link(*this)
+{}
+
+template<typename Clock>
+Stateful<Clock>::Stateful(const Settings& settings, crypto::SHA1Hash::Func sha1, const Maybe<Stateless::Settings>& stateless_settings)
+    : m_settings(settings)
+    , m_stateless(sha1, stateless_settings)
+    , m_cache(0, m_settings.tid_hash)
+    , m_expiration(&Entry::link)
+{}
+
+template<typename Clock>
+typename Stateful<Clock>::ProcessResult
+Stateful<Clock>::process(TimePoint now, const net::Endpoint& ep, const util::ConstBinaryView& view) {
+    expire(now);
+    // Find response by the STUN header only. Errors of the header are
+    // accounted by stateless server below.
+    ParseStat peek_stat;
+    auto maybe_tid = Message::peek(view, peek_stat)
+        .fmap([](auto&& peek) -> Maybe<TransactionId> {
+            if (peek.cls != Class::request()) {
+                return none();
+            }
+            return TransactionId(peek.transaction_id);
+        })
+        .unwrap_or(none());
+    const auto maybe_cached = maybe_tid
+        .bind([&](const TransactionId& tid) -> Maybe<util::ConstBinaryView> {
+            const auto it = m_cache.find(tid);
+            if (it == m_cache.end()) {
+                m_stat.cache_miss.inc();
+                return none();
+            }
+            if (it->second.endpoint != ep) {
+                m_stat.endpoint_mismatch.inc();
+                return none();
+            }
+            m_stat.cache_hit.inc();
+            return util::ConstBinaryView(it->second.response);
+        });
+    if (maybe_cached.is_some()) {
+        return Respond{maybe_cached.unwrap(), true};
+    }
+    return std::visit(
+        util::overloaded {
+            [&](Stateless::Respond&& r) -> ProcessResult {
+                return r.response.build(r.maybe_integrity)
+                    .fmap([&](util::ByteVec&& data) -> ProcessResult {
+                        return store(now, ep, std::move(maybe_tid), std::move(data));
+                    })
+                    .bind_err([](auto&& err) -> Result<ProcessResult> {
+                        return Result<ProcessResult>{Error{std::move(err)}};
+                    })
+                    .unwrap_or(Ignore{.message = none()});
+            },
+            [](auto&& v) -> ProcessResult { return std::move(v); }
+        },
+        m_stateless.process(ep, view));
+}
+
+template<typename Clock>
+void Stateful<Clock>::expire(TimePoint now) {
+    while (true) {
+        const auto maybe_oldest = m_expiration.front();
+        if (maybe_oldest.is_none() || maybe_oldest.unwrap().get().expires > now) {
+            return;
+        }
+        m_stat.expired.inc();
+        evict_oldest();
+    }
+}
+
+template<typename Clock>
+void Stateful<Clock>::add_user(const precis::OpaqueString& name, const stun::Password& password) {
+    m_stateless.add_user(name, password);
+}
+
+template<typename Clock>
+void Stateful<Clock>::remove_user(const precis::OpaqueString& name) {
+    m_stateless.remove_user(name);
+}
+
+template<typename Clock>
+void Stateful<Clock>::update_users(Stateless::Users&& adds, std::span<const precis::OpaqueString> removes) {
+    m_stateless.update_users(std::move(adds), removes);
+}
+
+template<typename Clock>
+void Stateful<Clock>::replace_users(Stateless::Users&& users) {
+    m_stateless.replace_users(std::move(users));
+}
+
+template<typename Clock>
+const typename Stateful<Clock>::Statistics& Stateful<Clock>::stat() const noexcept {
+    return m_stat;
+}
+
+template<typename Clock>
+size_t Stateful<Clock>::cache_count() const noexcept {
+    return m_cache.size();
+}
+
+template<typename Clock>
+size_t Stateful<Clock>::cache_size() const noexcept {
+    return m_cache_size;
+}
+
+template<typename Clock>
+size_t Stateful<Clock>::entry_size(const util::ByteVec& response) noexcept {
+    // Approximation of the hash table node size
+    return sizeof(typename Cache::value_type) + sizeof(void *) + response.capacity();
+}
+
+template<typename Clock>
+typename Stateful<Clock>::Respond
+Stateful<Clock>::store(TimePoint now, const net::Endpoint& ep, Maybe<TransactionId>&& maybe_tid, util::ByteVec&& data) {
+    const size_t size = entry_size(data);
+    if (maybe_tid.is_none() || size > m_settings.max_cache_size || m_cache.contains(maybe_tid.value())) {
+        // Response cannot be cached or the same transaction id is
+        // already used by another endpoint. Keep cached one.
+        m_stat.not_cached.inc();
+        m_uncached = std::move(data);
+        return Respond{util::ConstBinaryView(m_uncached), false};
+    }
+    while (m_cache_size + size > m_settings.max_cache_size) {
+        m_stat.evicted.inc();
+        evict_oldest();
+    }
+    const auto& tid = maybe_tid.value();
+    auto [it, _] = m_cache.try_emplace(tid, tid, ep, std::move(data), now + m_settings.transaction_lifetime);
+    Entry& entry = it->second;
+    m_expiration.push_back(entry);
+    m_cache_size += size;
+    return Respond{util::ConstBinaryView(entry.response), false};
+}
+
+template<typename Clock>
+void Stateful<Clock>::evict_oldest() {
+    m_expiration.front()
+        .with_inner([&](Entry& entry) {
+            m_cache_size -= entry_size(entry.response);
+            const TransactionId tid = entry.tid;
+            // Link is removed from the list by destructor of the entry.
+            m_cache.erase(tid);
+        });
+}
+
+}
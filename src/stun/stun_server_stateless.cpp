@@ -6,7 +6,19 @@
 // STUN Stateless server implementation
 //
 
+#include <array>
+#include <cstring>
+#include <numeric>
+
 #include "stun/stun_server_stateless.hpp"
+#include "stun/stun_integrity_batch.hpp"
+#include "stun/stun_message_view.hpp"
+#include "stun/stun_error.hpp"
+#include "stun/details/stun_attr_registry.hpp"
+#include "stun/details/stun_constants.hpp"
+#include "stun/details/stun_fingerprint.hpp"
+#include "stun/details/stun_message_integrity.hpp"
+#include "util/util_endian.hpp"
 #include "util/util_variant_overloaded.hpp"
 
 namespace freewebrtc::stun::server {
@@ -39,6 +51,79 @@ Message create_error(const Message& msg, ErrorCodeAttribute::Code error, MaybeSt
     };
 }
 
+size_t attr_size(size_t value_size) {
+    return details::STUN_ATTR_HEADER_SIZE + ((value_size + 3) & ~size_t{3});
+}
+
+// Writer of the response directly to the output buffer. Size of
+// the response is calculated in advance so buffer is checked once.
+class ResponseWriter {
+public:
+    static Result<ResponseWriter> create(std::span<uint8_t> out, size_t size) {
+        if (out.size() < size) {
+            return make_error_code(BuildError::buffer_too_small);
+        }
+        return ResponseWriter(out.first(size));
+    }
+    // Transaction id (and magic cookie) is copied from the request
+    void header(Class cls, const MessageView& request) {
+        const uint16_t msg_type = util::host_to_network_u16(cls.to_msg_type() | request.method().to_msg_type());
+        const uint16_t msg_size = util::host_to_network_u16(m_out.size() - details::STUN_HEADER_SIZE);
+        memcpy(m_out.data(), &msg_type, sizeof(msg_type));
+        memcpy(m_out.data() + 2, &msg_size, sizeof(msg_size));
+        const auto tid = request.data().assured_subview(4, details::STUN_HEADER_SIZE - 4);
+        std::copy(tid.begin(), tid.end(), m_out.begin() + 4);
+        m_pos = details::STUN_HEADER_SIZE;
+    }
+    template<typename Encode>
+    void attr(uint16_t type, size_t length, Encode&& encode) {
+        auto out = m_out.subspan(m_pos, attr_size(length));
+        const uint32_t hdr = util::host_to_network_u32((uint32_t(type) << 16) | length);
+        memcpy(out.data(), &hdr, sizeof(hdr));
+        auto value = out.subspan(details::STUN_ATTR_HEADER_SIZE);
+        encode(value.first(length));
+        std::fill(value.begin() + length, value.end(), 0);
+        m_pos += out.size();
+    }
+    template<typename Attr>
+    void attr(uint16_t type, const Attr& a) {
+        attr(type, a.value_size(), [&](auto out) { a.build_into(out); });
+    }
+    util::ConstBinaryView written() const noexcept {
+        return util::ConstBinaryView(m_out.data(), m_pos);
+    }
+    size_t size() const noexcept {
+        return m_out.size();
+    }
+private:
+    explicit ResponseWriter(std::span<uint8_t> out)
+        : m_out(out)
+    {}
+    std::span<uint8_t> m_out;
+    size_t m_pos = 0;
+};
+
+using MaybeSize = Maybe<size_t>;
+
+// Same response as create_error
+Result<MaybeSize> write_error(const MessageView& request, ErrorCodeAttribute::Code code,
+                              const Maybe<UnknownAttributesAttribute>& maybe_unknown, std::span<uint8_t> out) {
+    const ErrorCodeAttribute error{code, none()};
+    const size_t size = details::STUN_HEADER_SIZE
+        + attr_size(error.value_size())
+        + maybe_unknown.fmap([](const auto& a) { return attr_size(a.value_size()); }).value_or(0);
+    return ResponseWriter::create(out, size)
+        .fmap([&](ResponseWriter&& w) {
+            w.header(Class::error_response(), request);
+            // Order of the attributes is the same as in AttributeSet
+            maybe_unknown.with_inner([&](const UnknownAttributesAttribute& a) {
+                w.attr(attr_registry::UNKNOWN_ATTRIBUTES, a);
+            });
+            w.attr(attr_registry::ERROR_CODE, error);
+            return MaybeSize{w.size()};
+        });
+}
+
 }
 
 Stateless::Stateless(crypto::SHA1Hash::Func sha1, const Maybe<Settings>& maybe_settings)
@@ -47,21 +132,237 @@ Stateless::Stateless(crypto::SHA1Hash::Func sha1, const Maybe<Settings>& maybe_s
 {}
 
 Stateless::ProcessResult Stateless::process(const net::Endpoint& ep, const util::ConstBinaryView& view) {
-    return stun::Message::parse(view, m_stat)
+    const auto users = m_users.read();
+    return process_message(users, ep, stun::Message::parse(view, m_stat.local()), view, none());
+}
+
+std::vector<Stateless::ProcessResult> Stateless::process_batch(std::span<const Packet> packets) {
+    // Passwords of the checks are valid while reader exists
+    const auto users = m_users.read();
+    std::vector<Result<MessageView>> views;
+    views.reserve(packets.size());
+    auto& stat = m_stat.local();
+    for (const auto& p: packets) {
+        views.emplace_back(MessageView::parse(p.data, stat));
+    }
+    // Index of integrity check for each message
+    std::vector<Maybe<size_t>> check_index(packets.size(), none());
+    std::vector<IntegrityCheck> checks;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        views[i]
+            .fmap([&](const MessageView& view) {
+                return request_password(users, view)
+                    .fmap([&](const Password& password) {
+                        check_index[i] = checks.size();
+                        checks.emplace_back(IntegrityCheck{view, password});
+                        return success();
+                    });
+            });
+    }
+    auto valid = is_valid_batch(checks, m_sha1);
+
+    std::vector<ProcessResult> result;
+    result.reserve(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (views[i].is_err() || views[i].unwrap().cls() != Class::request()) {
+            // Not answered so there is no need in complete parse
+            result.emplace_back(Ignore{none()});
+            continue;
+        }
+        MaybeValid maybe_valid = check_index[i].fmap([&](size_t index) {
+            return std::move(valid[index]);
+        });
+        // Statistics is already counted by MessageView::parse
+        ParseStat request_stat;
+        auto message_rv = stun::Message::parse(packets[i].data, request_stat);
+        result.emplace_back(process_message(users, packets[i].endpoint, std::move(message_rv), packets[i].data, std::move(maybe_valid)));
+    }
+    return result;
+}
+
+Result<Maybe<size_t>> Stateless::process_into(const net::Endpoint& ep, const util::ConstBinaryView& view, std::span<uint8_t> out) {
+    // Same checks as in process_request
+    auto request_rv = MessageView::parse(view, m_stat.local());
+    if (request_rv.is_err() || request_rv.unwrap().cls() != Class::request()) {
+        return MaybeSize{none()};
+    }
+    const auto& request = request_rv.unwrap();
+    auto unknown_comprehension_required = request.unknown_comprehension_required();
+    if (!unknown_comprehension_required.empty()) {
+        return write_error(request, ErrorCodeAttribute::Code::UnknownAttribute,
+                           UnknownAttributesAttribute{std::move(unknown_comprehension_required)}, out);
+    }
+    const auto maybe_username = request.username();
+    if (maybe_username.is_some() != request.integrity_interval().is_some()) {
+        return write_error(request, ErrorCodeAttribute::Code::BadRequest, none(), out);
+    }
+    const auto users = m_users.read();
+    MaybePassword maybe_password = none();
+    if (maybe_username.is_some()) {
+        // Lookup by view of the username without copy
+        const auto maybe_user_password = find_password(users, maybe_username.unwrap());
+        if (maybe_user_password.is_none()) {
+            return write_error(request, ErrorCodeAttribute::Code::Unauthorized, none(), out);
+        }
+        const Password& password = maybe_user_password.unwrap();
+        auto valid_rv = request.is_valid(password, m_sha1);
+        if (valid_rv.is_err()) {
+            return valid_rv.unwrap_err();
+        }
+        const auto maybe_valid = valid_rv.unwrap();
+        if (maybe_valid.is_some()) {
+            if (!maybe_valid.unwrap()) {
+                return write_error(request, ErrorCodeAttribute::Code::Unauthorized, none(), out);
+            }
+            maybe_password = std::cref(password);
+        }
+    }
+    if (request.method() != Method::binding()) {
+        return MaybeSize{none()};
+    }
+
+    const bool use_fingerprint = !request.is_rfc3489() && m_settings.use_fingerprint;
+    using AddressAttr = std::variant<XorMappedAddressAttribute, MappedAddressAttribute>;
+    const AddressAttr address = !request.is_rfc3489()
+        ? AddressAttr{XorMappedAddressAttribute{XoredAddress::from_address(ep.address(), TransactionId(request.transaction_id())), ep.port()}}
+        // RFC 3489 client: MAPPED-ADDRESS (see process_request)
+        : AddressAttr{MappedAddressAttribute{ep.address(), ep.port()}};
+    const size_t size = details::STUN_HEADER_SIZE
+        + std::visit([](const auto& a) { return attr_size(a.value_size()); }, address)
+        + (maybe_password.is_some() ? attr_size(crypto::SHA1Hash::size) : 0)
+        + (use_fingerprint ? attr_size(details::FINGERPRINT_CRC_SIZE) : 0);
+    return ResponseWriter::create(out, size)
+        .bind([&](ResponseWriter&& w) -> Result<MaybeSize> {
+            w.header(Class::success_response(), request);
+            std::visit(
+                util::overloaded {
+                    [&](const XorMappedAddressAttribute& a) { w.attr(attr_registry::XOR_MAPPED_ADDRESS, a); },
+                    [&](const MappedAddressAttribute& a) { w.attr(attr_registry::MAPPED_ADDRESS, a); }
+                },
+                address);
+            if (maybe_password.is_some()) {
+                const auto written = w.written();
+                auto digest_rv = details::integrity_digest(written, written.size(), maybe_password.unwrap(), m_sha1);
+                if (digest_rv.is_err()) {
+                    return digest_rv.unwrap_err();
+                }
+                const auto& digest = digest_rv.unwrap().value.value();
+                w.attr(attr_registry::MESSAGE_INTEGRITY, digest.size(), [&](auto out) {
+                    std::copy(digest.begin(), digest.end(), out.begin());
+                });
+            }
+            if (use_fingerprint) {
+                const uint32_t fp = util::host_to_network_u32(crc32(w.written()) ^ FINGERPRINT_XOR);
+                w.attr(attr_registry::FINGERPRINT, sizeof(fp), [&](auto out) {
+                    memcpy(out.data(), &fp, sizeof(fp));
+                });
+            }
+            return MaybeSize{w.size()};
+        });
+}
+
+void Stateless::add_user(const precis::OpaqueString& name, const stun::Password& password) {
+    const size_t shard = users_shard(name.value);
+    m_users.update(std::span(&shard, 1), [&](size_t, const Users& users) {
+        Users result = users;
+        result.emplace(name, password);
+        return result;
+    });
+}
+
+void Stateless::remove_user(const precis::OpaqueString& name) {
+    const size_t shard = users_shard(name.value);
+    m_users.update(std::span(&shard, 1), [&](size_t, const Users& users) {
+        Users result = users;
+        result.erase(name);
+        return result;
+    });
+}
+
+void Stateless::update_users(Users&& adds, std::span<const precis::OpaqueString> removes) {
+    std::array<Users, USERS_SHARDS> shard_adds;
+    std::array<std::vector<std::reference_wrapper<const precis::OpaqueString>>, USERS_SHARDS> shard_removes;
+    for (const auto& name: removes) {
+        shard_removes[users_shard(name.value)].emplace_back(name);
+    }
+    for (auto& [name, password]: adds) {
+        shard_adds[users_shard(name.value)].emplace(name, std::move(password));
+    }
+    std::vector<size_t> shards;
+    for (size_t i = 0; i < USERS_SHARDS; ++i) {
+        if (!shard_adds[i].empty() || !shard_removes[i].empty()) {
+            shards.emplace_back(i);
+        }
+    }
+    m_users.update(shards, [&](size_t shard, const Users& users) {
+        Users result = users;
+        for (const precis::OpaqueString& name: shard_removes[shard]) {
+            result.erase(name);
+        }
+        for (auto& [name, password]: shard_adds[shard]) {
+            result.emplace(name, std::move(password));
+        }
+        return result;
+    });
+}
+
+void Stateless::replace_users(Users&& users) {
+    std::array<Users, USERS_SHARDS> split;
+    for (auto& [name, password]: users) {
+        split[users_shard(name.value)].emplace(name, std::move(password));
+    }
+    std::array<size_t, USERS_SHARDS> shards;
+    std::iota(shards.begin(), shards.end(), 0);
+    m_users.update(shards, [&](size_t shard, const Users&) {
+        return std::move(split[shard]);
+    });
+}
+
+ParseStat Stateless::parse_stat() const {
+    return m_stat.sum([](ParseStat& sum, const ParseStat& shard) {
+        sum.add(shard);
+    });
+}
+
+size_t Stateless::users_shard(std::string_view name) noexcept {
+    return precis::OpaqueStringHash{}(name) % USERS_SHARDS;
+}
+
+Stateless::MaybePassword Stateless::find_password(const UsersReader& reader, std::string_view name) {
+    const auto& users = reader[users_shard(name)];
+    const auto it = users.find(name);
+    if (it == users.end()) {
+        return none();
+    }
+    return std::cref(it->second);
+}
+
+Stateless::ProcessResult Stateless::process_message(const UsersReader& users, const net::Endpoint& ep, Result<Message>&& msg_rv, const util::ConstBinaryView& view, MaybeValid&& maybe_valid) {
+    return std::move(msg_rv)
         .fmap([&](auto&& msg) -> ProcessResult {
             if (msg.header.cls == stun::Class::request()) {
-                return process_request(ep, std::move(msg), view);
+                return process_request(users, ep, std::move(msg), view, std::move(maybe_valid));
             }
             return Ignore{ .message = std::move(msg) };
         })
         .unwrap_or(Ignore{ .message = none() });
 }
 
-void Stateless::add_user(const precis::OpaqueString& name, const stun::Password& password) {
-    m_users.emplace(name, password);
+Stateless::MaybePassword Stateless::request_password(const UsersReader& users, const MessageView& view) {
+    // Same conditions as in process_request before the check of
+    // MESSAGE-INTEGRITY.
+    if (view.cls() != stun::Class::request()
+        || !view.unknown_comprehension_required().empty()
+        || view.integrity_interval().is_none()) {
+        return none();
+    }
+    return view.username()
+        .bind([&](std::string_view username) {
+            return find_password(users, username);
+        });
 }
 
-Stateless::ProcessResult Stateless::process_request(const net::Endpoint& ep, Message&& msg, const util::ConstBinaryView& view) {
+Stateless::ProcessResult Stateless::process_request(const UsersReader& users, const net::Endpoint& ep, Message&& msg, const util::ConstBinaryView& view, MaybeValid&& maybe_valid) {
     // RFC 5389: 7.3.1. Processing a Request
     // If the request contains one or more unknown comprehension-required
     // attributes, the server replies with an error response with an error
@@ -90,9 +391,9 @@ Stateless::ProcessResult Stateless::process_request(const net::Endpoint& ep, Mes
 
     MaybeIntegrity maybe_integrity_data = none();
     using R = Stateless::ProcessResult;
-    auto check_auth = [&](auto&& username) -> Maybe<R> {
-        const auto user_password_pair_it = m_users.find(username);
-        if (user_password_pair_it == m_users.end()) {
+    auto check_auth = [&](const precis::OpaqueString& username) -> Maybe<R> {
+        const auto maybe_password = find_password(users, username.value);
+        if (maybe_password.is_none()) {
             // If the USERNAME does not contain a username value currently valid
             // within the server:
             //
@@ -109,9 +410,10 @@ Stateless::ProcessResult Stateless::process_request(const net::Endpoint& ep, Mes
         // *  If the message is a request, the server MUST reject the request
         //    with an error response.  This response MUST use an error code
         //    of 401 (Unauthorized).
-        IntegrityData idata{user_password_pair_it->second, m_sha1};
-        return msg.is_valid(view, idata).fmap(
-            [&](Maybe<bool> maybe_is_valid) -> Maybe<R> {
+        IntegrityData idata{maybe_password.unwrap(), m_sha1};
+        return std::move(maybe_valid)
+            .value_or_call([&] { return msg.is_valid(view, idata); })
+            .fmap([&](Maybe<bool> maybe_is_valid) -> Maybe<R> {
                 return maybe_is_valid
                     .bind([&](bool is_valid) -> Maybe<R> {
                         if (!is_valid) {
@@ -120,9 +422,11 @@ Stateless::ProcessResult Stateless::process_request(const net::Endpoint& ep, Mes
                         maybe_integrity_data = std::move(idata);
                         return none();
                     });
-            }).bind_err([&](auto&& err) -> Result<Maybe<R>> {
+            })
+            .bind_err([&](auto&& err) -> Result<Maybe<R>> {
                 return Result<Maybe<R>>{R{Error{std::move(err)}}};
-            }).unwrap_or(none());
+            })
+            .unwrap_or(none());
     };
 
     return maybe_username
@@ -8,9 +8,16 @@
 
 #pragma once
 
+#include <span>
+#include <string_view>
+#include <vector>
+
 #include "util/util_maybe.hpp"
 #include "util/util_error.hpp"
+#include "util/util_rcu.hpp"
+#include "stat/stat_sharded.hpp"
 #include "stun/stun_message.hpp"
+#include "stun/stun_message_view.hpp"
 #include "stun/stun_integrity.hpp"
 #include "net/net_endpoint.hpp"
 #include "precis/precis_opaque_string_hash.hpp"
@@ -38,17 +45,67 @@ public:
     };
     using ProcessResult = std::variant<Respond, Ignore, Error>;
 
+    // Process and process_batch may be called by many threads
+    // at once.
     ProcessResult process(const net::Endpoint&, const util::ConstBinaryView&);
+
+    struct Packet {
+        net::Endpoint endpoint;
+        util::ConstBinaryView data;
+    };
+    // Process many packets at once (e.g. received in one burst).
+    // Packets are parsed to MessageView and only requests are
+    // parsed to Message, so Ignore::message is none for other
+    // messages. MESSAGE-INTEGRITY of requests is checked in batch
+    // (see stun::is_valid_batch). Results are in order of packets.
+    std::vector<ProcessResult> process_batch(std::span<const Packet>);
+
+    // Same as process but response is written directly to the
+    // buffer (e.g. send buffer): request is not copied to Message
+    // and response is built without intermediate objects. Returns
+    // size of the response, none if request is ignored or error
+    // (e.g. BuildError::buffer_too_small).
+    Result<Maybe<size_t>> process_into(const net::Endpoint&, const util::ConstBinaryView&, std::span<uint8_t> out);
+
+    // Users may be changed by any thread while requests are
+    // processed. Processing is not blocked; change returns when
+    // requests that use previous users are processed. Users are
+    // spread over shards and change copies only shards of changed
+    // users. Use update_users for many changes at once: each shard
+    // is copied once and change waits for requests once.
+    using Users = std::unordered_map<precis::OpaqueString, stun::Password, precis::OpaqueStringHash, precis::OpaqueStringEqual>;
     void add_user(const precis::OpaqueString& name, const stun::Password&);
+    void remove_user(const precis::OpaqueString& name);
+    // Removes are applied before adds so password of existing
+    // user may be changed by remove and add.
+    void update_users(Users&& adds, std::span<const precis::OpaqueString> removes);
+    void replace_users(Users&&);
+
+    // Parse statistics of all threads
+    ParseStat parse_stat() const;
 
 private:
-    ProcessResult process_request(const net::Endpoint&, Message&&, const util::ConstBinaryView&);
+    // Result of MESSAGE-INTEGRITY check if it is done in advance
+    using MaybeValid = Maybe<Result<Maybe<bool>>>;
+    // Users by hash of the name
+    static constexpr size_t USERS_SHARDS = 64;
+    using UsersShards = util::RcuShards<Users, USERS_SHARDS>;
+    using UsersReader = UsersShards::Reader;
+    using MaybePassword = Maybe<std::reference_wrapper<const Password>>;
+    static size_t users_shard(std::string_view name) noexcept;
+    static MaybePassword find_password(const UsersReader&, std::string_view name);
+
+    ProcessResult process_message(const UsersReader&, const net::Endpoint&, Result<Message>&&, const util::ConstBinaryView&, MaybeValid&&);
+    ProcessResult process_request(const UsersReader&, const net::Endpoint&, Message&&, const util::ConstBinaryView&, MaybeValid&&);
+    // Password of the user if MESSAGE-INTEGRITY of the message
+    // needs to be checked by process_request.
+    static MaybePassword request_password(const UsersReader&, const MessageView&);
 
     const crypto::SHA1Hash::Func m_sha1;
     const Settings m_settings;
-    stun::ParseStat m_stat;
-    using UserMap = std::unordered_map<precis::OpaqueString, stun::Password, precis::OpaqueStringHash>;
-    UserMap m_users;
+    // Updated by each thread in its own shard
+    stat::Sharded<ParseStat> m_stat;
+    UsersShards m_users;
 };
 
 }
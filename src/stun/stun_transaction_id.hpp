@@ -9,14 +9,21 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
+#include <cassert>
 #include "util/util_binary_view.hpp"
+#include "util/util_maybe.hpp"
 #include "details/stun_constants.hpp"
 
 namespace freewebrtc::stun {
 
 class TransactionId {
 public:
+    // Size of the view must be size of transaction id (96 bits
+    // or 128 bits for RFC3489).
     explicit TransactionId(const util::ConstBinaryView&);
+    // None if size of the view is not size of transaction id
+    static Maybe<TransactionId> from_view(const util::ConstBinaryView&);
     TransactionId(TransactionId&&) = default;
     TransactionId(const TransactionId&) = default;
     TransactionId& operator=(const TransactionId&) = default;
@@ -31,19 +38,37 @@ public:
     util::ConstBinaryView view() const noexcept;
     bool operator==(const TransactionId&) const noexcept = default;
 private:
-    std::vector<uint8_t> m_value;
+    static bool is_valid_size(size_t) noexcept;
+    // Transaction identifier is stored inline (96 bits for RFC5389
+    // and 128 bits for RFC3489) so copying it never allocates.
+    using Storage = std::array<uint8_t, details::TRANSACTION_ID_SIZE_RFC3489>;
+    Storage m_value = {};
+    uint8_t m_size = 0;
 };
 
 //
 // inlines
 //
 inline TransactionId::TransactionId(const util::ConstBinaryView& vv)
-    : m_value(vv.begin(), vv.end())
-{}
+    : m_size(static_cast<uint8_t>(std::min(vv.size(), m_value.size())))
+{
+    assert(is_valid_size(vv.size()));
+    std::copy(vv.begin(), vv.begin() + m_size, m_value.begin());
+}
 
+inline Maybe<TransactionId> TransactionId::from_view(const util::ConstBinaryView& vv) {
+    if (!is_valid_size(vv.size())) {
+        return none();
+    }
+    return TransactionId(vv);
+}
+
+inline bool TransactionId::is_valid_size(size_t size) noexcept {
+    return size == details::TRANSACTION_ID_SIZE || size == details::TRANSACTION_ID_SIZE_RFC3489;
+}
 
 inline util::ConstBinaryView TransactionId::view() const noexcept {
-    return util::ConstBinaryView(m_value);
+    return util::ConstBinaryView(m_value.data(), m_size);
 }
 
 template<typename RandomGen>
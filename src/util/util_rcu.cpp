@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Read-copy-update (RCU) value
+//
+
+#include <thread>
+#include <utility>
+
+#include "util/util_rcu.hpp"
+#include "util/util_thread_index.hpp"
+
+namespace freewebrtc::util {
+
+RcuReaders::Lock::Lock(std::atomic<uint32_t>* counter) noexcept
+    : m_counter(counter)
+{}
+
+RcuReaders::Lock::Lock(Lock&& other) noexcept
+    : m_counter(std::exchange(other.m_counter, nullptr))
+{}
+
+RcuReaders::Lock::~Lock() {
+    if (m_counter != nullptr) {
+        m_counter->fetch_sub(1);
+    }
+}
+
+RcuReaders::Lock RcuReaders::lock() const noexcept {
+    auto& slot = m_slots[thread_index() % SLOTS];
+    while (true) {
+        const uint32_t epoch = m_epoch.load();
+        auto& counter = slot.readers[epoch & 1];
+        counter.fetch_add(1);
+        if (m_epoch.load() == epoch) {
+            return Lock(&counter);
+        }
+        // Writer flipped epoch between load and increment
+        // so it may not wait for this reader.
+        counter.fetch_sub(1);
+    }
+}
+
+void RcuReaders::synchronize() noexcept {
+    const uint32_t epoch = m_epoch.fetch_add(1);
+    for (const auto& slot: m_slots) {
+        while (slot.readers[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+}
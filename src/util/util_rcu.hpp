@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Read-copy-update (RCU) value
+//
+// Readers access current version of the value without locks and
+// without writes to shared cache lines (reader counters are spread
+// over slots by thread index). Writer publishes new version and waits until all
+// readers that may use previous version are finished (grace
+// period) before it is destroyed. Writers are serialized.
+//
+// Grace period is tracked by epoch parity: reader increments
+// counter of parity of current epoch, writer flips epoch and waits
+// for readers of previous parity. Reader that sees epoch change
+// after increment retries so it is never missed by writer.
+//
+// RcuShards is array of values that share readers but are
+// published independently, so change of one value copies only
+// this value (e.g. table that is spread over shards by hash).
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace freewebrtc::util {
+
+class RcuReaders {
+public:
+    // Read-side critical section
+    class Lock {
+    public:
+        Lock(Lock&&) noexcept;
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+        ~Lock();
+    private:
+        friend class RcuReaders;
+        explicit Lock(std::atomic<uint32_t>* counter) noexcept;
+        std::atomic<uint32_t>* m_counter;
+    };
+    Lock lock() const noexcept;
+    // Wait until all critical sections that are started before
+    // the call are finished. Must not be called in critical section.
+    // Calls must be serialized.
+    void synchronize() noexcept;
+
+private:
+    static constexpr size_t SLOTS = 32;
+    struct alignas(64) Slot {
+        std::array<std::atomic<uint32_t>, 2> readers = {0, 0};
+    };
+    std::atomic<uint32_t> m_epoch = 0;
+    mutable std::array<Slot, SLOTS> m_slots;
+};
+
+template<typename T>
+class Rcu {
+public:
+    explicit Rcu(T&& initial);
+    Rcu(const Rcu&) = delete;
+    Rcu& operator=(const Rcu&) = delete;
+
+    // Version of the value that is valid while reader exists
+    class Reader {
+    public:
+        const T& operator*() const noexcept;
+        const T* operator->() const noexcept;
+    private:
+        friend class Rcu;
+        Reader(RcuReaders::Lock&&, const T*) noexcept;
+        RcuReaders::Lock m_lock;
+        const T* m_value;
+    };
+    Reader read() const noexcept;
+
+    // Publish new version of the value that is created by the
+    // function from current one (usually modified copy). Returns
+    // when previous version is destroyed.
+    template<typename F>
+    void update(F&&);
+    void replace(T&&);
+
+private:
+    void publish(std::unique_ptr<const T>&&);
+
+    RcuReaders m_readers;
+    std::mutex m_write;
+    // Owned by m_owned. Changed under write mutex.
+    std::atomic<const T*> m_value;
+    std::unique_ptr<const T> m_owned;
+};
+
+template<typename T, size_t N>
+class RcuShards {
+public:
+    // Shards are default constructed
+    RcuShards();
+    RcuShards(const RcuShards&) = delete;
+    RcuShards& operator=(const RcuShards&) = delete;
+
+    // Versions of the shards that are valid while reader exists.
+    // Shards are loaded on access so reader may see shards of
+    // different updates.
+    class Reader {
+    public:
+        const T& operator[](size_t index) const noexcept;
+    private:
+        friend class RcuShards;
+        Reader(RcuReaders::Lock&&, const RcuShards&) noexcept;
+        RcuReaders::Lock m_lock;
+        const RcuShards* m_shards;
+    };
+    Reader read() const noexcept;
+
+    // Publish new versions of the shards with listed indices that
+    // are created by the function from current ones:
+    // f(index, current) -> T. Other shards are not copied. All
+    // versions are published with one grace period; returns when
+    // previous versions are destroyed.
+    template<typename F>
+    void update(std::span<const size_t> indices, F&&);
+
+private:
+    RcuReaders m_readers;
+    std::mutex m_write;
+    // Owned by m_owned. Changed under write mutex.
+    std::array<std::atomic<const T*>, N> m_values;
+    std::array<std::unique_ptr<const T>, N> m_owned;
+};
+
+//
+// implementation
+//
+template<typename T>
+Rcu<T>::Rcu(T&& initial)
+    : m_owned(std::make_unique<const T>(std::move(initial)))
+{
+    m_value.store(m_owned.get());
+}
+
+template<typename T>
+Rcu<T>::Reader::Reader(RcuReaders::Lock&& lock, const T* value) noexcept
+    : m_lock(std::move(lock))
+    , m_value(value)
+{}
+
+template<typename T>
+const T& Rcu<T>::Reader::operator*() const noexcept {
+    return *m_value;
+}
+
+template<typename T>
+const T* Rcu<T>::Reader::operator->() const noexcept {
+    return m_value;
+}
+
+template<typename T>
+typename Rcu<T>::Reader Rcu<T>::read() const noexcept {
+    // Value is loaded after lock so it cannot be destroyed by
+    // writer that has not seen the lock.
+    auto lock = m_readers.lock();
+    return Reader(std::move(lock), m_value.load());
+}
+
+template<typename T>
+template<typename F>
+void Rcu<T>::update(F&& f) {
+    std::lock_guard<std::mutex> guard(m_write);
+    publish(std::make_unique<const T>(f(*m_owned)));
+}
+
+template<typename T>
+void Rcu<T>::replace(T&& value) {
+    std::lock_guard<std::mutex> guard(m_write);
+    publish(std::make_unique<const T>(std::move(value)));
+}
+
+template<typename T>
+void Rcu<T>::publish(std::unique_ptr<const T>&& value) {
+    m_value.store(value.get());
+    m_readers.synchronize();
+    m_owned = std::move(value);
+}
+
+template<typename T, size_t N>
+RcuShards<T, N>::RcuShards() {
+    for (size_t i = 0; i < N; ++i) {
+        m_owned[i] = std::make_unique<const T>();
+        m_values[i].store(m_owned[i].get());
+    }
+}
+
+template<typename T, size_t N>
+RcuShards<T, N>::Reader::Reader(RcuReaders::Lock&& lock, const RcuShards& shards) noexcept
+    : m_lock(std::move(lock))
+    , m_shards(&shards)
+{}
+
+template<typename T, size_t N>
+const T& RcuShards<T, N>::Reader::operator[](size_t index) const noexcept {
+    // Loaded under lock so it is not destroyed while reader exists
+    return *m_shards->m_values[index].load();
+}
+
+template<typename T, size_t N>
+typename RcuShards<T, N>::Reader RcuShards<T, N>::read() const noexcept {
+    return Reader(m_readers.lock(), *this);
+}
+
+template<typename T, size_t N>
+template<typename F>
+void RcuShards<T, N>::update(std::span<const size_t> indices, F&& f) {
+    std::lock_guard<std::mutex> guard(m_write);
+    std::vector<std::unique_ptr<const T>> previous;
+    previous.reserve(indices.size());
+    for (size_t index: indices) {
+        auto value = std::make_unique<const T>(f(index, *m_owned[index]));
+        m_values[index].store(value.get());
+        previous.emplace_back(std::exchange(m_owned[index], std::move(value)));
+    }
+    m_readers.synchronize();
+}
+
+}
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Slot map: contiguous storage of objects that are addressed
+// by key (index + generation). Key of removed object is never
+// valid again even if its slot is reused (generation of the slot
+// is changed on remove).
+//
+// Key is any structure with index and generation members
+// of type uint32_t.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "util/util_maybe.hpp"
+
+namespace freewebrtc::util {
+
+template<typename T, typename Key>
+class SlotMap {
+public:
+    using Ref = std::reference_wrapper<T>;
+    using CRef = std::reference_wrapper<const T>;
+
+    // Construct object in free slot. O(1) amortized.
+    template<typename... Args>
+    Key emplace(Args&&...);
+    // Remove object. O(1). Returns false if key is not valid.
+    bool erase(const Key&) noexcept;
+    // Find object by key. O(1).
+    Maybe<Ref> find(const Key&) noexcept;
+    Maybe<CRef> find(const Key&) const noexcept;
+    bool contains(const Key&) const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    // Reserve storage for number of objects
+    void reserve(size_t);
+
+private:
+    struct Slot {
+        uint32_t generation = 0;
+        std::optional<T> value;
+    };
+    const Slot *valid_slot(const Key&) const noexcept;
+    std::vector<Slot> m_slots;
+    // Indices of the free slots. Last freed slot is reused first.
+    std::vector<uint32_t> m_free;
+};
+
+//
+// implementation
+//
+template<typename T, typename Key>
+template<typename... Args>
+Key SlotMap<T, Key>::emplace(Args&&... args) {
+    uint32_t index;
+    if (m_free.empty()) {
+        index = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+    } else {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    Slot& slot = m_slots[index];
+    slot.value.emplace(std::forward<Args>(args)...);
+    return Key{index, slot.generation};
+}
+
+template<typename T, typename Key>
+bool SlotMap<T, Key>::erase(const Key& key) noexcept {
+    if (valid_slot(key) == nullptr) {
+        return false;
+    }
+    Slot& slot = m_slots[key.index];
+    slot.value.reset();
+    ++slot.generation;
+    m_free.push_back(key.index);
+    return true;
+}
+
+template<typename T, typename Key>
+Maybe<typename SlotMap<T, Key>::Ref> SlotMap<T, Key>::find(const Key& key) noexcept {
+    if (valid_slot(key) == nullptr) {
+        return none();
+    }
+    return std::ref(*m_slots[key.index].value);
+}
+
+template<typename T, typename Key>
+Maybe<typename SlotMap<T, Key>::CRef> SlotMap<T, Key>::find(const Key& key) const noexcept {
+    const Slot *slot = valid_slot(key);
+    if (slot == nullptr) {
+        return none();
+    }
+    return std::cref(*slot->value);
+}
+
+template<typename T, typename Key>
+bool SlotMap<T, Key>::contains(const Key& key) const noexcept {
+    return valid_slot(key) != nullptr;
+}
+
+template<typename T, typename Key>
+size_t SlotMap<T, Key>::size() const noexcept {
+    return m_slots.size() - m_free.size();
+}
+
+template<typename T, typename Key>
+bool SlotMap<T, Key>::empty() const noexcept {
+    return size() == 0;
+}
+
+template<typename T, typename Key>
+void SlotMap<T, Key>::reserve(size_t sz) {
+    m_slots.reserve(sz);
+    m_free.reserve(sz);
+}
+
+template<typename T, typename Key>
+const typename SlotMap<T, Key>::Slot *SlotMap<T, Key>::valid_slot(const Key& key) const noexcept {
+    if (key.index >= m_slots.size()) {
+        return nullptr;
+    }
+    const Slot& slot = m_slots[key.index];
+    if (slot.generation != key.generation || !slot.value.has_value()) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+}
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Dense index of the thread
+//
+
+#include <mutex>
+#include <vector>
+
+#include "util/util_thread_index.hpp"
+
+namespace freewebrtc::util {
+
+namespace {
+
+class IndexPool {
+public:
+    size_t acquire() {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_free.empty()) {
+            return m_next++;
+        }
+        const size_t index = m_free.back();
+        m_free.pop_back();
+        return index;
+    }
+    void release(size_t index) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_free.push_back(index);
+    }
+private:
+    std::mutex m_mutex;
+    std::vector<size_t> m_free;
+    size_t m_next = 0;
+};
+
+IndexPool& pool() {
+    // Never destroyed: threads may exit after static destructors
+    static IndexPool* pool = new IndexPool;
+    return *pool;
+}
+
+struct ThreadIndex {
+    ThreadIndex()
+        : value(pool().acquire())
+    {}
+    ~ThreadIndex() {
+        pool().release(value);
+    }
+    const size_t value;
+};
+
+}
+
+size_t thread_index() {
+    thread_local const ThreadIndex index;
+    return index.value;
+}
+
+}
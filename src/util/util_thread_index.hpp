@@ -0,0 +1,22 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Dense index of the thread
+//
+// Index is unique among running threads and it is reused after
+// thread exit so indices stay small (less than maximum number of
+// threads that run at once). It is used to select per-thread
+// shard of the data.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace freewebrtc::util {
+
+size_t thread_index();
+
+}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Timer wheel tests
+//
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include <random>
+
+#include "clock/clock_timer_wheel.hpp"
+
+namespace freewebrtc::test {
+
+using namespace std::chrono_literals;
+
+class TimerWheelTest : public ::testing::Test {
+public:
+    using Wheel = clock::TimerWheel<unsigned>;
+    std::vector<unsigned> pop_all(Wheel& wheel, clock::Timepoint now) {
+        std::vector<unsigned> result;
+        for (auto v = wheel.pop_expired(now); v.is_some(); v = wheel.pop_expired(now)) {
+            result.push_back(v.unwrap());
+        }
+        return result;
+    }
+    const clock::Timepoint start = clock::Timepoint::epoch().advance(12345us);
+};
+
+TEST_F(TimerWheelTest, empty) {
+    Wheel wheel;
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_TRUE(wheel.next_expiration().is_none());
+    EXPECT_TRUE(wheel.pop_expired(start).is_none());
+}
+
+TEST_F(TimerWheelTest, fired_not_earlier_than_scheduled) {
+    Wheel wheel;
+    const auto expires = start.advance(500ms).advance(300us);
+    wheel.schedule(expires, 1);
+    ASSERT_TRUE(wheel.next_expiration().is_some());
+    EXPECT_EQ(wheel.next_expiration().unwrap(), expires);
+    EXPECT_TRUE(pop_all(wheel, start.advance(500ms)).empty());
+    EXPECT_TRUE(pop_all(wheel, start.advance(500ms).advance(299us)).empty());
+    EXPECT_EQ(pop_all(wheel, expires), std::vector<unsigned>{1});
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, fired_in_order_of_expiration) {
+    Wheel wheel;
+    wheel.schedule(start.advance(3s), 3);
+    wheel.schedule(start.advance(10ms), 1);
+    wheel.schedule(start.advance(2min), 4);
+    wheel.schedule(start.advance(300ms), 2);
+    EXPECT_EQ(wheel.next_expiration().unwrap(), start.advance(10ms));
+    EXPECT_EQ(pop_all(wheel, start.advance(1s)), (std::vector<unsigned>{1, 2}));
+    EXPECT_EQ(wheel.next_expiration().unwrap(), start.advance(3s));
+    EXPECT_EQ(pop_all(wheel, start.advance(5min)), (std::vector<unsigned>{3, 4}));
+}
+
+TEST_F(TimerWheelTest, cancel) {
+    Wheel wheel;
+    const auto id1 = wheel.schedule(start.advance(10ms), 1);
+    const auto id2 = wheel.schedule(start.advance(20ms), 2);
+    EXPECT_TRUE(wheel.cancel(id1));
+    EXPECT_FALSE(wheel.cancel(id1));
+    EXPECT_EQ(wheel.size(), 1);
+    EXPECT_EQ(wheel.next_expiration().unwrap(), start.advance(20ms));
+    EXPECT_EQ(pop_all(wheel, start.advance(1s)), std::vector<unsigned>{2});
+    // Fired timer cannot be cancelled
+    EXPECT_FALSE(wheel.cancel(id2));
+    // Slot of the cancelled timer is reused but old id does not
+    // cancel new timer.
+    wheel.schedule(start.advance(2s), 3);
+    EXPECT_FALSE(wheel.cancel(id1));
+    EXPECT_EQ(wheel.size(), 1);
+}
+
+TEST_F(TimerWheelTest, far_future) {
+    Wheel wheel;
+    const auto far = start.advance(std::chrono::hours(24 * 100));
+    wheel.schedule(far, 1);
+    EXPECT_TRUE(pop_all(wheel, start.advance(std::chrono::hours(24 * 50))).empty());
+    EXPECT_EQ(wheel.next_expiration().unwrap(), far);
+    EXPECT_TRUE(pop_all(wheel, far.advance(-1us)).empty());
+    EXPECT_EQ(pop_all(wheel, far), std::vector<unsigned>{1});
+}
+
+TEST_F(TimerWheelTest, random_against_reference) {
+    Wheel wheel;
+    std::mt19937 rng(2023);
+    std::multimap<std::pair<int64_t, unsigned>, Wheel::Id> reference;
+    auto now = start;
+    unsigned value = 0;
+    for (size_t step = 0; step < 20000; ++step) {
+        const auto action = rng() % 10;
+        if (action < 5) {
+            const int64_t delay = int64_t(rng() % (action == 0 ? 100000000 : 2000000));
+            const auto expires = now.advance(std::chrono::microseconds(delay));
+            const auto id = wheel.schedule(expires, value);
+            reference.emplace(std::make_pair((expires - start).count(), value), id);
+            ++value;
+        } else if (action < 7 && !reference.empty()) {
+            auto it = std::next(reference.begin(), rng() % reference.size());
+            EXPECT_TRUE(wheel.cancel(it->second));
+            reference.erase(it);
+        } else {
+            now = now.advance(std::chrono::microseconds(rng() % 300000));
+            std::set<unsigned> expected;
+            while (!reference.empty() && reference.begin()->first.first <= (now - start).count()) {
+                expected.insert(reference.begin()->first.second);
+                reference.erase(reference.begin());
+            }
+            const auto fired = pop_all(wheel, now);
+            EXPECT_EQ(std::set<unsigned>(fired.begin(), fired.end()), expected);
+        }
+        ASSERT_EQ(wheel.size(), reference.size());
+        if (!reference.empty()) {
+            ASSERT_TRUE(wheel.next_expiration().is_some());
+            EXPECT_EQ((wheel.next_expiration().unwrap() - start).count(), reference.begin()->first.first);
+        }
+    }
+}
+
+}
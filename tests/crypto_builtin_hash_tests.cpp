@@ -0,0 +1,185 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Built-in hash functions tests
+//
+
+#include <gtest/gtest.h>
+
+#include "crypto/crypto_hmac.hpp"
+#include "crypto/builtin/builtin_hash.hpp"
+#include "crypto/builtin/builtin_hmac_multi.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::test {
+
+class CryptoBuiltinHashTests : public ::testing::Test {
+public:
+    static std::vector<crypto::builtin::Impl> supported_impls() {
+        std::vector<crypto::builtin::Impl> result;
+        for (auto impl: {crypto::builtin::Impl::scalar,
+                         crypto::builtin::Impl::x86_sha,
+                         crypto::builtin::Impl::armv8_sha}) {
+            if (crypto::builtin::is_supported(impl)) {
+                result.push_back(impl);
+            }
+        }
+        return result;
+    }
+    static util::ConstBinaryView view(const std::string& s) {
+        return util::ConstBinaryView(s.data(), s.size());
+    }
+    static std::vector<uint8_t> data(size_t size) {
+        std::vector<uint8_t> result(size);
+        for (size_t i = 0; i < size; ++i) {
+            result[i] = uint8_t(i * 7 + 13);
+        }
+        return result;
+    }
+};
+
+TEST_F(CryptoBuiltinHashTests, fips180_test_vectors) {
+    // FIPS 180-2 Appendix A / B
+    const std::string abc = "abc";
+    const std::string abc448 = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const crypto::SHA1Hash::Value abc_sha1 = {
+        0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+        0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+    };
+    const crypto::SHA1Hash::Value abc448_sha1 = {
+        0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+        0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1
+    };
+    const crypto::SHA256Hash::Value abc_sha256 = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    const crypto::SHA256Hash::Value abc448_sha256 = {
+        0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+        0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+    };
+    for (auto impl: supported_impls()) {
+        EXPECT_EQ(crypto::builtin::sha1_with_impl({view(abc)}, impl).unwrap().value(), abc_sha1);
+        EXPECT_EQ(crypto::builtin::sha1_with_impl({view(abc448)}, impl).unwrap().value(), abc448_sha1);
+        EXPECT_EQ(crypto::builtin::sha256_with_impl({view(abc)}, impl).unwrap().value(), abc_sha256);
+        EXPECT_EQ(crypto::builtin::sha256_with_impl({view(abc448)}, impl).unwrap().value(), abc448_sha256);
+    }
+    EXPECT_EQ(crypto::builtin::sha1({view(abc)}).unwrap().value(), abc_sha1);
+    EXPECT_EQ(crypto::builtin::sha256({view(abc)}).unwrap().value(), abc_sha256);
+}
+
+TEST_F(CryptoBuiltinHashTests, equal_to_openssl) {
+    const auto input = data(300);
+    for (auto impl: supported_impls()) {
+        for (size_t size = 0; size <= input.size(); ++size) {
+            // Split input to two views to check buffering
+            const util::ConstBinaryView vv(input.data(), size);
+            const std::vector<util::ConstBinaryView> split = {
+                vv.assured_subview(0, size / 3),
+                vv.assured_subview(size / 3)
+            };
+            const auto expected_sha1 = crypto::openssl::sha1({vv}).unwrap();
+            const auto expected_sha256 = crypto::openssl::sha256({vv}).unwrap();
+            EXPECT_EQ(crypto::builtin::sha1_with_impl({vv}, impl).unwrap(), expected_sha1) << size;
+            EXPECT_EQ(crypto::builtin::sha1_with_impl(split, impl).unwrap(), expected_sha1) << size;
+            EXPECT_EQ(crypto::builtin::sha256_with_impl({vv}, impl).unwrap(), expected_sha256) << size;
+            EXPECT_EQ(crypto::builtin::sha256_with_impl(split, impl).unwrap(), expected_sha256) << size;
+        }
+    }
+}
+
+TEST_F(CryptoBuiltinHashTests, resumable_sha1_equal_to_openssl) {
+    const auto prefix = data(128);
+    const auto input = data(100);
+    const auto state = crypto::builtin::sha1_start(util::ConstBinaryView(prefix));
+    ASSERT_TRUE(state.is_ok());
+    EXPECT_EQ(state.unwrap(), crypto::openssl::sha1_start(util::ConstBinaryView(prefix)).unwrap());
+    const auto digest = crypto::builtin::sha1_finish(state.unwrap(), {util::ConstBinaryView(input)});
+    ASSERT_TRUE(digest.is_ok());
+    EXPECT_EQ(digest.unwrap(), crypto::openssl::sha1({util::ConstBinaryView(prefix), util::ConstBinaryView(input)}).unwrap());
+    EXPECT_TRUE(crypto::builtin::sha1_start(util::ConstBinaryView(input)).is_err());
+}
+
+TEST_F(CryptoBuiltinHashTests, rfc2202_hmac_sha1) {
+    // key =         0x0b repeated 20 times
+    // data =        "Hi There"
+    // digest =      0xb617318655057264e28bc0b6fb378c8ef146be00
+    const auto key = std::vector<uint8_t>(20, 0x0b);
+    const crypto::SHA1Hash::Func hash = crypto::builtin::sha1;
+    const auto ipad = crypto::hmac::IPadKey::from_key(util::ConstBinaryView(key), hash).unwrap();
+    const auto opad = crypto::hmac::OPadKey::from_key(util::ConstBinaryView(key), hash).unwrap();
+    const std::string data = "Hi There";
+    const crypto::SHA1Hash::Value expected = {
+        0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b,
+        0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46, 0xbe, 0x00
+    };
+    const auto digest = crypto::hmac::digest({view(data)}, opad, ipad, hash);
+    ASSERT_TRUE(digest.is_ok());
+    EXPECT_EQ(digest.unwrap().value.value(), expected);
+    const auto precomputed = crypto::hmac::SHA1PrecomputedKey::from_pads(ipad, opad, crypto::builtin::sha1_resumable());
+    ASSERT_TRUE(precomputed.is_ok());
+    EXPECT_EQ(precomputed.unwrap().digest({view(data)}).unwrap().value.value(), expected);
+}
+
+TEST_F(CryptoBuiltinHashTests, hmac_sha1_multi_equal_to_single) {
+    const crypto::SHA1Hash::Func hash = crypto::builtin::sha1;
+    std::vector<crypto::hmac::SHA1PrecomputedKey> keys;
+    for (const std::string key: {"VOkJxbRl1RmTxUk/WvJxBt", "1234", "secret"}) {
+        const auto ipad = crypto::hmac::IPadKey::from_key(view(key), hash).unwrap();
+        const auto opad = crypto::hmac::OPadKey::from_key(view(key), hash).unwrap();
+        keys.emplace_back(crypto::hmac::SHA1PrecomputedKey::from_pads(ipad, opad, crypto::builtin::sha1_resumable()).unwrap());
+    }
+    // Different sizes to have different number of blocks in lanes
+    const auto input = data(200);
+    const size_t num_jobs = 37;
+    std::vector<std::vector<util::ConstBinaryView>> views;
+    views.reserve(num_jobs);
+    std::vector<crypto::builtin::HMACSHA1Job> jobs;
+    for (size_t i = 0; i < num_jobs; ++i) {
+        const size_t size = (i * 41) % input.size();
+        const util::ConstBinaryView vv(input.data(), size);
+        views.emplace_back(std::vector{vv.assured_subview(0, size / 2), vv.assured_subview(size / 2)});
+        jobs.emplace_back(crypto::builtin::HMACSHA1Job{keys[i % keys.size()], views.back()});
+    }
+    for (auto impl: {crypto::builtin::MultiImpl::single,
+                     crypto::builtin::MultiImpl::lanes4,
+                     crypto::builtin::MultiImpl::lanes8_avx2,
+                     crypto::builtin::MultiImpl::lanes16_avx512}) {
+        if (!crypto::builtin::is_supported(impl)) {
+            continue;
+        }
+        const auto digests = crypto::builtin::hmac_sha1_multi(jobs, impl);
+        ASSERT_TRUE(digests.is_ok());
+        ASSERT_EQ(digests.unwrap().size(), jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            const auto expected = jobs[i].key.get().digest(jobs[i].data).unwrap();
+            EXPECT_TRUE(digests.unwrap()[i].value == expected.value) << i;
+        }
+    }
+}
+
+TEST_F(CryptoBuiltinHashTests, hash_input_chain_and_direct_provider) {
+    const auto input = data(150);
+    const util::ConstBinaryView vv(input);
+    const std::vector<util::ConstBinaryView> rest = {vv.assured_subview(10, 40), vv.assured_subview(50)};
+    const auto first = vv.assured_subview(0, 10);
+    const crypto::SHA1Hash::Input tail(std::span<const util::ConstBinaryView>(rest).subspan(1));
+    const crypto::SHA1Hash::Input middle(rest[0], tail);
+    const crypto::SHA1Hash::Input chained(first, middle);
+    EXPECT_EQ(chained.size(), 3);
+    EXPECT_TRUE(crypto::builtin::sha1(chained).unwrap() == crypto::builtin::sha1({vv}).unwrap());
+
+    // HMAC with provider known at compile time and with Func adapter
+    const std::string key = "VOkJxbRl1RmTxUk/WvJxBt";
+    const auto ipad = crypto::hmac::IPadKey::from_key(view(key), crypto::builtin::sha1).unwrap();
+    const auto opad = crypto::hmac::OPadKey::from_key(view(key), crypto::builtin::sha1).unwrap();
+    const auto direct = crypto::hmac::digest(chained, opad, ipad, crypto::builtin::sha1);
+    const auto adapted = crypto::hmac::digest({vv}, opad, ipad, crypto::SHA1Hash::Func{crypto::openssl::sha1});
+    ASSERT_TRUE(direct.is_ok());
+    ASSERT_TRUE(adapted.is_ok());
+    EXPECT_TRUE(direct.unwrap().value == adapted.unwrap().value);
+}
+
+}
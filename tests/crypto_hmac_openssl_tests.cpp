@@ -7,9 +7,11 @@
 //
 
 #include <gtest/gtest.h>
+#include <thread>
 
 #include "crypto/crypto_hmac.hpp"
 #include "crypto/openssl/openssl_hash.hpp"
+#include "crypto/builtin/builtin_hash.hpp"
 
 namespace freewebrtc::test {
 
@@ -83,4 +85,72 @@ TEST_F(CryptoHMACOpenSSLTests, rfc2104_test_vectors_3) {
     EXPECT_TRUE(crypto::MD5Hash(std::move(expected_v)) == digest.unwrap().value);
 }
 
+TEST_F(CryptoHMACOpenSSLTests, rfc2202_sha1_precomputed_key) {
+    // key =         0x0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b
+    // key_len =     20
+    // data =        "Hi There"
+    // data_len =    8
+    // digest =      0xb617318655057264e28bc0b6fb378c8ef146be00
+    const auto key = std::vector<uint8_t>(20, 0x0b);
+    const auto ipad = crypto::hmac::IPadKey::from_key(util::ConstBinaryView(key), crypto::openssl::sha1);
+    const auto opad = crypto::hmac::OPadKey::from_key(util::ConstBinaryView(key), crypto::openssl::sha1);
+    ASSERT_TRUE(ipad.is_ok());
+    ASSERT_TRUE(opad.is_ok());
+    const auto key_rv = crypto::hmac::SHA1PrecomputedKey::from_pads(ipad.unwrap(), opad.unwrap(), crypto::openssl::sha1_resumable());
+    ASSERT_TRUE(key_rv.is_ok());
+    const std::string data = "Hi There";
+    const auto digest = key_rv.unwrap().digest({util::ConstBinaryView(data.c_str(), data.length())});
+    ASSERT_TRUE(digest.is_ok());
+    crypto::SHA1Hash::Value expected_v = {
+        0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b,
+        0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46, 0xbe, 0x00
+    };
+    EXPECT_TRUE(crypto::SHA1Hash(std::move(expected_v)) == digest.unwrap().value);
+}
+
+TEST_F(CryptoHMACOpenSSLTests, sha1_precomputed_key_equal_to_hmac) {
+    const std::string key = "VOkJxbRl1RmTxUk/WvJxBt";
+    const auto ipad = crypto::hmac::IPadKey::from_key(util::ConstBinaryView(key.c_str(), key.length()), crypto::openssl::sha1);
+    const auto opad = crypto::hmac::OPadKey::from_key(util::ConstBinaryView(key.c_str(), key.length()), crypto::openssl::sha1);
+    ASSERT_TRUE(ipad.is_ok());
+    ASSERT_TRUE(opad.is_ok());
+    const auto key_rv = crypto::hmac::SHA1PrecomputedKey::from_pads(ipad.unwrap(), opad.unwrap(), crypto::openssl::sha1_resumable());
+    ASSERT_TRUE(key_rv.is_ok());
+    for (size_t size: {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000}) {
+        const auto data = std::vector<uint8_t>(size, uint8_t(size));
+        const util::ConstBinaryView view(data);
+        const auto expected = crypto::hmac::digest({view.assured_subview(0, size / 2), view.assured_subview(size / 2)},
+                                                   opad.unwrap(),
+                                                   ipad.unwrap(),
+                                                   crypto::SHA1Hash::Func{&crypto::openssl::sha1});
+        const auto digest = key_rv.unwrap().digest({view.assured_subview(0, size / 2), view.assured_subview(size / 2)});
+        ASSERT_TRUE(expected.is_ok());
+        ASSERT_TRUE(digest.is_ok());
+        EXPECT_TRUE(expected.unwrap().value == digest.unwrap().value) << size;
+    }
+}
+
+TEST_F(CryptoHMACOpenSSLTests, digest_context_reused_in_threads) {
+    // Each thread uses its own digest context for all digests
+    std::vector<std::thread> threads;
+    std::vector<size_t> mismatches(4, 0);
+    for (size_t t = 0; t < mismatches.size(); ++t) {
+        threads.emplace_back([&mismatches, t] {
+            for (size_t i = 0; i < 200; ++i) {
+                const auto data = std::vector<uint8_t>(i, uint8_t(t + i));
+                const util::ConstBinaryView view(data);
+                const auto sha1 = crypto::openssl::sha1({view});
+                const auto md5 = crypto::openssl::md5({view});
+                if (!sha1.is_ok() || !md5.is_ok() || !(sha1.unwrap() == crypto::builtin::sha1({view}).unwrap())) {
+                    ++mismatches[t];
+                }
+            }
+        });
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+    EXPECT_EQ(mismatches, std::vector<size_t>(mismatches.size(), 0));
+}
+
 }
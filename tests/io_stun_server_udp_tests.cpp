@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Linux UDP driver of STUN server tests
+//
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "io/io_stun_server_udp.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::test {
+
+class IoStunServerUdpTest : public ::testing::Test {
+public:
+    using StunServer = stun::server::Stateless;
+
+    io::UdpSocket bind_loopback() {
+        auto sock = io::UdpSocket::bind(net::UdpEndpoint{loopback, net::Port(0)}).unwrap();
+        // Tests never wait for datagrams
+        EXPECT_TRUE(sock.set_nonblocking().is_ok());
+        return sock;
+    }
+    util::ByteVec binding_request() {
+        std::random_device random;
+        const stun::Message request {
+            stun::Header {
+                stun::Class::request(),
+                stun::Method::binding(),
+                stun::TransactionId::generate(random)
+            },
+            stun::AttributeSet::create({}),
+            stun::IsRFC3489{false},
+            none()
+        };
+        return request.build().unwrap();
+    }
+    void queue(io::UdpBatch& batch, const util::ByteVec& data, const net::UdpEndpoint& target) {
+        auto buffer = batch.send_buffer();
+        ASSERT_GE(buffer.size(), data.size());
+        std::copy(data.begin(), data.end(), buffer.begin());
+        batch.queue_send(data.size(), target, none());
+    }
+
+    const net::ip::Address loopback = net::ip::Address::from_string("127.0.0.1").unwrap();
+    StunServer server{crypto::openssl::sha1};
+};
+
+TEST_F(IoStunServerUdpTest, batch_of_binding_requests) {
+    io::StunServerUDP driver(bind_loopback(), server);
+    const auto server_ep = driver.socket().local_endpoint().unwrap();
+    auto client = bind_loopback();
+    const auto client_ep = client.local_endpoint().unwrap();
+
+    io::UdpBatch batch(8);
+    const size_t count = 3;
+    for (size_t i = 0; i < count; ++i) {
+        queue(batch, binding_request(), server_ep);
+    }
+    ASSERT_EQ(client.send(batch).unwrap(), count);
+    ASSERT_EQ(driver.process().unwrap(), count);
+    EXPECT_EQ(driver.stat().responses.count(), count);
+
+    ASSERT_EQ(client.receive(batch).unwrap(), count);
+    ASSERT_EQ(batch.received().size(), count);
+    for (const auto& r: batch.received()) {
+        EXPECT_EQ(r.remote, server_ep);
+        EXPECT_EQ(r.path(), Maybe<net::Path>(net::Path{loopback, loopback}));
+        stun::ParseStat stat;
+        const auto rsp = stun::Message::parse(r.data, stat).unwrap();
+        EXPECT_EQ(rsp.header.cls, stun::Class::success_response());
+        const auto& xor_mapped = rsp.attribute_set.xor_mapped().unwrap().get();
+        EXPECT_EQ(xor_mapped.addr.to_address(rsp.header.transaction_id), client_ep.address);
+        EXPECT_EQ(xor_mapped.port, client_ep.port);
+    }
+}
+
+TEST_F(IoStunServerUdpTest, not_stun_datagram_is_ignored) {
+    io::StunServerUDP driver(bind_loopback(), server);
+    const auto server_ep = driver.socket().local_endpoint().unwrap();
+    auto client = bind_loopback();
+
+    io::UdpBatch batch(4);
+    queue(batch, util::ByteVec(32, 0xFF), server_ep);
+    ASSERT_EQ(client.send(batch).unwrap(), 1);
+    ASSERT_EQ(driver.process().unwrap(), 1);
+    EXPECT_EQ(driver.stat().responses.count(), 0);
+    // Nothing is ready on non-blocking sockets
+    EXPECT_EQ(driver.process().unwrap(), 0);
+    EXPECT_EQ(client.receive(batch).unwrap(), 0);
+}
+
+TEST_F(IoStunServerUdpTest, unsendable_datagram_is_skipped) {
+    io::StunServerUDP driver(bind_loopback(), server);
+    const auto server_ep = driver.socket().local_endpoint().unwrap();
+    auto client = bind_loopback();
+
+    // IPv6 destination cannot be reached by IPv4 socket
+    const net::UdpEndpoint ipv6_ep{net::ip::Address::from_string("::1").unwrap(), net::Port(3478)};
+    io::UdpBatch batch(4);
+    queue(batch, binding_request(), ipv6_ep);
+    queue(batch, binding_request(), server_ep);
+    queue(batch, binding_request(), ipv6_ep);
+    queue(batch, binding_request(), server_ep);
+    ASSERT_EQ(client.send(batch).unwrap(), 2);
+    EXPECT_EQ(batch.send_count(), 0);
+    ASSERT_EQ(driver.process().unwrap(), 2);
+    EXPECT_EQ(driver.stat().responses.count(), 2);
+    EXPECT_EQ(driver.stat().send_dropped.count(), 0);
+}
+
+TEST_F(IoStunServerUdpTest, ipv6_wildcard_socket_is_ipv6_only) {
+    auto v6_rv = io::UdpSocket::bind(net::UdpEndpoint{net::ip::Address::from_string("::").unwrap(), net::Port(0)});
+    if (v6_rv.is_err()) {
+        GTEST_SKIP() << "IPv6 is not available: " << v6_rv.unwrap_err().message();
+    }
+    auto v6 = std::move(v6_rv).unwrap();
+    ASSERT_TRUE(v6.set_nonblocking().is_ok());
+    const auto port = v6.local_endpoint().unwrap().port;
+    io::StunServerUDP v6_driver(std::move(v6), server);
+    // IPv4 socket on the same port serves IPv4 clients
+    auto v4 = io::UdpSocket::bind(net::UdpEndpoint{net::ip::Address::from_string("0.0.0.0").unwrap(), port}).unwrap();
+    ASSERT_TRUE(v4.set_nonblocking().is_ok());
+    io::StunServerUDP v4_driver(std::move(v4), server);
+
+    auto client = bind_loopback();
+    const auto client_ep = client.local_endpoint().unwrap();
+    io::UdpBatch batch(4);
+    queue(batch, binding_request(), net::UdpEndpoint{loopback, port});
+    ASSERT_EQ(client.send(batch).unwrap(), 1);
+    EXPECT_EQ(v6_driver.process().unwrap(), 0);
+    ASSERT_EQ(v4_driver.process().unwrap(), 1);
+
+    ASSERT_EQ(client.receive(batch).unwrap(), 1);
+    stun::ParseStat stat;
+    const auto rsp = stun::Message::parse(batch.received()[0].data, stat).unwrap();
+    const auto& xor_mapped = rsp.attribute_set.xor_mapped().unwrap().get();
+    EXPECT_EQ(xor_mapped.addr.to_address(rsp.header.transaction_id), client_ep.address);
+}
+
+}
@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// io_uring event loop driver tests
+//
+
+#include <gtest/gtest.h>
+#include <optional>
+#include <random>
+
+#include "clock/clock_std.hpp"
+#include "io/io_uring_driver.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::test {
+
+class IoUringDriverTest : public ::testing::Test {
+public:
+    using StunServer = stun::server::Stateless;
+    using ClientUDP = stun::ClientUDP;
+
+    class Sink : public ClientUDP::EffectSink {
+    public:
+        void send_data(const ClientUDP::SendData&) override {
+            FAIL() << "Requests are sent by driver";
+        }
+        void transaction_ok(ClientUDP::TransactionOk&& ok) override {
+            ok_results.push_back(std::move(ok));
+        }
+        void transaction_failed(ClientUDP::TransactionFailed&&) override {
+            ++failed;
+        }
+        std::vector<ClientUDP::TransactionOk> ok_results;
+        size_t failed = 0;
+    };
+
+    void SetUp() override {
+        auto driver_rv = io::UringDriver::create();
+        if (driver_rv.is_err()) {
+            GTEST_SKIP() << "io_uring is not available: " << driver_rv.unwrap_err().message();
+        }
+        maybe_driver.emplace(std::move(driver_rv).unwrap());
+    }
+    io::UringDriver& driver() {
+        return *maybe_driver;
+    }
+    io::UdpSocket bind_loopback() {
+        return io::UdpSocket::bind(net::UdpEndpoint{loopback, net::Port(0)}).unwrap();
+    }
+    util::ByteVec binding_request() {
+        std::random_device random;
+        const stun::Message request {
+            stun::Header {
+                stun::Class::request(),
+                stun::Method::binding(),
+                stun::TransactionId::generate(random)
+            },
+            stun::AttributeSet::create({}),
+            stun::IsRFC3489{false},
+            none()
+        };
+        return request.build().unwrap();
+    }
+
+    const net::ip::Address loopback = net::ip::Address::from_string("127.0.0.1").unwrap();
+    const clock::NativeDuration wait = std::chrono::milliseconds(100);
+    StunServer server{crypto::openssl::sha1};
+    std::optional<io::UringDriver> maybe_driver;
+};
+
+TEST_F(IoUringDriverTest, server_binding_request) {
+    auto server_sock = bind_loopback();
+    const auto server_ep = server_sock.local_endpoint().unwrap();
+    ASSERT_TRUE(driver().add_server(std::move(server_sock), server).is_ok());
+    auto client = bind_loopback();
+    const auto client_ep = client.local_endpoint().unwrap();
+
+    io::UdpBatch batch(4);
+    const auto request = binding_request();
+    std::copy(request.begin(), request.end(), batch.send_buffer().begin());
+    batch.queue_send(request.size(), server_ep, none());
+    ASSERT_EQ(client.send(batch).unwrap(), 1);
+    size_t received = 0;
+    for (size_t i = 0; i < 10 && received == 0; ++i) {
+        received += driver().run_once(wait).unwrap();
+    }
+    ASSERT_EQ(received, 1);
+    // Response is submitted by the same iteration
+    ASSERT_EQ(client.receive(batch).unwrap(), 1);
+    // Send completion
+    driver().run_once(wait).unwrap();
+    const auto& r = batch.received()[0];
+    EXPECT_EQ(r.remote, server_ep);
+    stun::ParseStat stat;
+    const auto rsp = stun::Message::parse(r.data, stat).unwrap();
+    EXPECT_EQ(rsp.header.cls, stun::Class::success_response());
+    const auto& xor_mapped = rsp.attribute_set.xor_mapped().unwrap().get();
+    EXPECT_EQ(xor_mapped.addr.to_address(rsp.header.transaction_id), client_ep.address);
+    EXPECT_EQ(xor_mapped.port, client_ep.port);
+    EXPECT_EQ(driver().stat().sent.count(), 1);
+}
+
+TEST_F(IoUringDriverTest, client_and_server_on_one_ring) {
+    auto server_sock = bind_loopback();
+    const auto server_ep = server_sock.local_endpoint().unwrap();
+    ASSERT_TRUE(driver().add_server(std::move(server_sock), server).is_ok());
+    auto client_sock = bind_loopback();
+    const auto client_ep = client_sock.local_endpoint().unwrap();
+    ClientUDP client{ClientUDP::Settings{}};
+    Sink sink;
+    auto destination = [&](const ClientUDP::Handle&) -> Maybe<net::UdpEndpoint> {
+        return server_ep;
+    };
+    ASSERT_TRUE(driver().add_client(std::move(client_sock), client, destination, sink).is_ok());
+
+    std::random_device rnd;
+    const auto handle = client.create(rnd, clock::steady_clock_now(), ClientUDP::Request{{loopback, loopback}, {}}).unwrap();
+    for (size_t i = 0; i < 10 && sink.ok_results.empty(); ++i) {
+        driver().run_once(wait).unwrap();
+    }
+    ASSERT_EQ(sink.ok_results.size(), 1);
+    EXPECT_EQ(sink.failed, 0);
+    EXPECT_EQ(sink.ok_results[0].handle, handle);
+    EXPECT_EQ(sink.ok_results[0].result, client_ep);
+}
+
+TEST_F(IoUringDriverTest, client_request_without_destination_is_dropped) {
+    ClientUDP client{ClientUDP::Settings{}};
+    Sink sink;
+    auto destination = [](const ClientUDP::Handle&) -> Maybe<net::UdpEndpoint> {
+        return none();
+    };
+    ASSERT_TRUE(driver().add_client(bind_loopback(), client, destination, sink).is_ok());
+    std::random_device rnd;
+    client.create(rnd, clock::steady_clock_now(), ClientUDP::Request{{loopback, loopback}, {}}).unwrap();
+    driver().run_once(std::chrono::milliseconds(0)).unwrap();
+    EXPECT_EQ(driver().stat().send_dropped.count(), 1);
+    EXPECT_EQ(driver().stat().sent.count(), 0);
+}
+
+TEST_F(IoUringDriverTest, client_request_larger_than_send_buffer_is_dropped) {
+    io::UringDriver::Settings settings;
+    // Smaller than STUN header
+    settings.send_buffer_size = 16;
+    auto small = io::UringDriver::create(settings).unwrap();
+    ClientUDP client{ClientUDP::Settings{}};
+    Sink sink;
+    const auto target = bind_loopback();
+    const auto target_ep = target.local_endpoint().unwrap();
+    auto destination = [&](const ClientUDP::Handle&) -> Maybe<net::UdpEndpoint> {
+        return target_ep;
+    };
+    ASSERT_TRUE(small.add_client(bind_loopback(), client, destination, sink).is_ok());
+    std::random_device rnd;
+    client.create(rnd, clock::steady_clock_now(), ClientUDP::Request{{loopback, loopback}, {}}).unwrap();
+    small.run_once(std::chrono::milliseconds(0)).unwrap();
+    EXPECT_EQ(small.stat().send_dropped.count(), 1);
+    EXPECT_EQ(small.stat().sent.count(), 0);
+}
+
+TEST_F(IoUringDriverTest, run_once_waits_for_max_wait) {
+    ASSERT_TRUE(driver().add_server(bind_loopback(), server).is_ok());
+    // Completions of buffers that are provided on start
+    driver().run_once(std::chrono::milliseconds(0)).unwrap();
+    const auto max_wait = std::chrono::milliseconds(20);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(driver().run_once(max_wait).unwrap(), 0);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, max_wait);
+    EXPECT_LT(elapsed, std::chrono::seconds(1));
+}
+
+}
@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Per-thread shards of statistics tests
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "stat/stat_counter.hpp"
+#include "stat/stat_sharded.hpp"
+
+namespace freewebrtc::test {
+
+TEST(StatShardedTest, threads_out_of_first_segment) {
+    // Threads get shards of next segments
+    stat::Sharded<stat::Counter> counters(2);
+    const size_t threads_count = 8;
+    const size_t count = 10000;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < count; ++i) {
+                counters.local().inc();
+            }
+        });
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+    const auto sum = counters.sum([](stat::Counter& sum, const stat::Counter& shard) {
+        sum.add(shard.count());
+    });
+    EXPECT_EQ(sum.count(), threads_count * count);
+}
+
+}
@@ -10,6 +10,7 @@
 #include <random>
 
 #include "stun/stun_message.hpp"
+#include "stun/stun_error.hpp"
 #include "crypto/openssl/openssl_hash.hpp"
 
 namespace freewebrtc::test {
@@ -99,6 +100,34 @@ TEST_F(STUNMessageBuildTest, build_binding_request_with_integrity) {
     EXPECT_TRUE(is_valid_rv.unwrap().value_or(false));
 }
 
+TEST_F(STUNMessageBuildTest, build_binding_request_with_precomputed_password) {
+    const stun::Message request {
+        stun::Header {
+            stun::Class::request(),
+            stun::Method::binding(),
+            rand_tid()
+        },
+        stun::AttributeSet::create({stun::SoftwareAttribute{"test"}}),
+        stun::IsRFC3489{false},
+        none()
+    };
+    const precis::OpaqueString password_str("VOkJxbRl1RmTxUk/WvJxBt");
+    auto password = stun::Password::short_term(password_str, sha1);
+    auto precomputed = stun::Password::short_term(password_str, sha1, crypto::openssl::sha1_resumable());
+    ASSERT_TRUE(password.is_ok());
+    ASSERT_TRUE(precomputed.is_ok());
+    ASSERT_TRUE(precomputed.unwrap().precomputed().is_some());
+    EXPECT_TRUE(password.unwrap() == precomputed.unwrap());
+    stun::IntegrityData integrity_data{password.unwrap(), sha1};
+    stun::IntegrityData precomputed_data{precomputed.unwrap(), sha1};
+    const auto data = request.build(precomputed_data).unwrap();
+    EXPECT_EQ(data, request.build(integrity_data).unwrap());
+    stun::ParseStat stat;
+    const auto& req_rv = stun::Message::parse(util::ConstBinaryView(data), stat);
+    ASSERT_TRUE(req_rv.is_ok());
+    EXPECT_TRUE(req_rv.unwrap().is_valid(util::ConstBinaryView(data), precomputed_data).unwrap().value_or(false));
+}
+
 TEST_F(STUNMessageBuildTest, build_error_response_with_errocode) {
     const stun::Message response {
         stun::Header {
@@ -148,4 +177,78 @@ TEST_F(STUNMessageBuildTest, build_success_response_with_xor_mapped) {
 }
 
 
+TEST_F(STUNMessageBuildTest, build_into_and_gather_are_equal_to_build) {
+    auto tid = rand_tid();
+    auto xaddr = stun::XoredAddress::from_address(net::ip::Address::from_string("::1").unwrap(), tid);
+    const stun::Message response {
+        stun::Header {
+            stun::Class::success_response(),
+            stun::Method::binding(),
+            tid
+        },
+        stun::AttributeSet::create(
+            {
+                stun::XorMappedAddressAttribute{xaddr, net::Port(1234)},
+                stun::SoftwareAttribute{"test vector"},
+                stun::UsernameAttribute{precis::OpaqueString{"evtj:h6vY"}},
+                stun::PriorityAttribute{0x6e0001ff},
+                stun::IceControlledAttribute{0x932ff9b151263b36},
+                stun::FingerprintAttribute{0}
+            },
+            {
+                stun::UnknownAttribute(stun::AttributeType::from_uint16(0x7fff), util::ConstBinaryView(std::vector<uint8_t>{1, 2, 3}))
+            }),
+        stun::IsRFC3489{false},
+        none()
+    };
+    auto password = stun::Password::short_term(precis::OpaqueString("VOkJxbRl1RmTxUk/WvJxBt"), sha1);
+    ASSERT_TRUE(password.is_ok());
+    const stun::MaybeIntegrity integrity = stun::IntegrityData{password.unwrap(), sha1};
+    for (const auto& maybe_integrity: {stun::MaybeIntegrity{none()}, integrity}) {
+        const auto expected_rv = response.build(maybe_integrity);
+        ASSERT_TRUE(expected_rv.is_ok());
+        const auto& expected = expected_rv.unwrap();
+        EXPECT_EQ(response.build_size(maybe_integrity), expected.size());
+
+        std::vector<uint8_t> buffer(1500, 0xff);
+        const auto size_rv = response.build_into(buffer, maybe_integrity);
+        ASSERT_TRUE(size_rv.is_ok());
+        ASSERT_EQ(size_rv.unwrap(), expected.size());
+        buffer.resize(size_rv.unwrap());
+        EXPECT_EQ(buffer, expected);
+
+        stun::MessageGather gather;
+        ASSERT_TRUE(response.build_gather(gather, maybe_integrity).is_ok());
+        EXPECT_EQ(gather.size(), expected.size());
+        EXPECT_EQ(gather.concat(), expected);
+        // USERNAME, SOFTWARE and unknown attribute are not copied
+        EXPECT_EQ(gather.views().size(), 7);
+    }
+
+    stun::ParseStat stat;
+    const auto data = response.build(integrity).unwrap();
+    const auto msg_rv = stun::Message::parse(util::ConstBinaryView(data), stat);
+    ASSERT_TRUE(msg_rv.is_ok());
+    EXPECT_TRUE(msg_rv.unwrap().is_valid(util::ConstBinaryView(data), integrity.unwrap()).unwrap().value_or(false));
+}
+
+TEST_F(STUNMessageBuildTest, build_into_small_buffer) {
+    const stun::Message request {
+        stun::Header {
+            stun::Class::request(),
+            stun::Method::binding(),
+            rand_tid()
+        },
+        stun::AttributeSet::create({stun::SoftwareAttribute{"test"}, stun::FingerprintAttribute{0}}),
+        stun::IsRFC3489{false},
+        none()
+    };
+    std::vector<uint8_t> buffer(request.build_size() - 1);
+    const auto rv = request.build_into(buffer);
+    ASSERT_TRUE(rv.is_err());
+    EXPECT_EQ(rv.unwrap_err().category(), stun::stun_build_error_category());
+    EXPECT_EQ(rv.unwrap_err().value(), (int)stun::BuildError::buffer_too_small);
+}
+
+
 }
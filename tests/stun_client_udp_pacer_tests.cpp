@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN UDP client send pacing tests
+//
+
+#include <gtest/gtest.h>
+
+#include "stun/details/stun_client_udp_pacer.hpp"
+
+namespace freewebrtc::test {
+
+class StunClientPacerTest : public ::testing::Test {
+public:
+    using Pacer = stun::details::ClientUDPPacer;
+    using Handle = stun::client_udp::Handle;
+    using Timepoint = clock::Timepoint;
+    using Duration = clock::NativeDuration;
+
+    const Duration interval = std::chrono::milliseconds(50);
+};
+
+TEST_F(StunClientPacerTest, sends_are_released_once_per_interval) {
+    Pacer pacer(interval, 1);
+    auto now = Timepoint::epoch();
+    EXPECT_TRUE(pacer.next_release().is_none());
+    for (uint32_t i = 0; i < 3; ++i) {
+        pacer.push(Handle{i, 0});
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(pacer.ready(now), Maybe<Handle>(Handle{i, 0}));
+        pacer.release(now);
+        EXPECT_TRUE(pacer.ready(now).is_none());
+        if (i + 1 < 3) {
+            ASSERT_TRUE(pacer.next_release().is_some());
+            EXPECT_EQ(pacer.next_release().unwrap() - now, interval);
+            now = pacer.next_release().unwrap();
+        }
+    }
+    EXPECT_EQ(pacer.size(), 0);
+    EXPECT_TRUE(pacer.next_release().is_none());
+}
+
+TEST_F(StunClientPacerTest, burst_after_idle) {
+    Pacer pacer(interval, 3);
+    auto now = Timepoint::epoch();
+    for (uint32_t i = 0; i < 5; ++i) {
+        pacer.push(Handle{i, 0});
+    }
+    // Full bucket is released at once
+    for (uint32_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pacer.ready(now).is_some()) << i;
+        pacer.release(now);
+    }
+    EXPECT_TRUE(pacer.ready(now).is_none());
+    EXPECT_EQ(pacer.next_release().unwrap() - now, interval);
+    // Bucket is refilled by one token per interval
+    now = now.advance(interval);
+    ASSERT_TRUE(pacer.ready(now).is_some());
+    pacer.release(now);
+    EXPECT_TRUE(pacer.ready(now).is_none());
+    // Idle period refills bucket but not more than its size
+    now = now.advance(10 * interval);
+    pacer.drop();
+    for (uint32_t i = 0; i < 3; ++i) {
+        pacer.push(Handle{i, 1});
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(pacer.ready(now), Maybe<Handle>(Handle{i, 1}));
+        pacer.release(now);
+    }
+    pacer.push(Handle{3, 1});
+    EXPECT_TRUE(pacer.ready(now).is_none());
+}
+
+TEST_F(StunClientPacerTest, drop_does_not_consume_token) {
+    Pacer pacer(interval, 1);
+    const auto now = Timepoint::epoch();
+    pacer.push(Handle{0, 0});
+    pacer.push(Handle{1, 0});
+    pacer.drop();
+    ASSERT_EQ(pacer.ready(now), Maybe<Handle>(Handle{1, 0}));
+}
+
+}
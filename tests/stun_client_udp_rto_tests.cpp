@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN UDP client RTO calculator tests
+//
+
+#include <gtest/gtest.h>
+
+#include "stun/details/stun_client_udp_rto.hpp"
+#include "stun/stun_error.hpp"
+
+namespace freewebrtc::test {
+
+class StunClientRtoTest : public ::testing::Test {
+public:
+    using RtoCalculator = stun::details::ClientUDPRtoCalculator;
+    using Settings = RtoCalculator::Settings;
+    using Timepoint = clock::Timepoint;
+    using Duration = clock::NativeDuration;
+
+    net::Path path(const std::string_view& target) {
+        return net::Path{
+            net::ip::Address::from_string("192.168.0.1").unwrap(),
+            net::ip::Address::from_string(target).unwrap()
+        };
+    }
+    const Duration rtt = std::chrono::milliseconds(100);
+    // First RTT measurement: SRTT + 4 * RTTVAR = R + 4 * R / 2
+    const Duration first_rto = 3 * rtt;
+};
+
+TEST_F(StunClientRtoTest, least_recently_updated_path_is_dropped) {
+    Settings settings;
+    settings.max_paths = 2;
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    calc.new_rtt(now, path("10.0.0.2"), rtt);
+    // Update first path so the second one is the oldest
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    calc.backoff(now, path("10.0.0.3"), rtt);
+    EXPECT_EQ(calc.paths_count(), 2);
+    EXPECT_NE(calc.rto(path("10.0.0.1")), settings.initial_rto);
+    EXPECT_EQ(calc.rto(path("10.0.0.2")), settings.initial_rto);
+    EXPECT_EQ(calc.rto(path("10.0.0.3")), rtt);
+}
+
+TEST_F(StunClientRtoTest, prefix_aggregation) {
+    Settings settings;
+    settings.maybe_prefix_aggregation = Settings::PrefixAggregation{};
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    calc.new_rtt(now, path("2001:db8:1:1::1"), rtt);
+    EXPECT_EQ(calc.prefixes_count(), 2);
+    // Unseen peers in the same prefix
+    EXPECT_EQ(calc.rto(path("10.0.0.200")), first_rto);
+    EXPECT_EQ(calc.rto(path("2001:db8:1:ffff::2")), first_rto);
+    // Peers in other prefixes
+    EXPECT_EQ(calc.rto(path("10.0.1.1")), settings.initial_rto);
+    EXPECT_EQ(calc.rto(path("2001:db8:2::1")), settings.initial_rto);
+    // Own backoff of the path is preferred
+    calc.backoff(now, path("10.0.0.2"), 2 * settings.initial_rto);
+    EXPECT_EQ(calc.rto(path("10.0.0.2")), 2 * settings.initial_rto);
+}
+
+TEST_F(StunClientRtoTest, no_prefix_aggregation_by_default) {
+    Settings settings;
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    EXPECT_EQ(calc.rto(path("10.0.0.1")), first_rto);
+    EXPECT_EQ(calc.rto(path("10.0.0.2")), settings.initial_rto);
+    EXPECT_EQ(calc.prefixes_count(), 0);
+}
+
+TEST_F(StunClientRtoTest, outdated_history_is_dropped) {
+    Settings settings;
+    settings.maybe_prefix_aggregation = Settings::PrefixAggregation{};
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    now = now.advance(settings.history_duration + Duration(1));
+    calc.new_rtt(now, path("10.1.0.1"), rtt);
+    EXPECT_EQ(calc.paths_count(), 1);
+    EXPECT_EQ(calc.prefixes_count(), 1);
+    EXPECT_EQ(calc.rto(path("10.0.0.1")), settings.initial_rto);
+}
+
+TEST_F(StunClientRtoTest, snapshot_restore) {
+    Settings settings;
+    settings.maybe_prefix_aggregation = Settings::PrefixAggregation{};
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    calc.new_rtt(now, path("2001:db8::1"), 2 * rtt);
+    calc.backoff(now, path("10.0.0.2"), 4 * rtt);
+    now = now.advance(std::chrono::minutes(10));
+    const auto snapshot = calc.snapshot(now);
+
+    // Restore in the new calculator with other clock
+    RtoCalculator restored(settings);
+    const auto start = Timepoint::epoch();
+    ASSERT_TRUE(restored.restore(start, util::ConstBinaryView(snapshot), std::chrono::minutes(1)).is_ok());
+    EXPECT_EQ(restored.paths_count(), 3);
+    EXPECT_EQ(restored.prefixes_count(), 2);
+    for (const auto& target: {"10.0.0.1", "2001:db8::1", "10.0.0.2", "10.0.0.3", "10.0.1.1"}) {
+        EXPECT_EQ(restored.rto(path(target)), calc.rto(path(target))) << target;
+    }
+    // Restored data is dropped when it becomes older than history
+    // duration: 10 minutes before snapshot + 1 minute of restart.
+    const auto expires = start.advance(settings.history_duration - std::chrono::minutes(11));
+    restored.new_rtt(expires, path("10.1.0.1"), rtt);
+    EXPECT_EQ(restored.paths_count(), 4);
+    restored.new_rtt(expires.advance(Duration(1)), path("10.1.0.1"), rtt);
+    EXPECT_EQ(restored.paths_count(), 1);
+}
+
+TEST_F(StunClientRtoTest, restore_drops_outdated_data) {
+    Settings settings;
+    RtoCalculator calc(settings);
+    calc.new_rtt(Timepoint::epoch(), path("10.0.0.1"), rtt);
+    const auto snapshot = calc.snapshot(Timepoint::epoch());
+    RtoCalculator restored(settings);
+    ASSERT_TRUE(restored.restore(Timepoint::epoch(), util::ConstBinaryView(snapshot), settings.history_duration + Duration(1000)).is_ok());
+    EXPECT_EQ(restored.paths_count(), 0);
+    EXPECT_EQ(restored.rto(path("10.0.0.1")), settings.initial_rto);
+}
+
+TEST_F(StunClientRtoTest, restore_invalid_snapshot) {
+    Settings settings;
+    RtoCalculator calc(settings);
+    calc.new_rtt(Timepoint::epoch(), path("10.0.0.1"), rtt);
+    const auto snapshot = calc.snapshot(Timepoint::epoch());
+    const auto invalid = make_error_code(stun::ClientError::invalid_rto_snapshot);
+    for (size_t size = 0; size < snapshot.size(); ++size) {
+        RtoCalculator restored(settings);
+        EXPECT_EQ(restored.restore(Timepoint::epoch(), util::ConstBinaryView(snapshot.data(), size)).unwrap_err(), invalid) << size;
+        EXPECT_EQ(restored.paths_count(), 0) << size;
+    }
+    auto extended = snapshot;
+    extended.push_back(0);
+    RtoCalculator restored(settings);
+    EXPECT_EQ(restored.restore(Timepoint::epoch(), util::ConstBinaryView(extended)).unwrap_err(), invalid);
+}
+
+TEST_F(StunClientRtoTest, restore_to_non_empty_history) {
+    Settings settings;
+    settings.max_paths = 2;
+    RtoCalculator calc(settings);
+    auto now = Timepoint::epoch();
+    calc.new_rtt(now, path("10.0.0.1"), rtt);
+    calc.new_rtt(now, path("10.0.0.2"), rtt);
+    const auto snapshot = calc.snapshot(now);
+
+    // Known path is updated after the snapshot was taken
+    RtoCalculator restored(settings);
+    const auto start = Timepoint::epoch();
+    const auto elapsed = std::chrono::minutes(10);
+    restored.new_rtt(start, path("10.0.0.3"), 2 * rtt);
+    ASSERT_TRUE(restored.restore(start, util::ConstBinaryView(snapshot), elapsed).is_ok());
+    // Restored paths are older so one of them is dropped
+    EXPECT_EQ(restored.paths_count(), 2);
+    EXPECT_EQ(restored.rto(path("10.0.0.3")), 2 * first_rto);
+
+    // Restored path expires before the known one
+    const auto expires = start.advance(settings.history_duration - elapsed + Duration(1));
+    restored.backoff(expires, path("10.0.0.4"), rtt);
+    EXPECT_EQ(restored.paths_count(), 2);
+    EXPECT_EQ(restored.rto(path("10.0.0.1")), settings.initial_rto);
+    EXPECT_EQ(restored.rto(path("10.0.0.2")), settings.initial_rto);
+    EXPECT_EQ(restored.rto(path("10.0.0.3")), 2 * first_rto);
+}
+
+}
@@ -8,9 +8,11 @@
 
 #include <gtest/gtest.h>
 #include "stun/stun_client_udp.hpp"
+#include "stun/stun_client_udp_sharded.hpp"
 #include "crypto/openssl/openssl_hash.hpp"
 #include "stun/stun_server_stateless.hpp"
 #include "stun/stun_error.hpp"
+#include "stun/details/stun_attr_registry.hpp"
 
 namespace freewebrtc::test {
 
@@ -256,6 +258,80 @@ TEST_F(StunClientTest, request_response_happy_path_with_auth) {
     ASSERT_TRUE(std::holds_alternative<ClientUDP::Idle>(next));
 }
 
+TEST_F(StunClientTest, request_response_from_template) {
+    Settings settings;
+    ClientUDP client(settings);
+    const auto priority = stun::AttributeType::from_uint16(stun::attr_registry::PRIORITY);
+    const auto tmpl = client.create_template(
+        ClientUDP::Request{
+            .path = {local_ipv4, stun_server_ipv4},
+            .attrs = {stun::PriorityAttribute{1}},
+            .maybe_auth = default_auth
+        },
+        {priority}).unwrap();
+    auto now = Timepoint::epoch();
+    const std::vector<uint8_t> priority_value = {0x6e, 0x00, 0x01, 0xff};
+    const std::vector<stun::RequestTemplate::Patch> patches = {{priority, util::ConstBinaryView(priority_value)}};
+    const auto credentials = client.add_credentials(ClientUDP::Auth(default_auth));
+    const auto hnd1 = client.create(rnd, now, tmpl, {local_ipv4, stun_server_ipv4}, patches, credentials).unwrap();
+    const auto hnd2 = client.create(rnd, now, tmpl, {local_ipv4, stun_server_ipv4}).unwrap();
+    std::vector<util::ByteVec> responses;
+    for (const auto& hnd: {hnd1, hnd2}) {
+        auto next = client.next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::SendData>(next));
+        const auto& sent_data = std::get<ClientUDP::SendData>(next);
+        EXPECT_EQ(sent_data.handle, hnd);
+        stun::ParseStat stat;
+        const auto msg = Message::parse(sent_data.message_view, stat).unwrap();
+        EXPECT_EQ(msg.attribute_set.priority().unwrap().get(), hnd == hnd1 ? 0x6e0001ff : 1);
+        responses.emplace_back(server_reponse(sent_data.message_view));
+    }
+    for (const auto& hnd: {hnd1, hnd2}) {
+        ASSERT_TRUE(client.response(now, util::ConstBinaryView(responses[hnd == hnd1 ? 0 : 1])).is_ok());
+        auto next = client.next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::TransactionOk>(next));
+        EXPECT_EQ(std::get<ClientUDP::TransactionOk>(next).handle, hnd);
+    }
+}
+
+TEST_F(StunClientTest, request_response_shared_credentials) {
+    Settings settings;
+    ClientUDP client(settings);
+    auto now = Timepoint::epoch();
+    const auto credentials = client.add_credentials(ClientUDP::Auth(default_auth));
+    auto create = [&] {
+        return client.create(
+            rnd,
+            now,
+            ClientUDP::Request{
+                .path = {local_ipv4, stun_server_ipv4},
+                .maybe_credentials = credentials
+            });
+    };
+    const auto hnd1 = create().unwrap();
+    const auto hnd2 = create().unwrap();
+    // Credentials are kept until transactions are finished
+    client.remove_credentials(credentials);
+    EXPECT_EQ(create().unwrap_err(), make_error_code(stun::ClientError::credentials_not_found));
+    std::vector<util::ByteVec> responses;
+    for (const auto& hnd: {hnd1, hnd2}) {
+        auto next = client.next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::SendData>(next));
+        const auto& sent_data = std::get<ClientUDP::SendData>(next);
+        EXPECT_EQ(sent_data.handle, hnd);
+        stun::ParseStat stat;
+        const auto msg = Message::parse(sent_data.message_view, stat).unwrap();
+        EXPECT_EQ(msg.attribute_set.username().unwrap().get(), default_auth.username);
+        responses.emplace_back(server_reponse(sent_data.message_view));
+    }
+    for (const auto& hnd: {hnd1, hnd2}) {
+        ASSERT_TRUE(client.response(now, util::ConstBinaryView(responses[hnd == hnd1 ? 0 : 1])).is_ok());
+        auto next = client.next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::TransactionOk>(next));
+        EXPECT_EQ(std::get<ClientUDP::TransactionOk>(next).handle, hnd);
+    }
+}
+
 TEST_F(StunClientTest, request_response_parallel_transactions_abab) {
     // Idea of the test that UDP client is requested to create second
     // transaction when the first transaction is not responded.
@@ -731,5 +807,215 @@ TEST_F(StunClientTest, error_response_420_from_server) {
     EXPECT_EQ(uar.attrs, unknown_attrs);
 }
 
+TEST_F(StunClientTest, stray_response_dropped_before_parse) {
+    // Test idea is to receive response with unknown transaction
+    // id and malformed attributes. Client must drop it by
+    // transaction id without checking of the attributes.
+    ClientUDP client({});
+    auto now = Timepoint::epoch();
+    client.create(rnd, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap();
+    auto next = client.next(now);
+    auto sent_data = std::get<ClientUDP::SendData>(next);
+
+    auto response_data = server_reponse(sent_data.message_view);
+    response_data[8] ^= 0xff;  // Transaction ID
+    response_data[22] = 0xff;  // Length of the first attribute
+    const auto rv = client.response(now, util::ConstBinaryView(response_data));
+    ASSERT_TRUE(rv.is_err());
+    EXPECT_EQ(rv.unwrap_err().category(), stun::stun_client_error_category());
+    EXPECT_EQ(rv.unwrap_err().value(), (int)stun::ClientError::transaction_not_found);
+
+    // Same response with valid transaction id is parsed
+    response_data[8] ^= 0xff;
+    const auto rv2 = client.response(now, util::ConstBinaryView(response_data));
+    ASSERT_TRUE(rv2.is_err());
+    EXPECT_EQ(rv2.unwrap_err().category(), stun::stun_parse_error_category());
+}
+
+TEST_F(StunClientTest, drain_effects_in_batch) {
+    ClientUDP client({});
+    auto now = Timepoint::epoch();
+    std::vector<ClientUDP::Handle> handles;
+    for (size_t i = 0; i < 3; ++i) {
+        handles.push_back(client.create(rnd, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap());
+    }
+    ClientUDP::EffectBatch batch;
+    auto deadline = client.drain(now, batch);
+    ASSERT_EQ(batch.send.size(), 3);
+    ASSERT_TRUE(deadline.is_some());
+    EXPECT_TRUE(deadline.unwrap().is_after(now));
+    for (size_t i = 0; i < handles.size(); ++i) {
+        EXPECT_EQ(batch.send[i].handle, handles[i]);
+    }
+
+    // Response to the first request
+    const auto response_data = server_reponse(batch.send[0].message_view);
+    ASSERT_TRUE(client.response(now, util::ConstBinaryView(response_data)).is_ok());
+
+    // Retransmits of other two and success of the first one
+    now = deadline.unwrap();
+    batch.clear();
+    deadline = client.drain(now, batch);
+    ASSERT_EQ(batch.ok.size(), 1);
+    EXPECT_EQ(batch.ok[0].handle, handles[0]);
+    ASSERT_EQ(batch.send.size(), 2);
+    EXPECT_EQ(batch.send[0].handle, handles[1]);
+    EXPECT_EQ(batch.send[1].handle, handles[2]);
+    EXPECT_TRUE(batch.failed.empty());
+
+    // Other transactions are timed out at some moment
+    size_t failed = 0;
+    while (deadline.is_some()) {
+        now = deadline.unwrap();
+        batch.clear();
+        deadline = client.drain(now, batch);
+        for (const auto& f: batch.failed) {
+            EXPECT_TRUE(std::holds_alternative<ClientUDP::TransactionFailed::Timeout>(f.reason));
+        }
+        failed += batch.failed.size();
+    }
+    EXPECT_EQ(failed, 2);
+    EXPECT_TRUE(std::holds_alternative<ClientUDP::Idle>(client.next(now)));
+}
+
+// ================================================================================
+// Paced retransmits
+
+TEST_F(StunClientTest, paced_initial_sends_are_spread) {
+    Settings settings;
+    Settings::RetransmitPaced paced;
+    paced.pacing_interval = 50ms;
+    paced.burst_size = 2;
+    settings.retransmit = paced;
+    ClientUDP client(settings);
+    auto now = Timepoint::epoch();
+    std::vector<ClientUDP::Handle> handles;
+    for (size_t i = 0; i < 4; ++i) {
+        handles.push_back(client.create(rnd, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap());
+    }
+    // Burst of two sends and then one send per pacing interval
+    util::ByteVec response_data;
+    for (size_t i = 0; i < handles.size(); ++i) {
+        if (i >= 2) {
+            auto next = client.next(now);
+            ASSERT_TRUE(std::holds_alternative<ClientUDP::Sleep>(next));
+            EXPECT_EQ(std::get<ClientUDP::Sleep>(next).sleep, Duration(50ms));
+            now = now.advance(50ms);
+        }
+        auto next = client.next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::SendData>(next));
+        const auto& send = std::get<ClientUDP::SendData>(next);
+        EXPECT_EQ(send.handle, handles[i]);
+        response_data = server_reponse(send.message_view);
+    }
+    // RTT is measured from the paced send
+    ASSERT_TRUE(std::holds_alternative<ClientUDP::Sleep>(client.next(now)));
+    now = now.advance(10ms);
+    ASSERT_TRUE(client.response(now, util::ConstBinaryView(response_data)).is_ok());
+    auto next = client.next(now);
+    ASSERT_TRUE(std::holds_alternative<ClientUDP::TransactionOk>(next));
+    EXPECT_EQ(std::get<ClientUDP::TransactionOk>(next).round_trip, Maybe<Duration>(10ms));
+}
+
+TEST_F(StunClientTest, paced_retransmits_are_jittered) {
+    Settings settings;
+    Settings::RetransmitPaced paced;
+    paced.pacing_interval = 1ms;
+    paced.burst_size = 20;
+    paced.jitter_percent = 10;
+    settings.retransmit = paced;
+    ClientUDP client(settings);
+    const auto start = Timepoint::epoch();
+    for (size_t i = 0; i < 20; ++i) {
+        client.create(rnd, start, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap();
+    }
+    // Collect time of the first retransmit of each transaction
+    std::unordered_map<ClientUDP::Handle, unsigned, ClientUDP::HandleHash> sends;
+    std::vector<Duration> retransmits;
+    auto now = start;
+    while (retransmits.size() < 20) {
+        auto next = client.next(now);
+        if (auto* sleep = std::get_if<ClientUDP::Sleep>(&next)) {
+            now = now.advance(sleep->sleep);
+        } else if (auto* send = std::get_if<ClientUDP::SendData>(&next)) {
+            if (++sends[send->handle] == 2) {
+                retransmits.push_back(now - start);
+            }
+        } else {
+            FAIL();
+        }
+    }
+    const auto initial_rto = settings.rto_settings.initial_rto;
+    for (const auto& rtx: retransmits) {
+        EXPECT_GE(rtx, initial_rto * 90 / 100);
+        EXPECT_LE(rtx, initial_rto * 110 / 100);
+    }
+    EXPECT_NE(*std::min_element(retransmits.begin(), retransmits.end()),
+              *std::max_element(retransmits.begin(), retransmits.end()));
+}
+
+// ================================================================================
+// Sharded client
+
+TEST_F(StunClientTest, sharded_response_is_routed_to_owning_shard) {
+    Settings settings;
+    stun::ShardedClientUDP sharded(3, settings);
+    ASSERT_EQ(sharded.shards_count(), 3);
+    auto now = Timepoint::epoch();
+    std::vector<stun::ShardedClientUDP::Handle> handles;
+    std::vector<util::ByteVec> responses;
+    for (size_t i = 0; i < sharded.shards_count(); ++i) {
+        auto hnd = sharded.create(rnd, i, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap();
+        EXPECT_EQ(hnd.shard, i);
+        auto next = sharded.shard(i).next(now);
+        ASSERT_TRUE(std::holds_alternative<ClientUDP::SendData>(next));
+        const auto& send = std::get<ClientUDP::SendData>(next);
+        EXPECT_EQ(send.handle, hnd.handle);
+        EXPECT_EQ(sharded.shard_of(send.message_view), Maybe<size_t>{i});
+        handles.push_back(hnd);
+        responses.push_back(server_reponse(send.message_view));
+    }
+    // Process responses in reverse order
+    for (size_t i = sharded.shards_count(); i-- > 0;) {
+        ASSERT_TRUE(sharded.response(now, util::ConstBinaryView(responses[i])).is_ok());
+        for (size_t j = 0; j < sharded.shards_count(); ++j) {
+            auto next = sharded.shard(j).next(now);
+            if (i == j) {
+                ASSERT_TRUE(std::holds_alternative<ClientUDP::TransactionOk>(next));
+                EXPECT_EQ(std::get<ClientUDP::TransactionOk>(next).handle, handles[i].handle);
+            } else {
+                EXPECT_TRUE(std::holds_alternative<ClientUDP::Sleep>(next) || std::holds_alternative<ClientUDP::Idle>(next));
+            }
+        }
+    }
+}
+
+TEST_F(StunClientTest, sharded_unknown_response_is_dropped) {
+    Settings settings;
+    stun::ShardedClientUDP sharded(2, settings);
+    auto now = Timepoint::epoch();
+    // Transaction of the client with other prefix
+    settings.maybe_tid_prefix = uint8_t(2);
+    ClientUDP other(settings);
+    other.create(rnd, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}}).unwrap();
+    const auto send = std::get<ClientUDP::SendData>(other.next(now));
+    const auto response = server_reponse(send.message_view);
+    EXPECT_TRUE(sharded.shard_of(util::ConstBinaryView(response)).is_none());
+    EXPECT_EQ(sharded.response(now, util::ConstBinaryView(response)).unwrap_err(),
+              make_error_code(stun::ClientError::transaction_not_found));
+    // Not a STUN message
+    const util::ByteVec garbage(32, 0xFF);
+    EXPECT_TRUE(sharded.shard_of(util::ConstBinaryView(garbage)).is_none());
+    EXPECT_TRUE(sharded.response(now, util::ConstBinaryView(garbage)).is_err());
+}
+
+TEST_F(StunClientTest, sharded_create_in_unknown_shard) {
+    Settings settings;
+    stun::ShardedClientUDP sharded(2, settings);
+    auto now = Timepoint::epoch();
+    auto rv = sharded.create(rnd, 2, now, ClientUDP::Request{{local_ipv4, stun_server_ipv4}, {}});
+    ASSERT_TRUE(rv.is_err());
+    EXPECT_EQ(rv.unwrap_err(), make_error_code(stun::ClientError::invalid_shard_index));
+}
 
 }
@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN FINGERPRINT (CRC-32) tests
+//
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "stun/details/stun_fingerprint.hpp"
+
+namespace freewebrtc::test {
+
+class STUNFingerprintTest : public ::testing::Test {
+public:
+    static constexpr stun::CRC32Impl all_impls[] = {
+        stun::CRC32Impl::bytewise,
+        stun::CRC32Impl::slice_by_8,
+        stun::CRC32Impl::pclmul,
+        stun::CRC32Impl::armv8_crc
+    };
+    util::ByteVec random_data(size_t size) {
+        std::mt19937 gen(size);
+        std::uniform_int_distribution<int> dist(0, 255);
+        util::ByteVec result(size);
+        for (auto& v: result) {
+            v = (uint8_t)dist(gen);
+        }
+        return result;
+    }
+};
+
+TEST_F(STUNFingerprintTest, check_value) {
+    const std::string_view str = "123456789";
+    const util::ConstBinaryView view(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+    EXPECT_EQ(stun::crc32(view), 0xcbf43926);
+    for (auto impl: all_impls) {
+        if (stun::crc32_is_supported(impl)) {
+            EXPECT_EQ(stun::crc32(view, impl), 0xcbf43926);
+        }
+    }
+}
+
+TEST_F(STUNFingerprintTest, all_implementations_are_equal) {
+    for (size_t size = 0; size < 600; ++size) {
+        const auto data = random_data(size);
+        const util::ConstBinaryView view(data);
+        const auto expected = stun::crc32(view, stun::CRC32Impl::bytewise);
+        EXPECT_EQ(stun::crc32(view), expected) << "size: " << size;
+        for (auto impl: all_impls) {
+            if (stun::crc32_is_supported(impl)) {
+                EXPECT_EQ(stun::crc32(view, impl), expected) << "size: " << size << " impl: " << (int)impl;
+            }
+        }
+    }
+}
+
+TEST_F(STUNFingerprintTest, multiple_views) {
+    const auto data = random_data(1500);
+    const util::ConstBinaryView view(data);
+    const auto expected = stun::crc32(view, stun::CRC32Impl::bytewise);
+    for (size_t split1: {0, 1, 7, 20, 64, 100, 777}) {
+        for (size_t split2: {0, 3, 16, 65, 128}) {
+            std::vector<util::ConstBinaryView> views = {
+                view.assured_subview(0, split1),
+                view.assured_subview(split1, split2),
+                view.assured_subview(split1 + split2, data.size() - split1 - split2)
+            };
+            EXPECT_EQ(stun::crc32(views), expected) << split1 << " " << split2;
+        }
+    }
+}
+
+}
@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN message view tests
+//
+
+#include <gtest/gtest.h>
+
+#include "stun/stun_message_view.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::test {
+
+class STUNMessageViewTest : public ::testing::Test {
+public:
+    // RFC5769 2.1. Sample Request
+    const std::vector<uint8_t> rfc5769_request = {
+        0x00, 0x01, 0x00, 0x58,  //    Request type and message length
+        0x21, 0x12, 0xa4, 0x42,  //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01,  // }
+        0xbc, 0x34, 0xd6, 0x86,  // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae,  // }
+        0x80, 0x22, 0x00, 0x10,  //    SOFTWARE attribute header
+        0x53, 0x54, 0x55, 0x4e,  // }
+        0x20, 0x74, 0x65, 0x73,  // }  User-agent...
+        0x74, 0x20, 0x63, 0x6c,  // }  ...name
+        0x69, 0x65, 0x6e, 0x74,  // }
+        0x00, 0x24, 0x00, 0x04,  //    PRIORITY attribute header
+        0x6e, 0x00, 0x01, 0xff,  //    ICE priority value
+        0x80, 0x29, 0x00, 0x08,  //    ICE-CONTROLLED attribute header
+        0x93, 0x2f, 0xf9, 0xb1,  // }  Pseudo-random tie breaker...
+        0x51, 0x26, 0x3b, 0x36,  // }   ...for ICE control
+        0x00, 0x06, 0x00, 0x09,  //    USERNAME attribute header
+        0x65, 0x76, 0x74, 0x6a,  // }
+        0x3a, 0x68, 0x36, 0x76,  // }  Username (9 bytes) and padding (3 bytes)
+        0x59, 0x20, 0x20, 0x20,  // }
+        0x00, 0x08, 0x00, 0x14,  //    MESSAGE-INTEGRITY attribute header
+        0x9a, 0xea, 0xa7, 0x0c,  // }
+        0xbf, 0xd8, 0xcb, 0x56,  // }
+        0x78, 0x1e, 0xf2, 0xb5,  // }  HMAC-SHA1 fingerprint
+        0xb2, 0xd3, 0xf2, 0x49,  // }
+        0xc1, 0xb5, 0x71, 0xa2,  // }
+        0x80, 0x28, 0x00, 0x04,  //    FINGERPRINT attribute header
+        0xe5, 0x7a, 0x3b, 0xcf   //    CRC32 fingerprint
+    };
+    // RFC5769 2.3. Sample IPv6 Response
+    const std::vector<uint8_t> rfc5769_ipv6_response = {
+        0x01, 0x01, 0x00, 0x48, //    Response type and message length
+        0x21, 0x12, 0xa4, 0x42, //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01, // }
+        0xbc, 0x34, 0xd6, 0x86, // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae, // }
+        0x80, 0x22, 0x00, 0x0b, //    SOFTWARE attribute header
+        0x74, 0x65, 0x73, 0x74, // }
+        0x20, 0x76, 0x65, 0x63, // }  UTF-8 server name
+        0x74, 0x6f, 0x72, 0x20, // }
+        0x00, 0x20, 0x00, 0x14, //    XOR-MAPPED-ADDRESS attribute header
+        0x00, 0x02, 0xa1, 0x47, //    Address family (IPv6) and xor'd mapped port number
+        0x01, 0x13, 0xa9, 0xfa, // }
+        0xa5, 0xd3, 0xf1, 0x79, // }  Xor'd mapped IPv6 address
+        0xbc, 0x25, 0xf4, 0xb5, // }
+        0xbe, 0xd2, 0xb9, 0xd9, // }
+        0x00, 0x08, 0x00, 0x14, //    MESSAGE-INTEGRITY attribute header
+        0xa3, 0x82, 0x95, 0x4e, // }
+        0x4b, 0xe6, 0x7b, 0xf1, // }
+        0x17, 0x84, 0xc9, 0x7c, // }  HMAC-SHA1 fingerprint
+        0x82, 0x92, 0xc2, 0x75, // }
+        0xbf, 0xe3, 0xed, 0x41, // }
+        0x80, 0x28, 0x00, 0x04, //    FINGERPRINT attribute header
+        0xc8, 0xfb, 0x0b, 0x4c  //    CRC32 fingerprint
+    };
+    const precis::OpaqueString rfc5769_password{"VOkJxbRl1RmTxUk/WvJxBt"};
+};
+
+// ================================================================================
+// Positive cases
+
+TEST_F(STUNMessageViewTest, rfc5769_2_1_sample_request) {
+    stun::ParseStat stat;
+    auto view_rv = stun::MessageView::parse(util::ConstBinaryView(rfc5769_request), stat);
+    EXPECT_EQ(stat.success.count(), 1);
+    ASSERT_TRUE(view_rv.is_ok());
+    const auto& view = view_rv.unwrap();
+    EXPECT_FALSE(view.is_rfc3489());
+    EXPECT_EQ(view.cls(), stun::Class::request());
+    EXPECT_EQ(view.method(), stun::Method::binding());
+    EXPECT_EQ(view.transaction_id(), util::ConstBinaryView(rfc5769_request).assured_subview(8, 12));
+    ASSERT_TRUE(view.username().is_some());
+    EXPECT_EQ(view.username().unwrap(), "evtj:h6vY");
+    ASSERT_TRUE(view.software().is_some());
+    EXPECT_EQ(view.software().unwrap(), "STUN test client");
+    ASSERT_TRUE(view.priority().is_some());
+    EXPECT_EQ(view.priority().unwrap(), 0x6e0001ff);
+    ASSERT_TRUE(view.ice_controlled().is_some());
+    EXPECT_EQ(view.ice_controlled().unwrap(), 0x932ff9b151263b36ULL);
+    EXPECT_TRUE(view.ice_controlling().is_none());
+    EXPECT_FALSE(view.has_use_candidate());
+    EXPECT_TRUE(view.has_fingerprint());
+    EXPECT_TRUE(view.integrity().is_some());
+    EXPECT_TRUE(view.unknown_comprehension_required().empty());
+
+    auto password = stun::Password::short_term(rfc5769_password, crypto::openssl::sha1);
+    ASSERT_TRUE(password.is_ok());
+    auto is_valid_rv = view.is_valid(stun::IntegrityData{password.unwrap(), crypto::openssl::sha1});
+    ASSERT_TRUE(is_valid_rv.is_ok());
+    ASSERT_TRUE(is_valid_rv.unwrap().is_some());
+    EXPECT_TRUE(is_valid_rv.unwrap().unwrap());
+}
+
+TEST_F(STUNMessageViewTest, rfc5769_2_3_sample_ipv6_response) {
+    stun::ParseStat stat;
+    auto view_rv = stun::MessageView::parse(util::ConstBinaryView(rfc5769_ipv6_response), stat);
+    ASSERT_TRUE(view_rv.is_ok());
+    const auto& view = view_rv.unwrap();
+    EXPECT_EQ(view.cls(), stun::Class::success_response());
+    ASSERT_TRUE(view.xor_mapped().is_some());
+    const auto xor_mapped = view.xor_mapped().unwrap();
+    EXPECT_EQ(xor_mapped.port.value(), 32853);
+    EXPECT_EQ(xor_mapped.addr.to_address(stun::TransactionId(view.transaction_id())),
+              net::ip::Address::from_string("2001:db8:1234:5678:11:2233:4455:6677").unwrap());
+
+    auto password = stun::Password::short_term(rfc5769_password, crypto::openssl::sha1);
+    ASSERT_TRUE(password.is_ok());
+    auto is_valid_rv = view.is_valid(stun::IntegrityData{password.unwrap(), crypto::openssl::sha1});
+    ASSERT_TRUE(is_valid_rv.is_ok());
+    EXPECT_TRUE(is_valid_rv.unwrap().value_or(false));
+}
+
+TEST_F(STUNMessageViewTest, same_as_message_parse) {
+    stun::ParseStat stat;
+    const util::ConstBinaryView data(rfc5769_request);
+    auto view_rv = stun::MessageView::parse(data, stat);
+    auto msg_rv = stun::Message::parse(data, stat);
+    ASSERT_TRUE(view_rv.is_ok());
+    ASSERT_TRUE(msg_rv.is_ok());
+    const auto& view = view_rv.unwrap();
+    const auto& msg = msg_rv.unwrap();
+    EXPECT_EQ(view.transaction_id(), msg.header.transaction_id.view());
+    ASSERT_TRUE(view.integrity_interval().is_some());
+    EXPECT_EQ(view.integrity_interval().unwrap(), msg.integrity_interval.unwrap());
+    EXPECT_EQ(view.integrity().unwrap().value, msg.attribute_set.integrity().unwrap().get().value);
+    EXPECT_EQ(view.username().unwrap(), msg.attribute_set.username().unwrap().get().value);
+}
+
+TEST_F(STUNMessageViewTest, invalid_password) {
+    stun::ParseStat stat;
+    auto view_rv = stun::MessageView::parse(util::ConstBinaryView(rfc5769_request), stat);
+    ASSERT_TRUE(view_rv.is_ok());
+    auto password = stun::Password::short_term(precis::OpaqueString("invalid"), crypto::openssl::sha1);
+    ASSERT_TRUE(password.is_ok());
+    auto is_valid_rv = view_rv.unwrap().is_valid(stun::IntegrityData{password.unwrap(), crypto::openssl::sha1});
+    ASSERT_TRUE(is_valid_rv.is_ok());
+    ASSERT_TRUE(is_valid_rv.unwrap().is_some());
+    EXPECT_FALSE(is_valid_rv.unwrap().unwrap());
+}
+
+TEST_F(STUNMessageViewTest, unknown_comprehension_required_attribute) {
+    std::vector<uint8_t> request = {
+        0x00, 0x01, 0x00, 0x14,  //    Request type and message length
+        0x21, 0x12, 0xa4, 0x42,  //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01,  // }
+        0xbc, 0x34, 0xd6, 0x86,  // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae,  // }
+        0x7F, 0xFF, 0x00, 0x03,  //    Unknown comprehension-required attribute
+        0x12, 0x34, 0x56, 0x00,  //
+        0x00, 0x24, 0x00, 0x04,  //    PRIORITY attribute header
+        0x12, 0x34, 0x56, 0x78,  //    PRIORITY value (0x1234578)
+        0xFF, 0xFF, 0x00, 0x00,  //    Unknown comprehension-optional attribute
+    };
+    stun::ParseStat stat;
+    auto view_rv = stun::MessageView::parse(util::ConstBinaryView(request), stat);
+    ASSERT_TRUE(view_rv.is_ok());
+    const auto& view = view_rv.unwrap();
+    const auto unknown = view.unknown_comprehension_required();
+    ASSERT_EQ(unknown.size(), 1);
+    EXPECT_EQ(unknown[0].value(), 0x7FFF);
+    EXPECT_EQ(view.priority().unwrap(), 0x12345678);
+}
+
+TEST_F(STUNMessageViewTest, attributes_after_integrity_are_ignored) {
+    std::vector<uint8_t> request = {
+        0x00, 0x01, 0x00, 0x20,  //    Request type and message length
+        0x21, 0x12, 0xa4, 0x42,  //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01,  // }
+        0xbc, 0x34, 0xd6, 0x86,  // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae,  // }
+        0x00, 0x08, 0x00, 0x14,  //    MESSAGE-INTEGRITY attribute header
+        0x9a, 0xea, 0xa7, 0x0c,  // }
+        0xbf, 0xd8, 0xcb, 0x56,  // }
+        0x78, 0x1e, 0xf2, 0xb5,  // }  HMAC-SHA1 fingerprint
+        0xb2, 0xd3, 0xf2, 0x49,  // }
+        0xc1, 0xb5, 0x71, 0xa2,  // }
+        0x00, 0x24, 0x00, 0x04,  //    PRIORITY attribute header
+        0x12, 0x34, 0x56, 0x78,  //    PRIORITY value (0x1234578)
+    };
+    stun::ParseStat stat;
+    auto view_rv = stun::MessageView::parse(util::ConstBinaryView(request), stat);
+    ASSERT_TRUE(view_rv.is_ok());
+    EXPECT_TRUE(view_rv.unwrap().integrity().is_some());
+    EXPECT_TRUE(view_rv.unwrap().priority().is_none());
+}
+
+// ================================================================================
+// Negative cases
+
+TEST_F(STUNMessageViewTest, invalid_fingerprint) {
+    auto request = rfc5769_request;
+    request.back() ^= 0x01;
+    stun::ParseStat stat;
+    EXPECT_TRUE(stun::MessageView::parse(util::ConstBinaryView(request), stat).is_err());
+    EXPECT_EQ(stat.error.count(), 1);
+    EXPECT_EQ(stat.invalid_fingerprint.count(), 1);
+}
+
+TEST_F(STUNMessageViewTest, invalid_attribute_size) {
+    std::vector<uint8_t> response = {
+        0x01, 0x01, 0x00, 0x04,  //    Response type and message length
+        0x21, 0x12, 0xa4, 0x42,  //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01,  // }
+        0xbc, 0x34, 0xd6, 0x86,  // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae,  // }
+        0x80, 0x22, 0x00, 0x0b,  //    SOFTWARE attribute header
+    };
+    stun::ParseStat stat;
+    EXPECT_TRUE(stun::MessageView::parse(util::ConstBinaryView(response), stat).is_err());
+    EXPECT_EQ(stat.error.count(), 1);
+    EXPECT_EQ(stat.invalid_attr_size.count(), 1);
+}
+
+TEST_F(STUNMessageViewTest, truncated_xor_mapped_address_no_ipv6_address) {
+    std::vector<uint8_t> response = {
+        0x01, 0x01, 0x00, 0x08, //    Response type and message length
+        0x21, 0x12, 0xa4, 0x42, //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01, // }
+        0xbc, 0x34, 0xd6, 0x86, // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae, // }
+        0x00, 0x20, 0x00, 0x04, //    XOR-MAPPED-ADDRESS attribute header
+        0x00, 0x02, 0xa1, 0x47  //    Address family (IPv6) and xor'd mapped port number
+    };
+    stun::ParseStat stat;
+    EXPECT_TRUE(stun::MessageView::parse(util::ConstBinaryView(response), stat).is_err());
+    EXPECT_EQ(stat.error.count(), 1);
+    EXPECT_EQ(stat.invalid_ip_address.count(), 1);
+}
+
+}
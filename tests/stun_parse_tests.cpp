@@ -311,6 +311,43 @@ TEST_F(STUNMessageParserTest, unknown_attribute_that_does_not_require_comprehens
     EXPECT_TRUE(msg_rv.is_ok());
 }
 
+TEST_F(STUNMessageParserTest, peek_checks_header_only) {
+    // Attribute is truncated but header is valid
+    std::vector<uint8_t> response = {
+        0x01, 0x01, 0x00, 0x04,  //    Response type and message length
+        0x21, 0x12, 0xa4, 0x42,  //    Magic cookie
+        0xb7, 0xe7, 0xa7, 0x01,  // }
+        0xbc, 0x34, 0xd6, 0x86,  // }  Transaction ID
+        0xfa, 0x87, 0xdf, 0xae,  // }
+        0x80, 0x22, 0x00, 0x0b,  //    SOFTWARE attribute header
+    };
+    stun::ParseStat stat;
+    auto peek_rv = stun::Message::peek(util::ConstBinaryView(response), stat);
+    ASSERT_TRUE(peek_rv.is_ok());
+    EXPECT_EQ(stat.error.count(), 0);
+    const auto& peek = peek_rv.unwrap();
+    EXPECT_FALSE(peek.is_rfc3489);
+    EXPECT_EQ(peek.cls, stun::Class::success_response());
+    EXPECT_EQ(peek.method, stun::Method::binding());
+    const std::vector<uint8_t> tid = {0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86, 0xfa, 0x87, 0xdf, 0xae};
+    EXPECT_EQ(stun::TransactionId(peek.transaction_id), stun::TransactionId(util::ConstBinaryView(tid)));
+    EXPECT_FALSE(stun::Message::parse(util::ConstBinaryView(response), stat).is_ok());
+    EXPECT_EQ(stat.error.count(), 1);
+}
+
+TEST_F(STUNMessageParserTest, transaction_id_from_view) {
+    const std::vector<uint8_t> data(17, 0xab);
+    for (size_t size = 0; size <= data.size(); ++size) {
+        const auto maybe_tid = stun::TransactionId::from_view(util::ConstBinaryView(data.data(), size));
+        if (size == 12 || size == 16) {
+            ASSERT_TRUE(maybe_tid.is_some()) << size;
+            EXPECT_EQ(maybe_tid.unwrap().view(), util::ConstBinaryView(data.data(), size));
+        } else {
+            EXPECT_TRUE(maybe_tid.is_none()) << size;
+        }
+    }
+}
+
 // ================================================================================
 // Negative cases
 
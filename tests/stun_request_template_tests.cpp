@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// STUN request template tests
+//
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "stun/stun_request_template.hpp"
+#include "stun/stun_error.hpp"
+#include "stun/details/stun_attr_registry.hpp"
+#include "crypto/openssl/openssl_hash.hpp"
+
+namespace freewebrtc::test {
+
+class STUNRequestTemplateTest : public ::testing::Test {
+public:
+    stun::TransactionId rand_tid() {
+        std::random_device random;
+        return stun::TransactionId::generate(random);
+    }
+    stun::Message request(const stun::TransactionId& tid, uint32_t priority, uint64_t tiebreaker, bool fingerprint = true) {
+        stun::AttributeSet::AttrVec attrs = {
+            stun::UsernameAttribute{precis::OpaqueString{"evtj:h6vY"}},
+            stun::PriorityAttribute{priority},
+            stun::IceControllingAttribute{tiebreaker},
+            stun::SoftwareAttribute{"test vector"}
+        };
+        if (fingerprint) {
+            attrs.emplace_back(stun::FingerprintAttribute{0});
+        }
+        return stun::Message {
+            stun::Header {
+                stun::Class::request(),
+                stun::Method::binding(),
+                tid
+            },
+            stun::AttributeSet::create(std::move(attrs)),
+            stun::IsRFC3489{false},
+            none()
+        };
+    }
+    stun::MaybeIntegrity integrity() {
+        const precis::OpaqueString password("VOkJxbRl1RmTxUk/WvJxBt");
+        return stun::IntegrityData{
+            stun::Password::short_term(password, sha1, crypto::openssl::sha1_resumable()).unwrap(),
+            sha1
+        };
+    }
+    static std::vector<uint8_t> be(uint64_t v, size_t size) {
+        std::vector<uint8_t> result(size);
+        for (size_t i = 0; i < size; ++i) {
+            result[i] = uint8_t(v >> (8 * (size - 1 - i)));
+        }
+        return result;
+    }
+    const std::vector<stun::AttributeType> patchable = {
+        stun::AttributeType::from_uint16(stun::attr_registry::PRIORITY),
+        stun::AttributeType::from_uint16(stun::attr_registry::ICE_CONTROLLING)
+    };
+    const crypto::SHA1Hash::Func sha1 = crypto::openssl::sha1;
+};
+
+TEST_F(STUNRequestTemplateTest, same_as_built_message) {
+    for (const auto& maybe_integrity: {stun::MaybeIntegrity{none()}, integrity()}) {
+        for (bool fingerprint: {false, true}) {
+            const auto tmpl_rv = stun::RequestTemplate::create(request(rand_tid(), 1, 2, fingerprint), maybe_integrity);
+            ASSERT_TRUE(tmpl_rv.is_ok());
+            const auto& tmpl = tmpl_rv.unwrap();
+            for (size_t i = 0; i < 10; ++i) {
+                const auto tid = rand_tid();
+                const auto expected = request(tid, 1, 2, fingerprint).build(maybe_integrity).unwrap();
+                const auto data_rv = tmpl.build(tid);
+                ASSERT_TRUE(data_rv.is_ok());
+                EXPECT_EQ(data_rv.unwrap(), expected);
+            }
+        }
+    }
+}
+
+TEST_F(STUNRequestTemplateTest, patch_attributes) {
+    const auto maybe_integrity = integrity();
+    const auto tmpl = stun::RequestTemplate::create(request(rand_tid(), 1, 2), maybe_integrity, patchable).unwrap();
+    std::mt19937_64 gen(1);
+    for (size_t i = 0; i < 10; ++i) {
+        const auto tid = rand_tid();
+        const uint32_t priority = uint32_t(gen());
+        const uint64_t tiebreaker = gen();
+        const auto priority_value = be(priority, sizeof(priority));
+        const auto tiebreaker_value = be(tiebreaker, sizeof(tiebreaker));
+        const std::vector<stun::RequestTemplate::Patch> patches = {
+            {patchable[0], util::ConstBinaryView(priority_value)},
+            {patchable[1], util::ConstBinaryView(tiebreaker_value)}
+        };
+        const auto expected = request(tid, priority, tiebreaker).build(maybe_integrity).unwrap();
+        std::vector<uint8_t> buffer(1500);
+        const auto size_rv = tmpl.build_into(buffer, tid, patches);
+        ASSERT_TRUE(size_rv.is_ok());
+        ASSERT_EQ(size_rv.unwrap(), tmpl.size());
+        buffer.resize(size_rv.unwrap());
+        EXPECT_EQ(buffer, expected);
+
+        stun::ParseStat stat;
+        const auto msg = stun::Message::parse(util::ConstBinaryView(buffer), stat).unwrap();
+        EXPECT_TRUE(msg.is_valid(util::ConstBinaryView(buffer), maybe_integrity.unwrap()).unwrap().value_or(false));
+    }
+}
+
+TEST_F(STUNRequestTemplateTest, build_errors) {
+    const auto tmpl = stun::RequestTemplate::create(request(rand_tid(), 1, 2), integrity(), patchable).unwrap();
+    const auto tid = rand_tid();
+    std::vector<uint8_t> small(tmpl.size() - 1);
+    EXPECT_EQ(tmpl.build_into(small, tid).unwrap_err(), make_error_code(stun::BuildError::buffer_too_small));
+
+    const auto value = be(1, sizeof(uint32_t));
+    const std::vector<stun::RequestTemplate::Patch> not_patchable = {
+        {stun::AttributeType::from_uint16(stun::attr_registry::SOFTWARE), util::ConstBinaryView(value)}
+    };
+    EXPECT_EQ(tmpl.build(tid, not_patchable).unwrap_err(), make_error_code(stun::BuildError::attribute_is_not_patchable));
+
+    const std::vector<stun::RequestTemplate::Patch> wrong_size = {
+        {patchable[1], util::ConstBinaryView(value)}
+    };
+    EXPECT_EQ(tmpl.build(tid, wrong_size).unwrap_err(), make_error_code(stun::BuildError::patch_value_size_mismatch));
+
+    std::random_device random;
+    const auto rfc3489_tid = stun::TransactionId::generate_rfc3489(random);
+    EXPECT_EQ(tmpl.build(rfc3489_tid).unwrap_err(), make_error_code(stun::BuildError::transaction_id_size_mismatch));
+}
+
+}
@@ -19,6 +19,33 @@ class STUNServerStatefulTest : public ::testing::Test {
 public:
     using Clock = std::chrono::steady_clock;
     using StunServer = stun::server::Stateful<Clock>;
+
+    StunServer::Settings settings(size_t max_cache_size = 4 * 1024 * 1024) {
+        using namespace std::chrono_literals;
+        return StunServer::Settings{40s, stun::MurmurTransactionIdHash<std::random_device>::create(), max_cache_size};
+    }
+    util::ByteVec binding_request() {
+        std::random_device random;
+        const stun::Message request {
+            stun::Header {
+                stun::Class::request(),
+                stun::Method::binding(),
+                stun::TransactionId::generate(random)
+            },
+            stun::AttributeSet::create({}),
+            stun::IsRFC3489{false},
+            none()
+        };
+        return request.build().unwrap();
+    }
+    stun::Message parse(const util::ConstBinaryView& view) {
+        stun::ParseStat stat;
+        const auto rv = stun::Message::parse(view, stat);
+        EXPECT_TRUE(rv.is_ok());
+        return rv.unwrap();
+    }
+    const net::Endpoint endpoint = net::UdpEndpoint{net::ip::Address::from_string("127.0.0.1").unwrap(), net::Port(2023)};
+    const net::Endpoint other_endpoint = net::UdpEndpoint{net::ip::Address::from_string("127.0.0.1").unwrap(), net::Port(2024)};
 };
 
 // ================================================================================
@@ -28,6 +55,93 @@ TEST_F(STUNServerStatefulTest, create_simple_response) {
     using namespace std::chrono_literals;
     StunServer::Settings settings{40s, stun::MurmurTransactionIdHash<std::random_device>::create()};
     StunServer server(settings);
+    const auto request = binding_request();
+    const auto r = server.process(Clock::now(), endpoint, util::ConstBinaryView(request));
+    ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+    const auto& respond = std::get<StunServer::Respond>(r);
+    EXPECT_FALSE(respond.retransmit);
+    const auto rsp = parse(respond.response);
+    EXPECT_EQ(rsp.header.cls, stun::Class::success_response());
+    EXPECT_EQ(rsp.header.transaction_id, parse(util::ConstBinaryView(request)).header.transaction_id);
+    EXPECT_EQ(server.cache_count(), 1);
+}
+
+TEST_F(STUNServerStatefulTest, retransmit_is_answered_from_cache) {
+    using namespace std::chrono_literals;
+    StunServer server(settings());
+    const auto now = Clock::now();
+    const auto request = binding_request();
+    const auto r1 = server.process(now, endpoint, util::ConstBinaryView(request));
+    ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r1));
+    const auto& first_view = std::get<StunServer::Respond>(r1).response;
+    const util::ByteVec first(first_view.begin(), first_view.end());
+    const auto r2 = server.process(now + 500ms, endpoint, util::ConstBinaryView(request));
+    ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r2));
+    const auto& second = std::get<StunServer::Respond>(r2);
+    EXPECT_TRUE(second.retransmit);
+    EXPECT_EQ(util::ByteVec(second.response.begin(), second.response.end()), first);
+    EXPECT_EQ(server.stat().cache_hit.count(), 1);
+    EXPECT_EQ(server.stat().cache_miss.count(), 1);
+}
+
+TEST_F(STUNServerStatefulTest, response_expires_after_transaction_lifetime) {
+    using namespace std::chrono_literals;
+    StunServer server(settings());
+    const auto now = Clock::now();
+    const auto request = binding_request();
+    server.process(now, endpoint, util::ConstBinaryView(request));
+    server.process(now + 10s, endpoint, util::ConstBinaryView(binding_request()));
+    EXPECT_EQ(server.cache_count(), 2);
+    server.expire(now + 40s);
+    EXPECT_EQ(server.cache_count(), 1);
+    const auto r = server.process(now + 41s, endpoint, util::ConstBinaryView(request));
+    ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+    EXPECT_FALSE(std::get<StunServer::Respond>(r).retransmit);
+    EXPECT_EQ(server.stat().expired.count(), 1);
+    server.expire(now + 100s);
+    EXPECT_EQ(server.cache_count(), 0);
+    EXPECT_EQ(server.cache_size(), 0);
+}
+
+TEST_F(STUNServerStatefulTest, cache_size_is_limited) {
+    StunServer server(settings(2048));
+    const auto now = Clock::now();
+    for (size_t i = 0; i < 100; ++i) {
+        server.process(now, endpoint, util::ConstBinaryView(binding_request()));
+        EXPECT_LE(server.cache_size(), 2048);
+    }
+    EXPECT_GT(server.cache_count(), 0);
+    EXPECT_LT(server.cache_count(), 100);
+    EXPECT_EQ(server.stat().evicted.count() + server.cache_count(), 100);
+}
+
+// ================================================================================
+// Negative cases
+
+TEST_F(STUNServerStatefulTest, same_transaction_from_other_endpoint_is_not_cached) {
+    StunServer server(settings());
+    const auto now = Clock::now();
+    const auto request = binding_request();
+    server.process(now, endpoint, util::ConstBinaryView(request));
+    const auto r = server.process(now, other_endpoint, util::ConstBinaryView(request));
+    ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+    const auto& respond = std::get<StunServer::Respond>(r);
+    EXPECT_FALSE(respond.retransmit);
+    const auto rsp = parse(respond.response);
+    const auto xor_mapped = rsp.attribute_set.xor_mapped();
+    ASSERT_TRUE(xor_mapped.is_some());
+    EXPECT_EQ(xor_mapped.unwrap().get().port, net::Port(2024));
+    EXPECT_EQ(server.stat().endpoint_mismatch.count(), 1);
+    EXPECT_EQ(server.stat().not_cached.count(), 1);
+    EXPECT_EQ(server.cache_count(), 1);
+}
+
+TEST_F(STUNServerStatefulTest, garbage_is_ignored) {
+    StunServer server(settings());
+    const util::ByteVec garbage = {1, 2, 3, 4, 5};
+    const auto r = server.process(Clock::now(), endpoint, util::ConstBinaryView(garbage));
+    EXPECT_TRUE(std::holds_alternative<StunServer::Ignore>(r));
+    EXPECT_EQ(server.cache_count(), 0);
 }
 
 }
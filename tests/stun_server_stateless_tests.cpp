@@ -7,11 +7,16 @@
 //
 
 #include <gtest/gtest.h>
+#include <array>
+#include <atomic>
 #include <random>
 #include <chrono>
+#include <thread>
 
 #include "stun/stun_server_stateless.hpp"
+#include "stun/stun_error.hpp"
 #include "crypto/openssl/openssl_hash.hpp"
+#include "crypto/builtin/builtin_hash.hpp"
 
 namespace freewebrtc::test {
 
@@ -49,6 +54,27 @@ public:
         assert(!rv.is_err());
         return rv.unwrap();
     }
+    // Response of process_into must be the same as response of
+    // process built to the buffer.
+    void check_process_into(StunServer& server, const net::Endpoint& endpoint, const util::ByteVec& data) {
+        const auto view = util::ConstBinaryView(data);
+        std::array<uint8_t, 1500> out;
+        const auto into_rv = server.process_into(endpoint, view, out);
+        ASSERT_TRUE(into_rv.is_ok());
+        const auto maybe_size = into_rv.unwrap();
+        const auto r = server.process(endpoint, view);
+        if (!std::holds_alternative<StunServer::Respond>(r)) {
+            EXPECT_TRUE(maybe_size.is_none());
+            return;
+        }
+        ASSERT_TRUE(maybe_size.is_some());
+        const auto& respond = std::get<StunServer::Respond>(r);
+        std::array<uint8_t, 1500> expected;
+        const auto expected_rv = respond.response.build_into(expected, respond.maybe_integrity);
+        ASSERT_TRUE(expected_rv.is_ok());
+        EXPECT_EQ(util::ConstBinaryView(out.data(), maybe_size.unwrap()),
+                  util::ConstBinaryView(expected.data(), expected_rv.unwrap()));
+    }
     const crypto::SHA1Hash::Func sha1 = crypto::openssl::sha1;
 };
 
@@ -331,6 +357,273 @@ TEST_P(STUNServerStatelessTest, wrong_password) {
     check_error_code(rsp, stun::ErrorCodeAttribute::Unauthorized);
 }
 
+TEST_P(STUNServerStatelessTest, process_batch) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+
+    precis::OpaqueString joe{"joe"};
+    const auto joe_password = stun::Password::short_term(precis::OpaqueString("1234"), sha1, crypto::builtin::sha1_resumable()).unwrap();
+    const auto wrong_password = stun::Password::short_term(precis::OpaqueString("4321"), sha1).unwrap();
+    server.add_user(joe, joe_password);
+
+    std::vector<stun::Message> requests;
+    std::vector<util::ByteVec> datas;
+    for (size_t i = 0; i < 21; ++i) {
+        requests.emplace_back(stun::Message{
+                stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+                stun::AttributeSet::create({stun::UsernameAttribute{joe}, stun::FingerprintAttribute{0}}),
+                stun::IsRFC3489{false},
+                none()
+            });
+        // Every 5th request is authenticated with wrong password
+        const stun::IntegrityData idata{i % 5 == 4 ? wrong_password : joe_password, sha1};
+        datas.emplace_back(requests.back().build(idata).unwrap());
+    }
+    // Not answered so it is not parsed to Message
+    datas.emplace_back(build(stun::Message{
+        stun::Header{stun::Class::indication(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{false},
+        none()
+    }));
+    datas.emplace_back(util::ByteVec{1, 2, 3});
+
+    std::vector<StunServer::Packet> packets;
+    for (const auto& data: datas) {
+        packets.emplace_back(StunServer::Packet{endpoint, util::ConstBinaryView(data)});
+    }
+    const auto results = server.process_batch(packets);
+    ASSERT_EQ(results.size(), packets.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(results[i]));
+        const auto& respond = std::get<StunServer::Respond>(results[i]);
+        if (i % 5 == 4) {
+            check_error_response(respond.response, requests[i]);
+            check_error_code(respond.response, stun::ErrorCodeAttribute::Code::Unauthorized);
+            EXPECT_TRUE(respond.maybe_integrity.is_none());
+        } else {
+            check_success_response(respond.response, requests[i]);
+            ASSERT_TRUE(respond.maybe_integrity.is_some());
+            EXPECT_EQ(respond.maybe_integrity.unwrap().password, joe_password);
+        }
+    }
+    const auto& indication = results[results.size() - 2];
+    ASSERT_TRUE(std::holds_alternative<StunServer::Ignore>(indication));
+    EXPECT_TRUE(std::get<StunServer::Ignore>(indication).message.is_none());
+    EXPECT_TRUE(std::holds_alternative<StunServer::Ignore>(results.back()));
+    // Each packet is counted once
+    const auto stat = server.parse_stat();
+    EXPECT_EQ(stat.success.count(), requests.size() + 1);
+    EXPECT_EQ(stat.error.count(), 1);
+}
+
+TEST_P(STUNServerStatelessTest, remove_and_replace_users) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    precis::OpaqueString joe{"joe"};
+    const auto joe_password = stun::Password::short_term(precis::OpaqueString("1234"), sha1).unwrap();
+    const stun::Message request{
+        stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({stun::UsernameAttribute{joe}}),
+        stun::IsRFC3489{false},
+        none()
+    };
+    const auto data = request.build(stun::IntegrityData{joe_password, sha1}).unwrap();
+    auto response = [&] {
+        const auto r = server.process(endpoint, util::ConstBinaryView(data));
+        EXPECT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+        return std::get<StunServer::Respond>(r).response;
+    };
+
+    server.add_user(joe, joe_password);
+    check_success_response(response(), request);
+    server.remove_user(joe);
+    check_error_code(response(), stun::ErrorCodeAttribute::Code::Unauthorized);
+    server.replace_users(StunServer::Users{{joe, joe_password}});
+    check_success_response(response(), request);
+    server.replace_users(StunServer::Users{});
+    check_error_code(response(), stun::ErrorCodeAttribute::Code::Unauthorized);
+}
+
+TEST_P(STUNServerStatelessTest, update_users) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    const auto password = stun::Password::short_term(precis::OpaqueString("1234"), sha1).unwrap();
+    const auto new_password = stun::Password::short_term(precis::OpaqueString("4321"), sha1).unwrap();
+    auto response = [&](const precis::OpaqueString& name, const stun::Password& request_password) {
+        const stun::Message request{
+            stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+            stun::AttributeSet::create({stun::UsernameAttribute{name}}),
+            stun::IsRFC3489{false},
+            none()
+        };
+        const auto data = request.build(stun::IntegrityData{request_password, sha1}).unwrap();
+        const auto r = server.process(endpoint, util::ConstBinaryView(data));
+        EXPECT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+        return std::get<StunServer::Respond>(r).response.header.cls;
+    };
+
+    // Users are spread over many shards
+    std::vector<precis::OpaqueString> names;
+    StunServer::Users adds;
+    for (size_t i = 0; i < 200; ++i) {
+        names.emplace_back("user" + std::to_string(i));
+        adds.emplace(names.back(), password);
+    }
+    server.update_users(std::move(adds), {});
+    for (const auto& name: names) {
+        EXPECT_EQ(response(name, password), stun::Class::success_response());
+    }
+
+    // Even users are removed and password of user0 is changed
+    std::vector<precis::OpaqueString> removes;
+    for (size_t i = 0; i < names.size(); i += 2) {
+        removes.emplace_back(names[i]);
+    }
+    server.update_users(StunServer::Users{{names[0], new_password}}, removes);
+    EXPECT_EQ(response(names[0], password), stun::Class::error_response());
+    EXPECT_EQ(response(names[0], new_password), stun::Class::success_response());
+    for (size_t i = 1; i < names.size(); ++i) {
+        const auto expected = i % 2 == 0 ? stun::Class::error_response() : stun::Class::success_response();
+        EXPECT_EQ(response(names[i], password), expected);
+    }
+}
+
+TEST_P(STUNServerStatelessTest, users_changed_while_processing) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    precis::OpaqueString joe{"joe"};
+    const auto joe_password = stun::Password::short_term(precis::OpaqueString("1234"), sha1).unwrap();
+    const auto data = stun::Message{
+        stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({stun::UsernameAttribute{joe}}),
+        stun::IsRFC3489{false},
+        none()
+    }.build(stun::IntegrityData{joe_password, sha1}).unwrap();
+    const std::vector<StunServer::Packet> packets(4, StunServer::Packet{endpoint, util::ConstBinaryView(data)});
+
+    std::atomic<bool> stop = false;
+    std::thread writer([&] {
+        for (size_t i = 0; !stop; ++i) {
+            if (i % 2 == 0) {
+                server.add_user(joe, joe_password);
+            } else {
+                server.remove_user(joe);
+            }
+        }
+    });
+    for (size_t i = 0; i < 2000; ++i) {
+        for (const auto& r: server.process_batch(packets)) {
+            ASSERT_TRUE(std::holds_alternative<StunServer::Respond>(r));
+            const auto& rsp = std::get<StunServer::Respond>(r).response;
+            // Result depends on version of users seen by the batch
+            if (rsp.header.cls != stun::Class::success_response()) {
+                check_error_code(rsp, stun::ErrorCodeAttribute::Code::Unauthorized);
+            }
+        }
+    }
+    stop = true;
+    writer.join();
+}
+
+TEST_P(STUNServerStatelessTest, parse_stat_of_all_threads) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    const auto data = build(stun::Message{
+        stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{false},
+        none()
+    });
+    const util::ByteVec invalid{1, 2, 3};
+    const size_t threads_count = 4;
+    const size_t count = 500;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < count; ++i) {
+                server.process(endpoint, util::ConstBinaryView(data));
+                server.process(endpoint, util::ConstBinaryView(invalid));
+            }
+        });
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+    const auto stat = server.parse_stat();
+    EXPECT_EQ(stat.success.count(), threads_count * count);
+    EXPECT_EQ(stat.error.count(), threads_count * count);
+}
+
+TEST_P(STUNServerStatelessTest, process_into_same_as_process) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    precis::OpaqueString joe{"joe"};
+    const auto joe_password = stun::Password::short_term(precis::OpaqueString("1234"), sha1).unwrap();
+    const auto other_password = stun::Password::short_term(precis::OpaqueString("4321"), sha1).unwrap();
+    server.add_user(joe, joe_password);
+
+    auto request = [&](stun::Method method, stun::AttributeSet&& attrs, Maybe<stun::Password> maybe_password = none()) {
+        const stun::Message msg {
+            stun::Header{stun::Class::request(), method, rand_tid()},
+            std::move(attrs),
+            stun::IsRFC3489{false},
+            none()
+        };
+        return maybe_password
+            .fmap([&](const auto& password) { return msg.build(stun::IntegrityData{password, sha1}).unwrap(); })
+            .value_or_call([&] { return build(msg); });
+    };
+    const stun::UnknownAttribute unknown_attr(stun::AttributeType::from_uint16(0x7fff), util::ConstBinaryView({}));
+    const stun::Message rfc3489 {
+        stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid_rfc3489()},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{true},
+        none()
+    };
+    const stun::Message indication {
+        stun::Header{stun::Class::indication(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{false},
+        none()
+    };
+    const std::vector<util::ByteVec> requests = {
+        request(stun::Method::binding(), stun::AttributeSet::create({})),
+        request(stun::Method::binding(), stun::AttributeSet::create({stun::UsernameAttribute{joe}}), joe_password),
+        request(stun::Method::binding(), stun::AttributeSet::create({stun::UsernameAttribute{joe}}), other_password),
+        request(stun::Method::binding(), stun::AttributeSet::create({stun::UsernameAttribute{precis::OpaqueString{"bob"}}}), joe_password),
+        request(stun::Method::binding(), stun::AttributeSet::create({stun::UsernameAttribute{joe}})),
+        request(stun::Method::binding(), stun::AttributeSet::create({}), joe_password),
+        request(stun::Method::binding(), stun::AttributeSet::create({}, {unknown_attr})),
+        request(stun::Method::from_msg_type(0x0002), stun::AttributeSet::create({})),
+        build(rfc3489),
+        build(indication),
+        util::ByteVec{1, 2, 3}
+    };
+    for (const auto& data: requests) {
+        check_process_into(server, endpoint, data);
+    }
+    StunServer no_fingerprint(sha1, StunServer::Settings{.use_fingerprint = false});
+    check_process_into(no_fingerprint, endpoint, requests[0]);
+}
+
+TEST_P(STUNServerStatelessTest, process_into_buffer_too_small) {
+    const auto endpoint = GetParam();
+    StunServer server(sha1);
+    const stun::Message request {
+        stun::Header{stun::Class::request(), stun::Method::binding(), rand_tid()},
+        stun::AttributeSet::create({}),
+        stun::IsRFC3489{false},
+        none()
+    };
+    const auto data = build(request);
+    std::array<uint8_t, 1500> out;
+    const auto size = server.process_into(endpoint, util::ConstBinaryView(data), out).unwrap().unwrap();
+    const auto rv = server.process_into(endpoint, util::ConstBinaryView(data), std::span(out).first(size - 1));
+    ASSERT_TRUE(rv.is_err());
+    EXPECT_EQ(rv.unwrap_err(), make_error_code(stun::BuildError::buffer_too_small));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     CheckAllEndpoints,
     STUNServerStatelessTest,
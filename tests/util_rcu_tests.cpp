@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Read-copy-update value tests
+//
+
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "util/util_rcu.hpp"
+
+namespace freewebrtc::tests {
+
+TEST(RcuTest, update_and_replace) {
+    util::Rcu<std::string> value(std::string("one"));
+    EXPECT_EQ(*value.read(), "one");
+    value.update([](const std::string& s) { return s + "+two"; });
+    EXPECT_EQ(*value.read(), "one+two");
+    value.replace(std::string("three"));
+    EXPECT_EQ(value.read()->size(), 5);
+}
+
+TEST(RcuTest, writer_waits_for_readers_of_old_version) {
+    util::Rcu<std::string> value(std::string("old"));
+    std::atomic<bool> replaced = false;
+    std::thread writer;
+    {
+        const auto reader = value.read();
+        writer = std::thread([&] {
+            value.replace(std::string("new"));
+            replaced = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_FALSE(replaced);
+        EXPECT_EQ(*reader, "old");
+    }
+    writer.join();
+    EXPECT_TRUE(replaced);
+    EXPECT_EQ(*value.read(), "new");
+}
+
+TEST(RcuTest, shards_are_updated_independently) {
+    util::RcuShards<std::string, 4> shards;
+    const std::array<size_t, 2> indices{1, 3};
+    shards.update(indices, [](size_t index, const std::string& s) {
+        return s + std::to_string(index);
+    });
+    const auto reader = shards.read();
+    EXPECT_EQ(reader[0], "");
+    EXPECT_EQ(reader[1], "1");
+    EXPECT_EQ(reader[2], "");
+    EXPECT_EQ(reader[3], "3");
+}
+
+TEST(RcuTest, shards_writer_waits_for_readers_of_old_version) {
+    util::RcuShards<std::string, 2> shards;
+    const std::array<size_t, 1> indices{1};
+    std::atomic<bool> updated = false;
+    std::thread writer;
+    {
+        const auto reader = shards.read();
+        const std::string& old = reader[1];
+        writer = std::thread([&] {
+            shards.update(indices, [](size_t, const std::string&) { return std::string("new"); });
+            updated = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_FALSE(updated);
+        EXPECT_EQ(old, "");
+    }
+    writer.join();
+    EXPECT_TRUE(updated);
+    EXPECT_EQ(shards.read()[1], "new");
+}
+
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2023 Dmitry Poroh
+// All rights reserved.
+// Distributed under the terms of the MIT License. See the LICENSE file.
+//
+// Slot map tests
+//
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "util/util_slot_map.hpp"
+
+namespace freewebrtc::tests {
+
+class SlotMapTest : public ::testing::Test {
+public:
+    struct Key {
+        uint32_t index;
+        uint32_t generation;
+    };
+    using Map = util::SlotMap<std::string, Key>;
+};
+
+TEST_F(SlotMapTest, emplace_find_erase) {
+    Map map;
+    const auto k1 = map.emplace("one");
+    const auto k2 = map.emplace(3, 'x');
+    EXPECT_EQ(map.size(), 2);
+    ASSERT_TRUE(map.find(k1).is_some());
+    EXPECT_EQ(map.find(k1).unwrap().get(), "one");
+    EXPECT_EQ(map.find(k2).unwrap().get(), "xxx");
+    EXPECT_TRUE(map.erase(k1));
+    EXPECT_FALSE(map.erase(k1));
+    EXPECT_FALSE(map.contains(k1));
+    EXPECT_TRUE(map.contains(k2));
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST_F(SlotMapTest, stale_key_is_not_valid_after_reuse) {
+    Map map;
+    const auto k1 = map.emplace("one");
+    map.erase(k1);
+    const auto k2 = map.emplace("two");
+    // Slot is reused with other generation
+    EXPECT_EQ(k2.index, k1.index);
+    EXPECT_NE(k2.generation, k1.generation);
+    EXPECT_TRUE(map.find(k1).is_none());
+    EXPECT_EQ(map.find(k2).unwrap().get(), "two");
+}
+
+TEST_F(SlotMapTest, invalid_index) {
+    const Map map;
+    EXPECT_TRUE(map.find(Key{10, 0}).is_none());
+    EXPECT_TRUE(map.empty());
+}
+
+}